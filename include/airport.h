@@ -0,0 +1,56 @@
+/*
+ * airport.h
+ *
+ * Description of the airport layout. The runways and their routes are
+ * loaded at startup from a text file, the routes may be loaded again
+ * while the simulation runs
+ */
+
+#ifndef _AIRPORT_H_
+#define _AIRPORT_H_
+
+#include "structs.h"
+#include "taxiway.h"
+
+// ==================================================================
+//                    STRUCTURES DEFINITION
+// ==================================================================
+// Geometry of a runway. Its routes are kept in the trajectory sets
+typedef struct {
+	float threshold_x;		// x coordinate of the landing threshold
+	float threshold_y;		// y coordinate of the landing threshold
+	float heading;			// landing and takeoff direction in radiants
+	float approach_length;	// distance of the approach start from the threshold
+	float rollout_length;	// distance of the rollout end from the threshold
+	int landing_size;		// numb. of points of the landing trajectory
+	float rollout_vel;		// velocity at the end of the rollout
+	int entry_node;			// taxiway node where the takeoff roll starts
+} runway_t;
+
+// Position of a holding stack
+typedef struct {
+	float x;				// center of the holding pattern
+	float y;
+} holding_fix_t;
+
+// Layout of the airport
+typedef struct {
+	runway_t runways[MAX_RUNWAYS];
+	int n_runways;
+	holding_fix_t holdings[MAX_HOLDING_STACKS];
+	int n_holdings;
+	taxiway_t taxiway;
+	int gates[MAX_GATES];	// taxiway nodes of the gates
+	int n_gates;
+} airport_t;
+
+
+// ==================================================================
+//                    FUNCTION DEFINITION
+// ==================================================================
+int airport_load(airport_t* airport, const char* path, traj_bank_t* bank,
+	traj_set_t* set);
+void runway_landing_start(const runway_t* runway, float* x, float* y);
+void runway_landing_end(const runway_t* runway, float* x, float* y);
+
+#endif
@@ -0,0 +1,113 @@
+/*
+ * checkpoint.h
+ *
+ * Checkpoint of a whole simulation in a single binary image. The pointers
+ * of the state are saved as pool slots and are rebuilt on restore, the
+ * trajectories are found again from the role of each airplane, so a
+ * simulation resumes where the image was taken instead of repeating its
+ * warm-up. The routes are the ones of the airport file of the restored
+ * simulation. The image is tied to the layout of the build that wrote it
+ */
+
+#ifndef _CHECKPOINT_H_
+#define _CHECKPOINT_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "consts.h"
+#include "structs.h"
+#include "traffic.h"
+#include "simulation.h"
+
+// ==================================================================
+//                    STRUCTURES DEFINITION
+// ==================================================================
+// Slot of the airplane pool. The trajectory is found again from the
+// status, the stack, the gate and the runway of the airplane
+typedef struct {
+	bool is_free;
+	airplane_t airplane;				// des_traj is not saved
+	int64_t spawn_offset_us;			// spawn time from the checkpoint
+	int32_t taxi_reserved;				// progress of the taxi reservations
+	int32_t taxi_released;
+} checkpoint_airplane_t;
+
+// Airplane in the look-ahead window of the sequencer
+typedef struct {
+	int32_t airplane;					// pool slot
+	bool is_arrival;
+	int64_t eta_us;
+} checkpoint_seq_slot_t;
+
+// Header of the image
+typedef struct {
+	char magic[8];						// CHECKPOINT_MAGIC
+	uint32_t version;					// CHECKPOINT_VERSION
+	uint32_t image_size;				// sizeof(checkpoint_image_t)
+	uint64_t seed;
+	int64_t t_us;						// simulated time of the checkpoint
+	// Layout of the airport, checked on restore
+	int32_t n_runways;
+	int32_t n_holdings;
+	int32_t n_gates;
+	int32_t n_taxi_nodes;
+	int32_t n_taxi_edges;
+} checkpoint_header_t;
+
+// State of a simulation. The queues are saved in their order and the
+// airplanes as their pool slots
+typedef struct {
+	checkpoint_header_t header;
+	checkpoint_airplane_t airplanes[AIRPLANE_POOL_SIZE];
+
+	int32_t queue[AIRPLANE_QUEUE_LENGTH];		// serving queue
+	int32_t n_queue;
+
+	// Sequencer
+	int32_t backlog[AIRPLANE_QUEUE_LENGTH];
+	int32_t n_backlog;
+	checkpoint_seq_slot_t window[SEQUENCER_WINDOW];
+	int32_t n_window;
+	int32_t sequence[SEQUENCER_WINDOW];
+	int32_t n_sequence;
+	int32_t seq_ticks;
+	bool seq_is_dirty;
+
+	// Traffic controller, -1 for a free runway
+	int32_t runways[MAX_RUNWAYS];
+	int32_t free_runways[MAX_RUNWAYS];
+	int32_t n_free_runways;
+	int32_t released_runways[RUNWAY_QUEUE_LENGTH];
+	int32_t n_released_runways;
+	bool runways_in_use[MAX_RUNWAYS];	// runways assigned by the controller
+
+	// Holding stacks, -1 for a free slot
+	int32_t holding_slots[MAX_HOLDING_STACKS][HOLDING_SLOTS];
+	int64_t holding_t0_offset_us;		// phase reference from the checkpoint
+
+	int32_t edge_owner[MAX_TAXI_EDGES];	// taxiway reservations
+
+	// Admission and traffic generation
+	spawn_request_t spawn_wait_list[SPAWN_WAIT_LIST_LENGTH];
+	int32_t n_spawn_wait_list;
+	int64_t scenario_next;				// first scheduled spawn not released
+	int64_t airplane_wcet_us;
+	int32_t next_gate;
+	bool enable_random_gen;
+	rng_t rng;
+	traffic_gen_t traffic;
+
+	system_state_t system_state;
+} checkpoint_image_t;
+
+
+// ==================================================================
+//                    FUNCTION DEFINITION
+// ==================================================================
+int checkpoint_save(sim_context_t* ctx, const char* path,
+	const struct timespec* now);
+int checkpoint_load(sim_context_t* ctx, const char* path,
+	const struct timespec* now);
+
+#endif
@@ -0,0 +1,56 @@
+/*
+ * conflict.h
+ *
+ * Prediction of the conflicts between airplanes within a look-ahead
+ * horizon. Each airplane is projected along the next waypoints of its
+ * desired trajectory; the predicted tracks are culled with a sweep on
+ * their bounding boxes before computing the closest point of approach
+ */
+
+#ifndef _CONFLICT_H_
+#define _CONFLICT_H_
+
+#include "consts.h"
+#include "structs.h"
+
+// ==================================================================
+//                    STRUCTURES DEFINITION
+// ==================================================================
+// Predicted position of an airplane "t" seconds from now
+typedef struct {
+	float t;
+	float x;
+	float y;
+} track_point_t;
+
+// Piecewise linear track of an airplane and its bounding box
+typedef struct {
+	track_point_t points[CONFLICT_MAX_LEGS + 1];
+	int n_points;
+	int id;								// unique id of the airplane
+	float min_x;
+	float max_x;
+	float min_y;
+	float max_y;
+} track_t;
+
+// Predicted tracks of all the airplanes
+typedef struct {
+	track_t tracks[MAX_AIRPLANE];
+	const track_t* sorted[MAX_AIRPLANE];	// tracks sorted by min_x
+	int n_tracks;
+	float horizon;						// look-ahead time in seconds
+	float min_dist;						// separation minimum
+} conflict_predictor_t;
+
+
+// ==================================================================
+//                    FUNCTION DEFINITION
+// ==================================================================
+void conflict_init(conflict_predictor_t* cp, float horizon, float min_dist);
+void conflict_clear(conflict_predictor_t* cp);
+void conflict_add_airplane(conflict_predictor_t* cp, const airplane_t* airplane);
+int conflict_detect(conflict_predictor_t* cp, conflict_t* conflicts,
+	int max_conflicts);
+
+#endif
@@ -29,6 +29,7 @@
 #define SIDEBAR_BOX_PADDING 	7
 #define SIDEBAR_BOX_VSPACE		12
 #define SIDEBAR_BOX_FIRST_COL_X	100	
+#define SIDEBAR_COMPACT_TASKS	MAX_AIRPLANE	// tasks shown on two columns
 
 // Airplane
 #define AIRPLANE_SIZE			10
@@ -47,7 +48,6 @@
 #define AIRPLANE_CTRL_MIN_DIST		20.0f
 #define AIRPLANE_CTRL_TAXI_MIN_DIST	5.0f
 #define AIRPLANE_CTRL_VEL			15.0f
-#define AIRPLANE_CTRL_SIM_PERIOD	0.020f
 #define AIRPLANE_CTRL_VEL_TH		0.01f
 
 // ==================================================================
@@ -56,45 +56,110 @@
 #define HOLDING_TRAJECTORY_SIZE 		30
 #define HOLDING_TRAJECTORY_RADIUS 		60.0f
 #define HOLDING_TRAJECTORY_ARM			100.0f
-#define HOLDING_TRAJECTORY_X			-180.0f
-#define HOLDING_TRAJECTORY_Y			180.0f
 #define HOLDING_TRAJECTORY_VEL			50.0f
+#define HOLDING_SLOTS					6		// airplanes per holding stack
+#define HOLDING_SLOT_CATCH_S			5.0f	// time to cancel a slot error
+#define HOLDING_SLOT_MAX_TRIM			0.3f	// max velocity change (fraction)
 
-#define RUNWAY_0_LANDING_TRAJ_SIZE		15
-#define RUNWAY_0_LANDING_TRAJ_START_X	-330.0f
-#define RUNWAY_0_LANDING_TRAJ_START_Y	-140.0f
-#define RUNWAY_0_LANDING_TRAJ_END_X		100.0f
-#define RUNWAY_0_LANDING_TRAJ_END_Y		-140.0f
-#define RUNWAY_0_LANDING_TRAJ_END_VEL	5.0f
-
-#define RUNWAY_1_LANDING_TRAJ_SIZE		10
-#define RUNWAY_1_LANDING_TRAJ_START_X	-330.0f
-#define RUNWAY_1_LANDING_TRAJ_START_Y	-80.0f
-#define RUNWAY_1_LANDING_TRAJ_END_X		100.0f
-#define RUNWAY_1_LANDING_TRAJ_END_Y		-80.0f
-#define RUNWAY_1_LANDING_TRAJ_END_VEL	5.0f
+#define TERMINAL_TRAJ_VEL	0		// velocity at the gates
+#define TAXI_TRAJ_VEL		10.0f
+#define TAXI_HOLD_DIST		15.0f	// distance to reserve the next taxiway
 
-#define TERMINAL_TRAJ_X		-190
-#define TERMINAL_TRAJ_Y		-238
-#define TERMINAL_TRAJ_VEL	0
+// Storage of the trajectories of a simulation
+#define TRAJ_ARENA_FLOATS		98304	// 5 floats per point
+#define TRAJ_ARENA_MAX_TRAJS	160
+#define TRAJ_ARENA_ALIGN		16		// alignment of the arrays (bytes)
+#define TRAJ_SET_VERSIONS		2		// the published set and the retired one
+#define DEPARTURE_BUFFERS		2		// departures of a slot, used in turn
+// Space of a set: exit, departure and landing of each runway, the patterns
+#define TRAJ_SET_MAX_POINTS		(3 * MAX_RUNWAYS * MAX_WAYPOINTS + \
+	MAX_HOLDING_STACKS * HOLDING_TRAJECTORY_SIZE)
+#define TRAJ_SET_MAX_TRAJS		(3 * MAX_RUNWAYS + MAX_HOLDING_STACKS)
 
-#define TAXI_TRAJ_VEL		10.0f
-#define TAKEOFF_TRAJ_VEL	50.0f
-#define RUNWAY_0_TAKEOFF_TRAJ_SIZE		12
-#define RUNWAY_0_TAKEOFF_TRAJ_XS		{TERMINAL_TRAJ_X, -190.0f, -165.0f, -140.0f, -110.0f, -110.0f, -100.0f,  -70.0f,    0.0f, 100.0f,  280.0f,  350.0f}
-#define RUNWAY_0_TAKEOFF_TRAJ_YS		{TERMINAL_TRAJ_Y, -220.0f, -190.0f, -190.0f, -160.0f, -150.0f, -140.0f, -140.0f, -140.0f, -140.0f, -140.0f, -350.0f}
-#define RUNWAY_0_TAKEOFF_TRAJ_VELS		{TAXI_TRAJ_VEL, TAXI_TRAJ_VEL, TAXI_TRAJ_VEL, TAXI_TRAJ_VEL, TAXI_TRAJ_VEL, TAXI_TRAJ_VEL, TAXI_TRAJ_VEL, TAXI_TRAJ_VEL, TAKEOFF_TRAJ_VEL, TAKEOFF_TRAJ_VEL, TAKEOFF_TRAJ_VEL, TAKEOFF_TRAJ_VEL}
+// Runways, their routes, the holding stacks and the taxiways are
+// described in the airport file
+#define AIRPORT_FILE		"assets/airport.txt"
 
-#define RUNWAY_1_TAKEOFF_TRAJ_SIZE		14
-#define RUNWAY_1_TAKEOFF_TRAJ_XS		{TERMINAL_TRAJ_X, -190.0f, -165.0f, -160.0f, -160.0f, -145.0f, -125.0f, -110.0f, -100.0f, -70.0f,   0.0f, 100.0f,  280.0f, 350.0f}
-#define RUNWAY_1_TAKEOFF_TRAJ_YS		{TERMINAL_TRAJ_Y, -220.0f, -190.0f, -180.0f, -125.0f, -110.0f, -110.0f,  -95.0f,  -80.0f, -80.0f, -80.0f, -80.0f, -80.0f, 100.0f}
-#define RUNWAY_1_TAKEOFF_TRAJ_VELS		{TAXI_TRAJ_VEL, TAXI_TRAJ_VEL, TAXI_TRAJ_VEL, TAXI_TRAJ_VEL, TAXI_TRAJ_VEL, TAXI_TRAJ_VEL, TAXI_TRAJ_VEL, TAXI_TRAJ_VEL, TAXI_TRAJ_VEL, TAXI_TRAJ_VEL, TAKEOFF_TRAJ_VEL, TAKEOFF_TRAJ_VEL, TAKEOFF_TRAJ_VEL, TAKEOFF_TRAJ_VEL}
+// Simulated time of a headless run, unless set on the command line
+#define HEADLESS_DURATION_S	120
+#define UPDATE_POLL_MS		100		// end check while waiting for the update
 
 
 // ==================================================================
 //               AIR TRAFFIC CONTROLLER TASK CONSTANTS
 // ==================================================================
-#define N_RUNWAYS		2
+#define MAX_RUNWAYS		8
+#define MAX_HOLDING_STACKS	4
+#define MAX_GATES			8
+#define MAX_TAXI_NODES		32
+#define MAX_TAXI_EDGES		64
+
+// Arrival and departure manager
+#define SEQUENCER_WINDOW			8		// airplanes sequenced together
+#define SEQUENCER_MAX_SHIFT			3		// max delay in positions
+#define SEQUENCER_REPLAN_PERIODS	25		// controller periods between plans
+#define SEP_ARR_ARR_MS				4000	// min separations on a runway
+#define SEP_ARR_DEP_MS				2000
+#define SEP_DEP_ARR_MS				3000
+#define SEP_DEP_DEP_MS				2000
+
+
+// ==================================================================
+//                     SEPARATION MONITOR CONSTANTS
+// ==================================================================
+#define SEPARATION_MIN_DIST			15.0f	// min distance between airplanes
+#define MAX_SEPARATION_VIOLATIONS	8		// violations kept in the state
+
+// Conflict prediction
+#define CONFLICT_HORIZON_S			60.0f	// look-ahead time
+#define CONFLICT_MAX_LEGS			64		// max waypoints of a track
+#define CONFLICT_MIN_VEL			1.0f	// min velocity of a predicted leg
+#define MAX_CONFLICTS				8		// conflicts kept in the state
+
+// Capacity of the spatial grid, can be overridden by the benchmarks
+#ifndef SPATIAL_MAX_CELLS
+#define SPATIAL_MAX_CELLS			4096
+#endif
+#ifndef SPATIAL_MAX_POINTS
+#define SPATIAL_MAX_POINTS			AIRPLANE_POOL_SIZE
+#endif
+
+
+// ==================================================================
+//                     TRAFFIC GENERATOR CONSTANTS
+// ==================================================================
+#define TRAFFIC_RATE_H			1800.0f	// mean spawns per hour
+#define TRAFFIC_INBOUND_RATIO	0.5f	// fraction of inbound spawns
+#define TRAFFIC_BANK_PERIOD_S	1800.0f	// time between two banks
+#define TRAFFIC_BANK_WIDTH_S	300.0f	// spread of the spawns of a bank
+#define TRAFFIC_HOUR_S			3600.0f	// simulated seconds per profile hour
+#define TRAFFIC_START_HOUR		6.0f	// time of day at the start
+#define TRAFFIC_PROFILE_HOURS	24
+
+// Independent random streams of a simulation
+#define RNG_STREAM_TRAFFIC		0		// arrival times and kinds
+#define RNG_STREAM_SPAWN		1		// initial states of the airplanes
+
+// Scheduled traffic
+#define SCENARIO_MAGIC			"ATCSCN"
+#define SCENARIO_VERSION		1
+#define SCENARIO_FLAG_STATE		0x01	// the event sets the initial state
+
+
+// ==================================================================
+//                          RECORDER CONSTANTS
+// ==================================================================
+#define RECORD_MAGIC			"ATCREC"
+#define RECORD_VERSION			1
+#define RECORD_MAX_S			3600	// recorded time of a display run
+#define RECORD_FLAG_TRAJ_FINISHED	0x01
+#define RECORD_FLAG_HOLD_SHORT		0x02
+#define REPLAY_SEEK_S			10		// seek step of the replay keys
+
+// Checkpoints
+#define CHECKPOINT_MAGIC		"ATCCKPT"
+#define CHECKPOINT_VERSION		5
+#define CHECKPOINT_FILE			"checkpoint.bin"	// written by the C key
 
 
 // ==================================================================
@@ -116,31 +181,83 @@
 // ==================================================================
 #define MAX_AIRPLANE			30
 #define AIRPLANE_POOL_SIZE		MAX_AIRPLANE
-#define N_TASKS					(MAX_AIRPLANE + 4)
+#define N_TASKS					(MAX_AIRPLANE + 9)
 #define TRAIL_BUFFER_LENGTH		50
-#define MAX_WAYPOINTS 			50
+#define MAX_WAYPOINTS 			128		// points of a trajectory
 #define AIRPLANE_QUEUE_LENGTH	(MAX_AIRPLANE + 1)
+#define SPAWN_WAIT_LIST_LENGTH	(MAX_AIRPLANE + 1)
+#define RUNWAY_QUEUE_LENGTH		(MAX_RUNWAYS + 1)
 #define TASK_NAME_LENGTH		30
 #define SIDEBAR_STR_LENGTH		40
 
 // ==================================================================
 //                     SCHEDULING CONSTANTS
 // ==================================================================
-#define AIRPLANE_PERIOD_MS 		20
+#define AIRPLANE_PERIOD_MS 		20		// runway, taxi and approach
+#define AIRPLANE_HOLDING_PERIOD_MS	60		// holding pattern
+#define AIRPLANE_GATE_PERIOD_MS		100		// parked at the gate
 #define AIRPLANE_PRIORITY		50
 
 #define TRAFFIC_CTRL_PERIOD_MS	20
 #define TRAFFIC_CTRL_PRIORITY	50
 
-#define GRAPHIC_PERIOD_MS		30
+#define GRAPHIC_PERIOD_MS		30		// initial period, adapted at runtime
 #define GRAPHIC_PRIORITY 		51
 
 #define INPUT_PERIOD_MS			30
 #define INPUT_PRIORITY 			52
 
-#define RANDOM_GEN_PERIOD_MS	2000
+#define RANDOM_GEN_PERIOD_MS	100		// tick of the timing wheel
+#define SPAWN_RETRY_PERIOD_MS	2000	// retry of the deferred spawns
 #define RANDOM_GEN_PRIORITY		53
 
+#define OVERLOAD_PERIOD_MS		100
+#define OVERLOAD_PRIORITY		54
+
+#define SERVER_PERIOD_MS		20		// budget replenishment period
+#define SERVER_BUDGET_US		2000
+#define SERVER_PRIORITY			55
+
+#define WATCHDOG_PERIOD_MS		100
+#define WATCHDOG_PRIORITY		56
+#define WATCHDOG_STALL_PERIODS	3		// periods without progress to stall
+
+#define SEPARATION_PERIOD_MS	20
+#define SEPARATION_PRIORITY		50
+
+#define CONFLICT_PERIOD_MS		500
+#define CONFLICT_PRIORITY		49		// below the airplanes
+
+// ==================================================================
+//                     OVERLOAD DEGRADATION CONSTANTS
+// ==================================================================
+// Degradation levels applied to the low criticality tasks. Each level
+// includes the degradations of the previous ones
+#define OVERLOAD_LEVEL_SLOW_SIDEBAR		1	// sidebar refreshed less often
+#define OVERLOAD_LEVEL_NO_TRAILS		2	// trails are not drawn
+#define OVERLOAD_LEVEL_LOW_FPS			3	// graphic period increased
+#define OVERLOAD_MAX_LEVEL				OVERLOAD_LEVEL_LOW_FPS
+
+#define DEGRADED_SIDEBAR_DIVIDER		10	// sidebar refreshed every N frames
+
+// ==================================================================
+//                     ADAPTIVE FRAME RATE CONSTANTS
+// ==================================================================
+#define GRAPHIC_MIN_PERIOD_MS		20
+#define GRAPHIC_MAX_PERIOD_MS		100
+#define GRAPHIC_PERIOD_STEP_MS		5
+#define GRAPHIC_ADAPT_FRAMES		5		// frames between two adaptations
+#define GRAPHIC_MAX_UTILIZATION		0.25f	// max cpu share of the graphic task
+#define GRAPHIC_HEADROOM_LOW		0.3f	// flight headroom to slow down
+#define GRAPHIC_HEADROOM_HIGH		0.6f	// flight headroom to speed up
+
+// ==================================================================
+//                     ADMISSION CONTROL CONSTANTS
+// ==================================================================
+#define ADMISSION_SCHED_TEST		SCHED_TEST_RM
+#define ADMISSION_AIRPLANE_WCET_US	500		// initial airplane wcet estimate
+#define N_SYSTEM_TASKS				9		// tasks other than the airplanes
+
 // ==================================================================
 //                     		UTILITIES
 // ==================================================================
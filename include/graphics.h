@@ -8,11 +8,35 @@
 #define _GRAPHICS_H_
 
 #include <stdbool.h>
-#include <allegro.h>
 
 #include "structs.h"
 #include "ptask.h"
 
+#ifdef HEADLESS
+// The null backend has no bitmaps and reads no key. The key codes used
+// by the commands have the same values as in Allegro
+typedef struct BITMAP BITMAP;
+#define KEY_C					3
+#define KEY_I					9
+#define KEY_O					15
+#define KEY_R					18
+#define KEY_T					20
+#define KEY_U					21
+#define KEY_W					23
+#define KEY_1					28
+#define KEY_8					35
+#define KEY_ESC					59
+#else
+#include <allegro.h>
+#endif
+
+// ==================================================================
+//                            BACKEND
+// ==================================================================
+int graphics_init(void);
+void graphics_exit(void);
+void destroy_box(BITMAP* box);
+
 // ==================================================================
 //                           MAIN BOX
 // ==================================================================
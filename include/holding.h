@@ -0,0 +1,59 @@
+/*
+ * holding.h
+ *
+ * Holding stacks of the inbound airplanes. Each stack has HOLDING_SLOTS
+ * slots evenly spaced by phase along its pattern
+ */
+
+#ifndef _HOLDING_H_
+#define _HOLDING_H_
+
+#include <stdbool.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "structs.h"
+#include "airport.h"
+#include "ptask.h"
+
+// ==================================================================
+//                    STRUCTURES DEFINITION
+// ==================================================================
+// Holding pattern and its slots
+typedef struct {
+	const trajectory_t* pattern;			// oval flown by the airplanes
+	shared_airplane_t* slots[HOLDING_SLOTS];	// NULL if the slot is free
+	int n_occupied;							// numb. of occupied slots
+	long transit_us;						// time to the nearest approach
+} holding_stack_t;
+
+// Slot allocator of the holding stacks
+typedef struct {
+	holding_stack_t stacks[MAX_HOLDING_STACKS];
+	int n_stacks;
+	float length;							// length of the patterns
+	long sep_us;							// landing separation of the airport
+	struct timespec t0;						// phase reference of the slots
+	sim_clock_t* clock;						// time base of the slots
+	// Stack and slot of each airplane of the pool, -1 if not holding
+	int stack_of[AIRPLANE_POOL_SIZE];
+	int slot_of[AIRPLANE_POOL_SIZE];
+	pthread_mutex_t mutex;
+} holding_manager_t;
+
+
+// ==================================================================
+//                    FUNCTION DEFINITION
+// ==================================================================
+const trajectory_t* holding_build_pattern(traj_bank_t* bank,
+	const holding_fix_t* fix);
+void holding_init(holding_manager_t* hm, const airport_t* airport,
+	const traj_set_t* set, sim_clock_t* clock);
+void holding_set_trajectories(holding_manager_t* hm, const airport_t* airport,
+	const traj_set_t* set);
+bool holding_has_free_slot(holding_manager_t* hm);
+int holding_enter(holding_manager_t* hm, shared_airplane_t* airplane);
+void holding_track_slot(holding_manager_t* hm, airplane_t* airplane);
+void holding_leave(holding_manager_t* hm, const shared_airplane_t* airplane);
+
+#endif
@@ -9,11 +9,53 @@
 #define _PTASK_H_
 
 #include <time.h>
+#include <stdbool.h>
 #include <pthread.h>
 
+// ==================================================================
+//                      SIMULATION CLOCK TYPES
+// ==================================================================
+#define SIM_CLOCK_MAX_WAITERS	128
+
+// Time base of the task loops, the deadline checks and the timed waits
+enum sim_clock_mode {
+	SIM_CLOCK_REAL,		// wall-clock time
+	SIM_CLOCK_SCALED,	// wall-clock time "scale" times faster
+	SIM_CLOCK_AFAP		// as fast as possible: the time jumps to the next
+						// wake up as soon as all the tasks are waiting
+};
+
+struct sim_clock_waiter;
+
+// Time base shared by a set of tasks. Several clocks can run in the same
+// process, e.g. one per simulation. A NULL clock is the real time
+typedef struct {
+	enum sim_clock_mode mode;
+	float scale;						// speed of the simulated time
+	struct timespec origin;				// real time of the initialization
+	struct timespec now;				// current time in SIM_CLOCK_AFAP
+	int n_running;						// tasks not waiting on the clock
+	struct sim_clock_waiter* waiters[SIM_CLOCK_MAX_WAITERS];
+	int n_waiters;
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;				// broadcast when a waiter is woken
+} sim_clock_t;
+
 // ==================================================================
 //                         TASK FUNCTIONS
 // ==================================================================
+// Schedulability test used by the admission control
+enum sched_test {
+	SCHED_TEST_RM,		// Liu & Layland bound for Rate Monotonic
+	SCHED_TEST_EDF		// U <= 1 for Earliest Deadline First
+};
+
+// Criticality of a task, used by the overload manager
+enum task_criticality {
+	TASK_CRIT_LOW,		// cosmetic work, degraded under overload
+	TASK_CRIT_HIGH		// safety-relevant work
+};
+
 typedef struct {
 	pthread_t thread_id;
 	int task_num;						// task id number
@@ -23,8 +65,25 @@ typedef struct {
 	int deadline_ms;					// relative deadline (ms)
 	int priority;						// in [0, 99]
 	int deadline_miss;					// numb. of deadline misses
+	enum task_criticality criticality;	// criticality of the task
+	int n_jobs;							// numb. of completed jobs
+	long min_slack_us;					// min slack since the last reset (us)
+	long exec_us;						// cpu time of the last job (us)
+	long max_exec_us;					// max measured cpu time of a job (us)
+	struct timespec job_start_cpu;		// thread cpu time at the job start
 	struct timespec next_activation;	// next activation time
 	struct timespec abs_deadline;		// absolute deadline
+	sim_clock_t* clock;					// time base, NULL for the real time
+	void* (*body)(void*);				// function executed by the task
+	bool is_active;						// true while the task function runs
+	bool is_suspended;					// true if the task is dormant
+	bool resume_pending;				// true if a resume has been requested
+	pthread_mutex_t wake_mutex;			// protects the suspension state
+	pthread_cond_t wake_cond;			// signaled by task_resume
+	int heartbeat;						// incremented at the end of each job
+	const char* phase;					// what the current job is doing
+	bool is_stalled;					// set by the watchdog
+	int stall_count;					// numb. of stalls seen by the watchdog
 } task_info_t;
 
 int task_info_init(
@@ -34,11 +93,195 @@ int task_info_init(
 int task_deadline_missed(task_info_t* task);
 int task_set_activation(task_info_t* task);
 int task_wait_for_activation(task_info_t* task);
+int task_set_period(task_info_t* task, int period_ms, int deadline_ms);
+int task_wait_for_activation_or_event(task_info_t* task);
+int task_suspend(task_info_t* task);
+void task_resume(task_info_t* task);
+void task_set_phase(task_info_t* task, const char* phase);
+float task_utilization(const task_info_t* task);
+long task_max_exec_us(const task_info_t* task);
+bool task_set_schedulable(float utilization, int n_tasks, enum sched_test test);
 
 int task_create(task_info_t* task, void* (*func)(void*));
 int task_join(task_info_t* task, void** return_value);
 
 
+// ==================================================================
+//                        OVERLOAD MANAGER
+// ==================================================================
+#define OVERLOAD_MAX_TASKS	64
+
+// Watch the deadline misses and the slack of the registered tasks and
+// compute the degradation level that the low criticality tasks must apply
+typedef struct {
+	task_info_t* tasks[OVERLOAD_MAX_TASKS];	// registered tasks
+	int n_jobs[OVERLOAD_MAX_TASKS];			// n_jobs at the last update
+	int deadline_miss[OVERLOAD_MAX_TASKS];	// deadline_miss at the last update
+	int n_tasks;							// numb. of registered tasks
+	int max_level;				// max degradation level
+	int level;					// current degradation level
+	int recovery_count;			// consecutive updates with enough headroom
+	float miss_rate;			// deadline miss rate of the last window
+	float headroom;				// min slack / deadline of the HIGH tasks
+	pthread_mutex_t mutex;
+} overload_manager_t;
+
+void overload_manager_init(overload_manager_t* mgr, int max_level);
+int overload_manager_register(overload_manager_t* mgr, task_info_t* task);
+int overload_manager_update(overload_manager_t* mgr, int* level);
+int overload_manager_get_level(overload_manager_t* mgr);
+float overload_manager_get_headroom(overload_manager_t* mgr);
+
+
+// ==================================================================
+//                            WATCHDOG
+// ==================================================================
+#define WATCHDOG_MAX_TASKS	64
+
+// Detect the tasks that have not completed a job within k periods. The
+// heartbeats are written lock-free by the tasks and only read here
+typedef struct {
+	task_info_t* tasks[WATCHDOG_MAX_TASKS];		// registered tasks
+	int heartbeat[WATCHDOG_MAX_TASKS];			// heartbeat at the last progress
+	struct timespec progress[WATCHDOG_MAX_TASKS];	// time of the last progress
+	int n_tasks;					// numb. of registered tasks
+	int k_periods;					// periods without progress to detect a stall
+	int n_stalls;					// total numb. of detected stalls
+	sim_clock_t* clock;				// time base of the watched tasks
+	pthread_mutex_t mutex;
+} watchdog_t;
+
+void watchdog_init(watchdog_t* wd, sim_clock_t* clock, int k_periods);
+int watchdog_register(watchdog_t* wd, task_info_t* task);
+int watchdog_check(watchdog_t* wd);
+
+
+// ==================================================================
+//                          GRACE PERIOD
+// ==================================================================
+#define GRACE_PERIOD_MAX_TASKS	64
+
+// Grace period of a read-copy-update. The registered tasks may keep the
+// pointers they read only until the end of their job, so the period
+// elapses once every task that was running a job at the start has
+// completed it, is suspended or has ended. The heartbeats are only read,
+// the tasks never wait for a writer. The calls must be serialized by the
+// caller
+typedef struct {
+	task_info_t* tasks[GRACE_PERIOD_MAX_TASKS];	// registered tasks
+	int heartbeat[GRACE_PERIOD_MAX_TASKS];		// heartbeat at the start
+	bool is_waited[GRACE_PERIOD_MAX_TASKS];		// true if active at the start
+	int n_tasks;					// numb. of registered tasks
+} grace_period_t;
+
+void grace_period_init(grace_period_t* gp);
+int grace_period_register(grace_period_t* gp, task_info_t* task);
+void grace_period_start(grace_period_t* gp);
+bool grace_period_elapsed(grace_period_t* gp);
+
+
+// ==================================================================
+//                        APERIODIC SERVER
+// ==================================================================
+#define SERVER_QUEUE_LENGTH	64
+
+// Aperiodic job queued to the server. The function receives the server
+// task that executes it
+typedef struct {
+	void (*func)(task_info_t*, void*);	// function executed by the server
+	void* arg;							// argument of the function
+} aperiodic_job_t;
+
+// Deferrable server. The aperiodic jobs are served as soon as they arrive
+// while the budget lasts; the budget is replenished at every activation of
+// the server task
+typedef struct {
+	aperiodic_job_t jobs[SERVER_QUEUE_LENGTH];	// queue of pending jobs
+	int top;					// index of the first job in the queue
+	int bottom;					// index of the first free element
+	long budget_us;				// cpu budget for each period (us)
+	long remaining_us;			// budget left in the current period (us)
+	int n_served;				// numb. of served jobs
+	int n_dropped;				// numb. of jobs dropped (queue full)
+	bool stop;					// true if the server must terminate
+	sim_clock_t* clock;			// time base of the server task
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;		// signaled when a job arrives
+} aperiodic_server_t;
+
+void aperiodic_server_init(aperiodic_server_t* server, sim_clock_t* clock,
+	long budget_us);
+int aperiodic_server_submit(aperiodic_server_t* server,
+	void (*func)(task_info_t*, void*), void* arg);
+void aperiodic_server_serve(aperiodic_server_t* server, task_info_t* task);
+void aperiodic_server_stop(aperiodic_server_t* server);
+
+
+// ==================================================================
+//                          TIMING WHEEL
+// ==================================================================
+#define TIMER_WHEEL_LEVELS	4
+#define TIMER_WHEEL_BITS	6
+#define TIMER_WHEEL_SLOTS	(1 << TIMER_WHEEL_BITS)
+
+// Link of the circular lists of the wheel
+struct timer_link {
+	struct timer_link* next;
+	struct timer_link* prev;
+};
+
+// Timer armed on a timing wheel. The timer is owned by the caller and must
+// stay alive while it is pending
+typedef struct {
+	struct timer_link link;				// first member, in a list of the wheel
+	long expires;						// expiry tick
+	void (*func)(task_info_t*, void*);	// executed by the task running the wheel
+	void* arg;							// argument of the function
+	bool is_pending;					// true while armed and not expired
+} wheel_timer_t;
+
+// Hierarchical timing wheel. Level k has TIMER_WHEEL_SLOTS slots of
+// TIMER_WHEEL_SLOTS^k ticks each; the timers of a slot are moved to the
+// lower level when the wheel reaches it. Arming and canceling a timer cost
+// O(1) and each tick costs O(1) plus the expired timers. The expiry times
+// are on the clock of the wheel and the timers expire in the task that
+// runs it
+typedef struct {
+	struct timer_link slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+	struct timer_link expired;	// timers of the tick being run
+	long tick_us;				// duration of a tick (us)
+	long current;				// first tick not run
+	int n_pending;				// numb. of armed timers
+	struct timespec origin;		// start of the tick 0
+	sim_clock_t* clock;			// time base of the expiry times
+	pthread_mutex_t mutex;
+} timer_wheel_t;
+
+void timer_wheel_init(timer_wheel_t* wheel, sim_clock_t* clock, int tick_ms);
+void wheel_timer_init(wheel_timer_t* timer,
+	void (*func)(task_info_t*, void*), void* arg);
+void timer_wheel_add(timer_wheel_t* wheel, wheel_timer_t* timer,
+	const struct timespec* time);
+bool timer_wheel_cancel(timer_wheel_t* wheel, wheel_timer_t* timer);
+bool timer_wheel_is_pending(timer_wheel_t* wheel, const wheel_timer_t* timer);
+bool timer_wheel_is_empty(timer_wheel_t* wheel);
+int timer_wheel_run(timer_wheel_t* wheel, task_info_t* task);
+
+
+// ==================================================================
+//                        SIMULATION CLOCK
+// ==================================================================
+void ptask_clock_init(sim_clock_t* clock, enum sim_clock_mode mode,
+	float scale);
+void ptask_clock_start(sim_clock_t* clock);
+enum sim_clock_mode ptask_clock_mode(const sim_clock_t* clock);
+void ptask_clock_now(sim_clock_t* clock, struct timespec* now);
+int ptask_clock_sleep_until(sim_clock_t* clock, const struct timespec* time);
+int ptask_cond_timedwait(sim_clock_t* clock, pthread_cond_t* cond,
+	pthread_mutex_t* mutex, const struct timespec* abs_time);
+void ptask_cond_signal(sim_clock_t* clock, pthread_cond_t* cond);
+
+
 // ==================================================================
 //                    		MUTEX FUNCTIONS
 // ==================================================================
@@ -50,6 +293,8 @@ void ptask_mutex_init(pthread_mutex_t* mutex);
 // ==================================================================
 void time_copy(struct timespec* des, const struct timespec* src);
 void time_add_ms(struct timespec* time, int msec);
+void time_add_us(struct timespec* time, long usec);
 int time_cmp(const struct timespec* t1, const struct timespec* t2);
+long time_diff_us(const struct timespec* t1, const struct timespec* t2);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,102 @@
+/*
+ * recorder.h
+ *
+ * Binary log of the fleet state. A frame with all the airplanes is
+ * appended at each tick to a preallocated, memory mapped file, so that
+ * recording costs a copy and no system call. The frames have a fixed
+ * size: a replay reaches any frame in O(1) and any time in O(log n).
+ * The log is in the byte order of the machine that wrote it
+ */
+
+#ifndef _RECORDER_H_
+#define _RECORDER_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "consts.h"
+#include "structs.h"
+
+// ==================================================================
+//                    STRUCTURES DEFINITION
+// ==================================================================
+// Header at the start of the log
+typedef struct {
+	char magic[8];						// RECORD_MAGIC
+	uint32_t version;					// RECORD_VERSION
+	uint32_t header_size;				// sizeof(record_header_t)
+	uint32_t frame_size;				// sizeof(record_frame_t)
+	uint32_t max_airplanes;				// airplanes of a frame
+	uint32_t tick_ms;					// nominal time between two frames
+	uint32_t reserved;
+	uint64_t max_frames;				// preallocated frames
+	uint64_t seed;						// seed of the recorded simulation
+	// Frames written. Updated after each frame, so a reader never sees
+	// a partial frame
+	uint64_t n_frames;
+} record_header_t;
+
+// State of an airplane in a frame
+typedef struct {
+	int32_t unique_id;
+	float x;
+	float y;
+	float angle;
+	float vel;
+	int16_t traj_index;
+	uint8_t status;						// enum airplane_status
+	uint8_t flags;						// RECORD_FLAG_*
+	int8_t runway_id;
+	int8_t gate_id;
+	uint16_t reserved;
+} record_airplane_t;
+
+// Fleet state at a tick
+typedef struct {
+	int64_t t_us;						// simulated time from the start
+	uint32_t n_airplanes;
+	uint32_t reserved;
+	record_airplane_t airplanes[AIRPLANE_POOL_SIZE];
+} record_frame_t;
+
+// Writer of a log. Owned by a single task
+typedef struct {
+	int fd;								// -1 if not recording
+	record_header_t* header;			// start of the mapping
+	record_frame_t* frames;
+	size_t size;						// size of the mapping
+	long n_dropped;						// frames lost with the log full
+} recorder_t;
+
+// Reader of a log
+typedef struct {
+	int fd;
+	void* map;							// start of the mapping
+	const record_header_t* header;
+	const record_frame_t* frames;
+	size_t size;
+	long n_frames;						// complete frames in the file
+} replay_t;
+
+
+// ==================================================================
+//                    FUNCTION DEFINITION
+// ==================================================================
+// Recorder
+void recorder_init(recorder_t* rec);
+int recorder_open(recorder_t* rec, const char* path, long max_frames,
+	int tick_ms, uint64_t seed);
+bool recorder_is_open(const recorder_t* rec);
+void recorder_append(recorder_t* rec, long t_us, const airplane_t* airplanes,
+	int n);
+void recorder_close(recorder_t* rec);
+
+// Replay
+int replay_open(replay_t* replay, const char* path);
+const record_frame_t* replay_frame(const replay_t* replay, long index);
+long replay_seek(const replay_t* replay, long t_us);
+void replay_get_airplane(const record_airplane_t* src, airplane_t* dst);
+void replay_close(replay_t* replay);
+
+#endif
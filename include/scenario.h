@@ -0,0 +1,74 @@
+/*
+ * scenario.h
+ *
+ * Scheduled traffic. A scenario is a list of timed spawn events, compiled
+ * from a text schedule into a binary file sorted by time. The binary file
+ * is memory mapped and its events are read in place, so opening a
+ * scenario costs the same for any number of events and each event is
+ * released in O(1). The file is in the byte order of the machine that
+ * compiled it
+ */
+
+#ifndef _SCENARIO_H_
+#define _SCENARIO_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "consts.h"
+#include "structs.h"
+
+// ==================================================================
+//                    STRUCTURES DEFINITION
+// ==================================================================
+// Header at the start of the file
+typedef struct {
+	char magic[8];						// SCENARIO_MAGIC
+	uint32_t version;					// SCENARIO_VERSION
+	uint32_t header_size;				// sizeof(scenario_header_t)
+	uint32_t event_size;				// sizeof(scenario_event_t)
+	uint32_t reserved;
+	uint64_t n_events;
+} scenario_header_t;
+
+// Spawn of an airplane. The hints out of the airport are ignored
+typedef struct {
+	int64_t t_us;						// time from the start of the simulation
+	uint8_t kind;						// INBOUND_HOLDING or OUTBOUND_HOLDING
+	uint8_t flags;						// SCENARIO_FLAG_*
+	int8_t runway;						// preferred runway, -1 for none
+	int8_t gate;						// gate of a departure, -1 for the next one
+	float x;							// initial state with SCENARIO_FLAG_STATE,
+	float y;							// random otherwise
+	float angle;
+} scenario_event_t;
+
+// Reader of a scenario. Owned by the random generation task
+typedef struct {
+	int fd;								// -1 if no scenario is open
+	void* map;							// start of the mapping
+	size_t size;
+	const scenario_header_t* header;
+	const scenario_event_t* events;		// sorted by time
+	long n_events;
+	long next;							// first event not released
+} scenario_t;
+
+
+// ==================================================================
+//                    FUNCTION DEFINITION
+// ==================================================================
+// Reader
+void scenario_init(scenario_t* sc);
+int scenario_open(scenario_t* sc, const char* path);
+bool scenario_is_open(const scenario_t* sc);
+bool scenario_is_done(const scenario_t* sc);
+bool scenario_next(scenario_t* sc, long until_us, long* index);
+const scenario_event_t* scenario_event(const scenario_t* sc, long index);
+void scenario_close(scenario_t* sc);
+
+// Compiler of the text schedules
+int scenario_compile(const char* text_path, const char* path);
+
+#endif
@@ -0,0 +1,83 @@
+/*
+ * sequencer.h
+ *
+ * Arrival and departure manager. The airplanes waiting for a runway are
+ * sequenced by estimated time of arrival at the runway, with minimum
+ * separations between consecutive operations
+ */
+
+#ifndef _SEQUENCER_H_
+#define _SEQUENCER_H_
+
+#include <stdbool.h>
+
+#include "structs.h"
+#include "airport.h"
+
+#define SEQUENCER_N_SUBSETS		(1 << SEQUENCER_WINDOW)
+
+// ==================================================================
+//                    STRUCTURES DEFINITION
+// ==================================================================
+// Order in which the airplanes of the window get the runways
+enum sequencer_policy {
+	SEQUENCER_FCFS,				// arrival order
+	SEQUENCER_OPTIMAL			// minimum total delay of the window
+};
+
+// Airplane in the look-ahead window of the sequencer
+typedef struct {
+	shared_airplane_t* airplane;
+	bool is_arrival;			// true for landings, false for takeoffs
+	long eta_us;				// time needed to clear the runway (us)
+} sequencer_slot_t;
+
+// Best partial sequence that contains a subset of the window and ends
+// with a given airplane
+typedef struct {
+	long delay_us;				// total delay of the partial sequence
+	long time_us;				// runway time of the last airplane
+	int prev;					// previous airplane, -1 if first
+} sequencer_state_t;
+
+// Arrival and departure manager. It's owned by the traffic controller
+// and it isn't thread safe
+typedef struct {
+	// Airplanes waiting to enter the look-ahead window, in arrival order
+	shared_airplane_t* backlog[AIRPLANE_QUEUE_LENGTH];
+	int backlog_top;
+	int backlog_bottom;
+
+	sequencer_slot_t window[SEQUENCER_WINDOW];
+	int n_window;
+	int sequence[SEQUENCER_WINDOW];		// optimised order of the window
+	int n_sequence;
+	bool is_dirty;						// true if the window has changed
+	int ticks;							// updates since the last plan
+	enum sequencer_policy policy;
+
+	// Runway time of the routes of each runway
+	const airport_t* airport;
+	const traj_set_t* trajectories;
+	int version;						// version of the trajectories
+	long landing_us[MAX_RUNWAYS];
+	long departure_us[MAX_RUNWAYS];
+	int n_in_use;						// numb. of runways in use
+
+	sequencer_state_t dp[SEQUENCER_N_SUBSETS][SEQUENCER_WINDOW];
+} sequencer_t;
+
+
+// ==================================================================
+//                    FUNCTION DEFINITION
+// ==================================================================
+void sequencer_init(sequencer_t* seq, const airport_t* airport,
+	const traj_set_t* trajectories, enum sequencer_policy policy);
+void sequencer_set_trajectories(sequencer_t* seq,
+	const traj_set_t* trajectories);
+int sequencer_add(sequencer_t* seq, shared_airplane_t* airplane);
+void sequencer_update(sequencer_t* seq);
+shared_airplane_t* sequencer_pop(sequencer_t* seq);
+bool sequencer_is_empty(const sequencer_t* seq);
+
+#endif
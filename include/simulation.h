@@ -0,0 +1,207 @@
+/*
+ * simulation.h
+ *
+ * Simulation context. All the state of a simulated airport lives in a
+ * sim_context_t, so that several independent simulations can run in the
+ * same process, each one with its own clock and its own random streams
+ */
+
+#ifndef _SIMULATION_H_
+#define _SIMULATION_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "consts.h"
+#include "structs.h"
+#include "ptask.h"
+#include "airport.h"
+#include "taxiway.h"
+#include "sequencer.h"
+#include "holding.h"
+#include "spatial.h"
+#include "conflict.h"
+#include "traffic.h"
+#include "recorder.h"
+#include "scenario.h"
+
+// ==================================================================
+//                    STRUCTURES DEFINITION
+// ==================================================================
+// Parameters of a simulation
+typedef struct {
+	const char* airport_file;
+	enum sim_clock_mode clock_mode;
+	float clock_scale;					// speed of SIM_CLOCK_SCALED
+	uint64_t seed;						// seed of the random streams
+	int n_inbound;						// inbound airplanes at the start
+	int n_outbound;						// outbound airplanes at the start
+	bool random_gen;					// true to start the random generation
+	traffic_params_t traffic;			// arrival process of the random spawns
+	const char* scenario_file;			// scheduled spawns, NULL for none
+	int n_runways;						// runways in use, 0 for all
+	int update_s;						// time of the route update, -1 for none
+	const char* update_file;			// routes of the update, NULL to reload
+	unsigned update_runways;			// runways in use after it, 0 for all
+	enum sequencer_policy policy;		// runway sequencing policy
+	int duration_s;						// simulated time of a headless run
+	bool display;						// true to run the graphic and input tasks
+	bool verbose;						// true to log the runway assignments
+	const char* record_file;			// log of the fleet state, NULL for none
+	const char* checkpoint_file;		// checkpoint to save, NULL for none
+	const char* restore_file;			// checkpoint to resume, NULL for none
+} sim_config_t;
+
+// Job statistics of a task
+typedef struct {
+	char name[TASK_NAME_LENGTH];
+	long jobs;
+	int deadline_miss;
+	long max_exec_us;
+} sim_task_stats_t;
+
+// Outcome of a headless simulation
+typedef struct {
+	double sim_s;						// simulated time
+	double real_s;						// wall clock time
+	int n_admitted;						// spawn requests
+	int n_deferred;
+	int n_rejected;
+	int n_landed;						// completed operations
+	int n_departed;
+	double throughput_h;				// completed operations per hour
+	int n_delays;						// airplanes that got a runway
+	double mean_delay_s;				// from the spawn to the runway
+	double max_delay_s;
+	long n_separation_checks;			// checks with airplanes in the air
+	double separation_loss;				// fraction of checks with violations
+	float min_separation;				// min distance of a violation
+	int n_stalls;						// stalls seen by the watchdog
+	sim_task_stats_t airplane_stats;	// all the airplane tasks together
+	sim_task_stats_t task_stats[N_SYSTEM_TASKS];
+	int n_task_stats;
+} sim_results_t;
+
+// State of a simulation, shared by its tasks
+typedef struct {
+	sim_config_t config;
+	sim_clock_t clock;					// time base of all the tasks
+	struct timespec start_time;			// simulated time of the initialization
+	rng_t rng;							// initial states of the airplanes
+	traffic_gen_t traffic;				// owned by the random generation task
+	scenario_t scenario;				// owned by the random generation task
+	// Timed events, expired by the random generation task
+	timer_wheel_t timers;
+	wheel_timer_t traffic_timer;		// next random spawn
+	wheel_timer_t scenario_timer;		// next scheduled spawn
+	wheel_timer_t retry_timer;			// next retry of the deferred spawns
+
+	// Trajectories, stored in the arena. The departure trajectory of each
+	// airplane of the pool is rebuilt in place when a runway is assigned
+	traj_arena_t trajectories;
+	const trajectory_t* gate_trajectories[MAX_GATES];
+	// Routes of the runways and of the stacks, replaced at runtime by
+	// read-copy-update. The readers load the published set without
+	// locking, the retired one is reclaimed after the grace periods
+	const traj_set_t* traj_set;			// published set
+	traj_set_t traj_sets[TRAJ_SET_VERSIONS];
+	traj_bank_t traj_banks[TRAJ_SET_VERSIONS];
+	int traj_retired;					// retired set, -1 if none
+	bool traj_is_draining;				// true if no airplane uses it anymore
+	grace_period_t traj_grace;
+	pthread_mutex_t traj_mutex;			// serializes the writers
+	airport_t airport;
+	taxi_route_t taxi_routes[AIRPLANE_POOL_SIZE];
+	// Departures of each airplane of the pool and the last one built
+	trajectory_t* departure_trajectories[AIRPLANE_POOL_SIZE][DEPARTURE_BUFFERS];
+	int departure_buffer[AIRPLANE_POOL_SIZE];
+	int next_gate;						// gate of the next outbound airplane
+	// Spawn time of each airplane of the pool, used for the delays
+	struct timespec spawn_times[AIRPLANE_POOL_SIZE];
+	// Route nodes reached by the reserved and by the released taxiway
+	// edges of each airplane of the pool, owned by its task
+	int taxi_reserved[AIRPLANE_POOL_SIZE];
+	int taxi_released[AIRPLANE_POOL_SIZE];
+
+	task_info_t airplane_task_infos[MAX_AIRPLANE];
+	// true if the airplane task has a thread still to be joined
+	bool airplane_joinable[MAX_AIRPLANE];
+	task_info_t graphic_task_info;
+	task_info_t input_task_info;
+	task_info_t traffic_ctrl_task_info;
+	task_info_t random_gen_task_info;
+	task_info_t overload_task_info;
+	task_info_t server_task_info;
+	task_info_t watchdog_task_info;
+	task_info_t separation_task_info;
+	task_info_t conflict_task_info;
+	task_info_t* system_task_infos[N_SYSTEM_TASKS];
+	int n_system_tasks;					// system tasks started
+	airplane_pool_t airplane_pool;
+	airplane_queue_t airplane_queue;	// Serving queue
+	sequencer_t sequencer;		// Runway sequence, owned by the traffic controller
+	// Airplanes assigned to the runways and stack of the free runways,
+	// owned by the traffic controller
+	shared_airplane_t* runways[MAX_RUNWAYS];
+	int free_runways[MAX_RUNWAYS];
+	int n_free_runways;
+	holding_manager_t holding_manager;
+	shared_system_state_t system_state;
+	task_state_t task_states[N_TASKS];
+	overload_manager_t overload_manager;
+	aperiodic_server_t aperiodic_server;	// serves keyboard commands and spawns
+	watchdog_t watchdog;
+	spatial_grid_t separation_grid;		// owned by the separation monitor
+	conflict_predictor_t conflict_predictor;	// owned by the conflict task
+	recorder_t recorder;				// owned by the separation monitor
+	spawn_wait_list_t spawn_wait_list;	// spawn requests deferred by admission
+	pthread_mutex_t admission_mutex;
+	// Held for reading by the jobs that change the state, for writing by
+	// a checkpoint
+	pthread_rwlock_t job_gate;
+	long airplane_wcet_us;				// airplane wcet estimate
+
+	bool show_trails;
+	bool show_next_waypoint;
+	bool enable_random_gen;
+	bool end_all;					// true if the simulation should terminate
+	// Runways whose airplane has finished its trajectory. Filled by the
+	// airplane tasks, emptied by the traffic controller
+	runway_queue_t released_runways;
+} sim_context_t;
+
+
+// ==================================================================
+//                    FUNCTION DEFINITION
+// ==================================================================
+// Configuration
+void sim_config_init(sim_config_t* config);
+int sim_config_set_clock(sim_config_t* config, const char* clock_arg);
+
+// Life cycle
+int sim_init(sim_context_t* ctx, const sim_config_t* config);
+void sim_create_tasks(sim_context_t* ctx);
+void sim_stop(sim_context_t* ctx);
+void sim_join(sim_context_t* ctx);
+
+// Commands
+void sim_start_traffic(sim_context_t* ctx);
+void sim_submit_spawn(sim_context_t* ctx, enum airplane_status status);
+void sim_toggle_random_gen(sim_context_t* ctx);
+int sim_checkpoint(sim_context_t* ctx, const char* path);
+
+// Trajectories
+const traj_set_t* sim_trajectories(sim_context_t* ctx);
+int sim_update_trajectories(sim_context_t* ctx, const char* airport_file,
+	unsigned runways);
+void sim_update_when_due(sim_context_t* ctx);
+const trajectory_t* build_departure_trajectory(sim_context_t* ctx,
+	const traj_set_t* set, int airplane_id, int gate_id, int runway_id);
+
+// Headless run
+void sim_get_results(sim_context_t* ctx, double sim_s, double real_s,
+	sim_results_t* results);
+int sim_run(const sim_config_t* config, sim_results_t* results);
+
+#endif
@@ -0,0 +1,55 @@
+/*
+ * spatial.h
+ *
+ * Uniform spatial hash grid used to find the airplanes close to each
+ * other without comparing all the pairs. The grid is rebuilt at every
+ * tick from the airplane positions with a counting sort
+ */
+
+#ifndef _SPATIAL_H_
+#define _SPATIAL_H_
+
+#include "consts.h"
+#include "structs.h"
+
+// ==================================================================
+//                    STRUCTURES DEFINITION
+// ==================================================================
+// Position indexed by the grid
+typedef struct {
+	float x;
+	float y;
+	int id;								// caller defined identifier
+} spatial_entry_t;
+
+// Grid of square cells covering a rectangular area. The points outside
+// the area are stored in the nearest border cell
+typedef struct {
+	float min_x;						// lower left corner of the area
+	float min_y;
+	float cell_size;
+	int n_cols;
+	int n_rows;
+	// Entries sorted by cell. The entries of the cell c are in
+	// [cell_start[c], cell_start[c + 1])
+	int cell_start[SPATIAL_MAX_CELLS + 1];
+	int cell_fill[SPATIAL_MAX_CELLS];	// working cursors of the sort
+	int cell_of[SPATIAL_MAX_POINTS];	// cell of each input entry
+	spatial_entry_t entries[SPATIAL_MAX_POINTS];
+	int n_entries;
+} spatial_grid_t;
+
+
+// ==================================================================
+//                    FUNCTION DEFINITION
+// ==================================================================
+int spatial_grid_init(spatial_grid_t* grid, float min_x, float min_y,
+	float width, float height, float cell_size);
+void spatial_grid_build(spatial_grid_t* grid, const spatial_entry_t* entries,
+	int n);
+int spatial_grid_query(const spatial_grid_t* grid, float x, float y,
+	float radius, int* ids, int max_ids);
+int spatial_grid_violations(const spatial_grid_t* grid, float min_dist,
+	separation_violation_t* violations, int max_violations);
+
+#endif
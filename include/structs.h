@@ -11,6 +11,7 @@
 #include <pthread.h>
 
 #include "./consts.h"
+#include "./trajectory.h"
 
 // ==================================================================
 //                         ENUM DEFINITION
@@ -25,20 +26,6 @@ enum airplane_status {
 // ==================================================================
 //                    STRUCTURES DEFINITION
 // ==================================================================
-// Point of the desired trajectory that an airplane has to follow 
-typedef struct {
-	float x;		// x cartesian coordinate
-	float y;		// y cartesian coordinate
-	float vel;		// velocity
-} waypoint_t;
-
-// Desired trajectory that an airplane has to follow
-typedef struct {
-	waypoint_t waypoints[MAX_WAYPOINTS]; // list of points
-	bool is_cyclic;						 // true if the trajectory is cyclic
-	int size;							 // number of points in the trajectory
-} trajectory_t;
-
 // Contain all the information related to an airplane
 typedef struct {
 	float x;						// current x cartisian coordinate
@@ -51,6 +38,12 @@ typedef struct {
 	enum airplane_status status;	// status of the airplane
 	int unique_id;					// incremental index
 	bool kill;						// true if the airplane must be despawned
+	int runway_id;					// assigned runway, -1 if none
+	int cmd_count;					// numb. of commands of the controller
+	int gate_id;					// gate of an outbound airplane, -1 if none
+	bool hold_short;				// true if waiting for a taxiway
+	int runway_hint;				// preferred runway, -1 if none
+	float slot_vel;					// velocity on a holding slot, 0 if none
 } airplane_t;
 
 // Put together the airplane struct with its mutex
@@ -79,6 +72,28 @@ typedef struct {
 	pthread_mutex_t mutex;
 } airplane_queue_t;
 
+// Request of spawning an airplane
+typedef struct {
+	enum airplane_status status;		// initial status
+	long event;							// scenario event, -1 for a random spawn
+} spawn_request_t;
+
+// Queue of the spawn requests deferred by the admission control
+typedef struct {
+	spawn_request_t elems[SPAWN_WAIT_LIST_LENGTH];
+	int top;		// Index of the first element in the queue
+	int bottom;		// Index of the first free element
+	pthread_mutex_t mutex;
+} spawn_wait_list_t;
+
+// Queue of runway ids, used to notify the released runways
+typedef struct {
+	int elems[RUNWAY_QUEUE_LENGTH];
+	int top;		// Index of the first element in the queue
+	int bottom;		// Index of the first free element
+	pthread_mutex_t mutex;
+} runway_queue_t;
+
 // Airplane pool used for the allocation of new airplane structures
 typedef struct {
 	shared_airplane_t elems[AIRPLANE_POOL_SIZE];
@@ -88,11 +103,53 @@ typedef struct {
 	pthread_mutex_t mutex;
 } airplane_pool_t;
 
+// Pair of airplanes closer than the separation minimum
+typedef struct {
+	int id_a;							// unique ids of the airplanes
+	int id_b;
+	float distance;
+} separation_violation_t;
+
+// Pair of airplanes predicted to lose separation
+typedef struct {
+	int id_a;							// unique ids of the airplanes
+	int id_b;
+	float t_cpa;						// time to the closest approach [s]
+	float distance;						// distance at the closest approach
+} conflict_t;
+
 // Contain all the information used in the section SYSTEM STATE of the sidebar
 typedef struct {
 	int n_airplanes;					// number of airplanes in the system
-	bool is_runway_free[N_RUNWAYS];		// state of the runways
+	int n_runways;						// number of runways of the airport
+	int n_free_runways;					// number of free runways
 	bool random_gen_enabled;			// state of the random generation
+	int overload_level;					// degradation level of the system
+	int graphic_period_ms;				// current period of the graphic task
+	int n_admitted;						// numb. of admitted spawn requests
+	int n_deferred;						// numb. of deferred spawn requests
+	int n_rejected;						// numb. of rejected spawn requests
+	float utilization;					// utilization seen by the admission
+	int n_stalls;						// numb. of stalls seen by the watchdog
+	int n_violations;					// numb. of separation violations
+	// First violations found in the last separation check
+	separation_violation_t violations[MAX_SEPARATION_VIOLATIONS];
+	int n_conflicts;					// numb. of predicted conflicts
+	// First conflicts found by the last prediction
+	conflict_t conflicts[MAX_CONFLICTS];
+	int n_landed;						// numb. of airplanes landed
+	int n_departed;						// numb. of airplanes taken off
+	// Job statistics of the ended airplane tasks
+	long airplane_jobs;
+	int airplane_deadline_miss;
+	long airplane_max_exec_us;
+	// Delays from the spawn to the runway assignment
+	int n_delays;
+	long total_delay_us;
+	long max_delay_us;
+	long n_separation_checks;			// checks with airplanes in the air
+	long n_separation_losses;			// checks that found violations
+	float min_separation;				// min distance of a violation
 } system_state_t;
 
 typedef struct {
@@ -105,6 +162,9 @@ typedef struct {
 	char str[TASK_NAME_LENGTH];			// display name of the task
 	int deadline_miss;					// number of deadline misses
 	bool is_running;					// true if the task is running
+	bool is_dormant;					// true if the task is suspended
+	bool is_stalled;					// true if the watchdog detected a stall
+	int stall_count;					// number of stalls
 } task_state_t;
 
 
@@ -123,11 +183,20 @@ shared_airplane_t* airplane_queue_pop(airplane_queue_t* queue);
 bool airplane_queue_is_empty(airplane_queue_t* queue);
 bool airplane_queue_is_full(airplane_queue_t* queue);
 
+// Spawn wait list
+void spawn_wait_list_init(spawn_wait_list_t* list);
+int spawn_wait_list_push(spawn_wait_list_t* list, const spawn_request_t* request);
+bool spawn_wait_list_pop(spawn_wait_list_t* list, spawn_request_t* request);
+bool spawn_wait_list_peek(spawn_wait_list_t* list, spawn_request_t* request);
+bool spawn_wait_list_is_empty(spawn_wait_list_t* list);
+
+// Runway queue
+void runway_queue_init(runway_queue_t* queue);
+int runway_queue_push(runway_queue_t* queue, int runway_id);
+bool runway_queue_pop(runway_queue_t* queue, int* runway_id);
+
 // Cyclic buffer
 void cbuffer_init(cbuffer_t* buffer);
 int cbuffer_next_index(cbuffer_t* buffer);
 
-// Trajectory
-const waypoint_t* trajectory_get_point(const trajectory_t* trajectory, int index);
-
 #endif
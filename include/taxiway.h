@@ -0,0 +1,60 @@
+/*
+ * taxiway.h
+ *
+ * Graph of the taxiways. The shortest routes between all the pairs of
+ * nodes are computed once at startup; the edges are reserved by the
+ * taxiing airplanes so that two airplanes never share a segment
+ */
+
+#ifndef _TAXIWAY_H_
+#define _TAXIWAY_H_
+
+#include <stdbool.h>
+#include <pthread.h>
+
+#include "consts.h"
+
+// ==================================================================
+//                    STRUCTURES DEFINITION
+// ==================================================================
+// Taxiway intersection, gate or runway entry
+typedef struct {
+	float x;
+	float y;
+} taxi_node_t;
+
+// Taxiway graph with the cached shortest routes
+typedef struct {
+	taxi_node_t nodes[MAX_TAXI_NODES];
+	int n_nodes;
+	// Edge connecting two nodes, -1 if not connected
+	int edge_id[MAX_TAXI_NODES][MAX_TAXI_NODES];
+	int n_edges;
+	// Length of the shortest route and next node along it (-1 if unreachable)
+	float dist[MAX_TAXI_NODES][MAX_TAXI_NODES];
+	int next[MAX_TAXI_NODES][MAX_TAXI_NODES];
+	// Airplane that has reserved an edge, -1 if free
+	int edge_owner[MAX_TAXI_EDGES];
+	pthread_mutex_t mutex;
+} taxiway_t;
+
+// Nodes of the route assigned to a taxiing airplane
+typedef struct {
+	int nodes[MAX_WAYPOINTS];
+	int n_nodes;
+} taxi_route_t;
+
+
+// ==================================================================
+//                    FUNCTION DEFINITION
+// ==================================================================
+void taxiway_init(taxiway_t* taxiway);
+int taxiway_add_node(taxiway_t* taxiway, float x, float y);
+int taxiway_add_edge(taxiway_t* taxiway, int a, int b);
+void taxiway_compute_routes(taxiway_t* taxiway);
+int taxiway_route(const taxiway_t* taxiway, int from, int to,
+	taxi_route_t* route);
+bool taxiway_reserve(taxiway_t* taxiway, int a, int b, int owner);
+void taxiway_release(taxiway_t* taxiway, int a, int b, int owner);
+
+#endif
@@ -0,0 +1,79 @@
+/*
+ * traffic.h
+ *
+ * Seeded traffic generator. The random numbers come from xoshiro256**
+ * streams derived from a seed and a stream id, so each simulation owns
+ * its streams and a seed always produces the same traffic
+ */
+
+#ifndef _TRAFFIC_H_
+#define _TRAFFIC_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "consts.h"
+#include "structs.h"
+
+// ==================================================================
+//                    STRUCTURES DEFINITION
+// ==================================================================
+// State of a random stream
+typedef struct {
+	uint64_t s[4];
+} rng_t;
+
+// Arrival process of the spawns
+enum traffic_model {
+	TRAFFIC_POISSON,	// constant rate, exponential inter-arrival times
+	TRAFFIC_BANKS,		// periodic banks of spawns, as at a hub airport
+	TRAFFIC_PROFILE		// rate following a time of day profile
+};
+
+// Parameters of the traffic. The mean rate is the same for all the models
+typedef struct {
+	enum traffic_model model;
+	float rate_h;						// mean spawns per hour
+	float inbound_ratio;				// fraction of inbound spawns
+	float bank_period_s;				// time between two banks
+	float bank_width_s;					// spread of the spawns of a bank
+	float hour_s;						// simulated seconds per profile hour
+	float start_hour;					// time of day at the start
+	// Rate of each hour relative to the mean rate
+	float profile[TRAFFIC_PROFILE_HOURS];
+} traffic_params_t;
+
+// Generator of the spawn times. Times are in seconds from the start of
+// the simulation
+typedef struct {
+	traffic_params_t params;
+	rng_t rng;
+	double next_s;						// time of the next spawn
+	float peak;							// max of the profile
+	long bank;							// index of the current bank
+	int bank_left;						// spawns left in the current bank
+	long n_generated;					// numb. of generated spawns
+} traffic_gen_t;
+
+
+// ==================================================================
+//                    FUNCTION DEFINITION
+// ==================================================================
+// Random streams
+void rng_init(rng_t* rng, uint64_t seed, uint64_t stream);
+uint64_t rng_next(rng_t* rng);
+double rng_uniform(rng_t* rng);
+float rng_uniformf(rng_t* rng);
+double rng_exponential(rng_t* rng, double rate);
+
+// Traffic generator
+void traffic_params_init(traffic_params_t* params);
+int traffic_parse_model(const char* name, enum traffic_model* model);
+const char* traffic_model_name(enum traffic_model model);
+void traffic_init(traffic_gen_t* gen, const traffic_params_t* params,
+	uint64_t seed);
+void traffic_start(traffic_gen_t* gen, double t_s);
+bool traffic_next(traffic_gen_t* gen, double until_s,
+	enum airplane_status* kind);
+
+#endif
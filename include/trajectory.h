@@ -0,0 +1,119 @@
+/*
+ * trajectory.h
+ *
+ * Desired trajectories of the airplanes. The points of all the
+ * trajectories of a simulation are stored in an arena, one array per
+ * field, so each trajectory takes only the space of its points and its
+ * fields are read sequentially. The length and the heading of the leg
+ * that starts at each point are computed when the point is appended.
+ * The trajectories that can be replaced at runtime are grouped in sets,
+ * each stored in a bank of the arena that is reused as a whole
+ */
+
+#ifndef _TRAJECTORY_H_
+#define _TRAJECTORY_H_
+
+#include <stdbool.h>
+
+#include "consts.h"
+
+// ==================================================================
+//                         ENUM DEFINITION
+// ==================================================================
+// Reservable segments of a trajectory. Approach is the taxi route for the
+// departures, exit is the climb-out for the departures
+enum trajectory_segment {
+	SEGMENT_APPROACH,
+	SEGMENT_RUNWAY,
+	SEGMENT_EXIT
+};
+#define N_SEGMENTS	(SEGMENT_EXIT + 1)
+
+// ==================================================================
+//                    STRUCTURES DEFINITION
+// ==================================================================
+// Point of the desired trajectory that an airplane has to follow
+typedef struct {
+	float x;		// x cartesian coordinate
+	float y;		// y cartesian coordinate
+	float vel;		// velocity
+} waypoint_t;
+
+// Desired trajectory that an airplane has to follow. The arrays are in the
+// arena and start on a TRAJ_ARENA_ALIGN boundary
+typedef struct {
+	int id;								// index in the arena
+	int size;							// number of points in the trajectory
+	int capacity;						// max number of points
+	bool is_cyclic;						// true if the trajectory is cyclic
+	bool is_writable;					// false once sealed
+	int segment_start[N_SEGMENTS];		// index of the first point of a segment
+	float* x;
+	float* y;
+	float* vel;
+	float* length;						// length of the leg to the next point
+	float* heading;						// heading of the leg to the next point
+} trajectory_t;
+
+// Storage of the trajectories of a simulation. The trajectories are
+// allocated at the initialization and never freed; the ones that are
+// rebuilt at runtime reuse their space
+typedef struct {
+	float data[TRAJ_ARENA_FLOATS] __attribute__((aligned(TRAJ_ARENA_ALIGN)));
+	int n_used;							// numb. of allocated floats
+	trajectory_t trajs[TRAJ_ARENA_MAX_TRAJS];
+	int n_trajs;
+} traj_arena_t;
+
+// Part of the arena whose trajectories are released together
+typedef struct {
+	traj_arena_t* arena;
+	int first_float;					// offset of the bank in the arena
+	int n_floats;						// size of the bank
+	int used_floats;
+	int first_traj;						// index of the first trajectory
+	int n_trajs;						// max numb. of trajectories
+	int used_trajs;
+} traj_bank_t;
+
+// Trajectories of the runways and of the holding stacks. A set is never
+// changed once published: a new set replaces it as a whole
+typedef struct {
+	int version;						// incremented at each replacement
+	const trajectory_t* exit[MAX_RUNWAYS];		// route after the rollout
+	const trajectory_t* departure[MAX_RUNWAYS];	// takeoff roll and climb-out
+	const trajectory_t* landing[MAX_RUNWAYS];	// approach, rollout and exit
+	const trajectory_t* holding[MAX_HOLDING_STACKS];
+	bool is_in_use[MAX_RUNWAYS];		// runways assigned to new airplanes
+} traj_set_t;
+
+
+// ==================================================================
+//                    FUNCTION DEFINITION
+// ==================================================================
+// Arena
+void traj_arena_init(traj_arena_t* arena);
+trajectory_t* traj_arena_alloc(traj_arena_t* arena, int capacity,
+	bool is_cyclic);
+int traj_arena_reserve(traj_arena_t* arena, traj_bank_t* bank,
+	int max_points, int max_trajs);
+
+// Bank
+trajectory_t* traj_bank_alloc(traj_bank_t* bank, int capacity, bool is_cyclic);
+void traj_bank_reset(traj_bank_t* bank);
+bool traj_bank_contains(const traj_bank_t* bank,
+	const trajectory_t* trajectory);
+
+// Trajectory
+void trajectory_clear(trajectory_t* trajectory);
+int trajectory_append(trajectory_t* trajectory, waypoint_t point,
+	enum trajectory_segment segment);
+void trajectory_seal(trajectory_t* trajectory);
+bool trajectory_get_point(const trajectory_t* trajectory, int index,
+	waypoint_t* point);
+enum trajectory_segment trajectory_get_segment(const trajectory_t* trajectory,
+	int index);
+float trajectory_leg_length(const trajectory_t* trajectory, int index);
+float trajectory_leg_heading(const trajectory_t* trajectory, int index);
+
+#endif
@@ -0,0 +1,109 @@
+/*
+ * spatial_bench.c
+ *
+ * Benchmark of the separation check: all the pairs against the spatial
+ * hash grid. The airplanes are placed at random with a constant density,
+ * so the area grows with their number as a larger airspace would.
+ *
+ * Build: make spatial_bench
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+
+#include "spatial.h"
+
+#define BENCH_AREA_PER_AIRPLANE	1600.0f		// 40 x 40 per airplane
+#define BENCH_MIN_TIME_US		200000L		// min measured time per size
+
+static spatial_entry_t entries[SPATIAL_MAX_POINTS];
+static spatial_grid_t grid;
+static separation_violation_t violations[MAX_SEPARATION_VIOLATIONS];
+static const int sizes[] = { 100, 300, 1000, 3000, 10000 };
+
+// Return the time elapsed since "start" in microseconds
+long elapsed_us(const struct timespec* start) {
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - start->tv_sec) * 1000000L +
+		(now.tv_nsec - start->tv_nsec) / 1000L;
+}
+
+// Count the pairs closer than min_dist comparing all of them
+int naive_violations(const spatial_entry_t* e, int n, float min_dist) {
+	int count = 0;
+	int i, j;
+	float dx, dy;
+
+	for (i = 0; i < n; ++i) {
+		for (j = i + 1; j < n; ++j) {
+			dx = e[i].x - e[j].x;
+			dy = e[i].y - e[j].y;
+			if (dx*dx + dy*dy < min_dist * min_dist) ++count;
+		}
+	}
+	return count;
+}
+
+// Count the pairs closer than min_dist rebuilding the grid
+int grid_violations(const spatial_entry_t* e, int n, float min_dist) {
+	spatial_grid_build(&grid, e, n);
+	return spatial_grid_violations(&grid, min_dist, violations,
+		MAX_SEPARATION_VIOLATIONS);
+}
+
+// Return the mean time of a check in microseconds, repeating it for at
+// least BENCH_MIN_TIME_US. The number of violations is stored in "count"
+double measure(int (*check)(const spatial_entry_t*, int, float), int n,
+		int* count) {
+	struct timespec start;
+	long runs = 0;
+	long t = 0;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	do {
+		*count = check(entries, n, SEPARATION_MIN_DIST);
+		++runs;
+		t = elapsed_us(&start);
+	} while (t < BENCH_MIN_TIME_US);
+	return (double) t / (double) runs;
+}
+
+int main(void) {
+	const int n_sizes = (int) (sizeof(sizes) / sizeof(sizes[0]));
+	float side = 0.0f;
+	double naive_us, grid_us;
+	int naive_count, grid_count;
+	int i, k, n;
+
+	srand(1);
+	printf("%8s %12s %12s %10s %12s\n", "airplanes", "naive [us]",
+		"grid [us]", "speedup", "violations");
+
+	for (k = 0; k < n_sizes; ++k) {
+		n = sizes[k];
+		side = sqrtf(BENCH_AREA_PER_AIRPLANE * (float) n);
+		for (i = 0; i < n; ++i) {
+			entries[i].x = side * ((float) rand() / (float) RAND_MAX - 0.5f);
+			entries[i].y = side * ((float) rand() / (float) RAND_MAX - 0.5f);
+			entries[i].id = i;
+		}
+		if (spatial_grid_init(&grid, -0.5f * side, -0.5f * side, side, side,
+				SEPARATION_MIN_DIST) != SUCCESS)
+			return EXIT_FAILURE;
+
+		naive_us = measure(naive_violations, n, &naive_count);
+		grid_us = measure(grid_violations, n, &grid_count);
+		if (naive_count != grid_count) {
+			fprintf(stderr, "Mismatch with %d airplanes: %d != %d\n",
+				n, naive_count, grid_count);
+			return EXIT_FAILURE;
+		}
+		printf("%8d %12.1f %12.1f %10.1f %12d\n", n, naive_us, grid_us,
+			naive_us / grid_us, grid_count);
+	}
+	return EXIT_SUCCESS;
+}
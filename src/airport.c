@@ -0,0 +1,314 @@
+/*
+ * airport.c
+ *
+ * Loading of the airport layout from a text file. Each non empty line
+ * that doesn't start with '#' is one of the following:
+ *
+ *   runway <thr. x> <thr. y> <heading deg> <approach len> <rollout len>
+ *          <landing points> <rollout vel>
+ *   exit <x> <y> <vel>
+ *   entry <node>
+ *   takeoff <x> <y> <vel>
+ *   climb <x> <y> <vel>
+ *   holding <x> <y>
+ *   node <x> <y>
+ *   edge <node> <node>
+ *   gate <node>
+ *
+ * An exit line appends a point to the route that leaves the last declared
+ * runway after a landing. The entry line sets the taxiway node where the
+ * takeoff roll of the last runway starts, the takeoff and climb lines
+ * append a point to the corresponding segment of its departure route.
+ * The routes of a runway are stored in a trajectory bank when the next
+ * runway is declared.
+ * A holding line adds a holding stack centered in (x, y).
+ * The node lines add the taxiway nodes, numbered from 0 in order of
+ * declaration, the edge lines connect them and the gate lines mark the
+ * nodes where the outbound airplanes wait
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "airport.h"
+
+// ==================================================================
+//                        ERROR MESSAGES
+// ==================================================================
+#define ERR_MSG_AIRPORT_OPEN	"Error while opening the airport file %s\n"
+#define ERR_MSG_AIRPORT_LINE	"Airport file %s, line %d: %s\n"
+#define ERR_MSG_AIRPORT_EMPTY	"Airport file %s: %s\n"
+
+#define AIRPORT_LINE_LENGTH		256
+#define AIRPORT_KEYWORD_LENGTH	16
+
+// Route of the last declared runway, not stored yet
+typedef struct {
+	waypoint_t points[MAX_WAYPOINTS];
+	enum trajectory_segment segments[MAX_WAYPOINTS];
+	int size;
+} _route_t;
+
+// ==================================================================
+//                         AIRPORT LOADING
+// ==================================================================
+// Store the routes of the last runway in the bank and clear them.
+// Return NULL on success, otherwise the error message
+const char* _store_routes(const airport_t* airport, traj_bank_t* bank,
+		traj_set_t* set, _route_t* exit_route, _route_t* departure_route) {
+	const int runway_id = airport->n_runways - 1;
+	_route_t* routes[2] = {exit_route, departure_route};
+	trajectory_t* trajs[2] = {NULL, NULL};
+	int i = 0;
+	int j = 0;
+
+	for (i = 0; i < 2; ++i) {
+		// an empty route keeps its place, the departures are checked later
+		trajs[i] = traj_bank_alloc(bank, routes[i]->size > 0 ?
+			routes[i]->size : 1, false);
+		if (!trajs[i])
+			return "trajectory bank full";
+		for (j = 0; j < routes[i]->size; ++j)
+			trajectory_append(trajs[i], routes[i]->points[j],
+				routes[i]->segments[j]);
+		trajectory_seal(trajs[i]);
+		routes[i]->size = 0;
+	}
+	set->exit[runway_id] = trajs[0];
+	set->departure[runway_id] = trajs[1];
+	return NULL;
+}
+
+// Parse a runway line into a new runway, after storing the routes of the
+// previous one. Return NULL on success, otherwise the error message
+const char* _parse_runway(airport_t* airport, traj_bank_t* bank,
+		traj_set_t* set, _route_t* exit_route, _route_t* departure_route,
+		const char* line) {
+	runway_t* runway = NULL;
+	float heading_deg = 0.0f;
+	const char* err = NULL;
+
+	if (airport->n_runways >= MAX_RUNWAYS)
+		return "too many runways";
+	if (airport->n_runways > 0)
+		err = _store_routes(airport, bank, set, exit_route, departure_route);
+	if (err != NULL)
+		return err;
+
+	runway = &airport->runways[airport->n_runways];
+	if (sscanf(line, "%*s %f %f %f %f %f %d %f", &runway->threshold_x,
+			&runway->threshold_y, &heading_deg, &runway->approach_length,
+			&runway->rollout_length, &runway->landing_size,
+			&runway->rollout_vel) != 7)
+		return "malformed runway";
+	if (runway->landing_size < 2 || runway->landing_size > MAX_WAYPOINTS)
+		return "invalid number of landing points";
+
+	runway->heading = heading_deg * M_PI_F / 180.0f;
+	runway->entry_node = -1;
+	++airport->n_runways;
+	return NULL;
+}
+
+// Parse a point of a route of the last runway. The point is appended to
+// the provided segment of "route". Return NULL on success, otherwise the
+// error message
+const char* _parse_route_point(const airport_t* airport, const char* line,
+		_route_t* route, bool is_exit, enum trajectory_segment segment) {
+	waypoint_t point;
+	int max_size = MAX_WAYPOINTS;
+
+	if (airport->n_runways == 0)
+		return "route point before any runway";
+	if (sscanf(line, "%*s %f %f %f", &point.x, &point.y, &point.vel) != 3)
+		return "malformed route point";
+
+	// the exit follows the landing points
+	if (is_exit)
+		max_size -= airport->runways[airport->n_runways - 1].landing_size;
+	if (route->size >= max_size)
+		return "too many route points";
+	if (route->size > 0 && route->segments[route->size - 1] > segment)
+		return "route segments out of order";
+
+	route->points[route->size] = point;
+	route->segments[route->size++] = segment;
+	return NULL;
+}
+
+// Parse a holding line into a new holding stack. Return NULL on success,
+// otherwise the error message
+const char* _parse_holding(airport_t* airport, const char* line) {
+	holding_fix_t* fix = NULL;
+
+	if (airport->n_holdings >= MAX_HOLDING_STACKS)
+		return "too many holding stacks";
+
+	fix = &airport->holdings[airport->n_holdings];
+	if (sscanf(line, "%*s %f %f", &fix->x, &fix->y) != 2)
+		return "malformed holding stack";
+
+	++airport->n_holdings;
+	return NULL;
+}
+
+// Parse a taxiway line (node, edge, gate or entry). Return NULL on
+// success, otherwise the error message
+const char* _parse_taxiway(airport_t* airport, const char* keyword,
+		const char* line) {
+	taxiway_t* taxiway = &airport->taxiway;
+	float x, y;
+	int a, b;
+
+	if (strcmp(keyword, "node") == 0) {
+		if (sscanf(line, "%*s %f %f", &x, &y) != 2)
+			return "malformed node";
+		if (taxiway_add_node(taxiway, x, y) < 0)
+			return "too many taxiway nodes";
+	} else if (strcmp(keyword, "edge") == 0) {
+		if (sscanf(line, "%*s %d %d", &a, &b) != 2)
+			return "malformed edge";
+		if (taxiway_add_edge(taxiway, a, b) != SUCCESS)
+			return "invalid edge or too many edges";
+	} else {
+		if (sscanf(line, "%*s %d", &a) != 1 || a < 0 || a >= taxiway->n_nodes)
+			return "invalid node";
+		if (strcmp(keyword, "entry") == 0) {
+			if (airport->n_runways == 0)
+				return "entry before any runway";
+			airport->runways[airport->n_runways - 1].entry_node = a;
+		} else {
+			if (airport->n_gates >= MAX_GATES)
+				return "too many gates";
+			airport->gates[airport->n_gates++] = a;
+		}
+	}
+	return NULL;
+}
+
+// Check that each runway can be reached from each gate with a departure
+// trajectory that fits MAX_WAYPOINTS. Return NULL on success, otherwise
+// the error message
+const char* _check_departures(const airport_t* airport,
+		const traj_set_t* set) {
+	const runway_t* runway = NULL;
+	const trajectory_t* departure = NULL;
+	taxi_route_t route;
+	int i = 0;
+	int j = 0;
+
+	if (airport->n_gates == 0)
+		return "no gates";
+	for (i = 0; i < airport->n_runways; ++i) {
+		runway = &airport->runways[i];
+		departure = set->departure[i];
+		if (departure->size == 0 || runway->entry_node < 0)
+			return "runway without departure route";
+		for (j = 0; j < airport->n_gates; ++j) {
+			if (taxiway_route(&airport->taxiway, airport->gates[j],
+					runway->entry_node, &route) < 0)
+				return "runway entry not reachable from a gate";
+			if (route.n_nodes + departure->size > MAX_WAYPOINTS)
+				return "departure trajectory too long";
+		}
+	}
+	return NULL;
+}
+
+// Load the airport layout from the file at the provided path. The routes
+// of the runways are stored in "bank" and put in "set".
+// ERROR_GENERIC is returned if the file can't be read or is malformed
+int airport_load(airport_t* airport, const char* path, traj_bank_t* bank,
+		traj_set_t* set) {
+	FILE* file = NULL;
+	char line[AIRPORT_LINE_LENGTH];
+	char keyword[AIRPORT_KEYWORD_LENGTH];
+	const char* err = NULL;		// error message of the current line
+	int line_num = 0;
+	_route_t exit_route = {.size = 0};		// routes of the last runway
+	_route_t departure_route = {.size = 0};
+
+	file = fopen(path, "r");
+	if (file == NULL) {
+		fprintf(stderr, ERR_MSG_AIRPORT_OPEN, path);
+		return ERROR_GENERIC;
+	}
+
+	airport->n_runways = 0;
+	airport->n_holdings = 0;
+	airport->n_gates = 0;
+	taxiway_init(&airport->taxiway);
+	while (err == NULL && fgets(line, sizeof(line), file) != NULL) {
+		++line_num;
+		if (sscanf(line, "%15s", keyword) != 1 || keyword[0] == '#')
+			continue;
+
+		if (strcmp(keyword, "runway") == 0)
+			err = _parse_runway(airport, bank, set, &exit_route,
+				&departure_route, line);
+		else if (strcmp(keyword, "exit") == 0)
+			err = _parse_route_point(airport, line, &exit_route, true,
+				SEGMENT_EXIT);
+		else if (strcmp(keyword, "takeoff") == 0)
+			err = _parse_route_point(airport, line, &departure_route, false,
+				SEGMENT_RUNWAY);
+		else if (strcmp(keyword, "climb") == 0)
+			err = _parse_route_point(airport, line, &departure_route, false,
+				SEGMENT_EXIT);
+		else if (strcmp(keyword, "holding") == 0)
+			err = _parse_holding(airport, line);
+		else if (strcmp(keyword, "node") == 0 || strcmp(keyword, "edge") == 0 ||
+				strcmp(keyword, "gate") == 0 || strcmp(keyword, "entry") == 0)
+			err = _parse_taxiway(airport, keyword, line);
+		else
+			err = "unknown keyword";
+	}
+	fclose(file);
+
+	if (err != NULL) {
+		fprintf(stderr, ERR_MSG_AIRPORT_LINE, path, line_num, err);
+		return ERROR_GENERIC;
+	}
+
+	if (airport->n_runways == 0) {
+		fprintf(stderr, ERR_MSG_AIRPORT_EMPTY, path, "no runways");
+		return ERROR_GENERIC;
+	}
+	err = _store_routes(airport, bank, set, &exit_route, &departure_route);
+	if (err != NULL) {
+		fprintf(stderr, ERR_MSG_AIRPORT_EMPTY, path, err);
+		return ERROR_GENERIC;
+	}
+	if (airport->n_holdings == 0) {
+		fprintf(stderr, ERR_MSG_AIRPORT_EMPTY, path, "no holding stacks");
+		return ERROR_GENERIC;
+	}
+
+	// Each runway must be reachable from each gate
+	taxiway_compute_routes(&airport->taxiway);
+	err = _check_departures(airport, set);
+	if (err != NULL) {
+		fprintf(stderr, ERR_MSG_AIRPORT_EMPTY, path, err);
+		return ERROR_GENERIC;
+	}
+
+	return SUCCESS;
+}
+
+// ==================================================================
+//                         RUNWAY GEOMETRY
+// ==================================================================
+// Compute the first point of the landing trajectory, approach_length
+// before the threshold
+void runway_landing_start(const runway_t* runway, float* x, float* y) {
+	*x = runway->threshold_x - runway->approach_length * cosf(runway->heading);
+	*y = runway->threshold_y - runway->approach_length * sinf(runway->heading);
+}
+
+// Compute the last point of the landing trajectory, rollout_length
+// after the threshold
+void runway_landing_end(const runway_t* runway, float* x, float* y) {
+	*x = runway->threshold_x + runway->rollout_length * cosf(runway->heading);
+	*y = runway->threshold_y + runway->rollout_length * sinf(runway->heading);
+}
@@ -0,0 +1,394 @@
+/*
+ * batch.c
+ *
+ * Monte Carlo runner used for capacity planning. Every combination of
+ * arrival rate, runway count and sequencing policy is simulated with
+ * several seeds; the runs are independent headless simulations executed
+ * as fast as possible by a pool of worker threads, one per core by
+ * default. The results are aggregated per combination
+ */
+
+#include <stdbool.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+
+#include "simulation.h"
+#include "consts.h"
+
+#define BATCH_USAGE		"Usage: %s [-a airport_file] [-d seconds] " \
+	"[-t poisson|banks|profile] [-r rates] [-n runways] [-p fcfs,optimal] " \
+	"[-s seeds] [-S first_seed] [-j workers]\n"
+#define BATCH_MAX_VALUES	16			// values of a swept parameter
+#define BATCH_MAX_WORKERS	256
+#define BATCH_SEEDS			8			// runs of each combination
+#define BATCH_DURATION_S	1800		// simulated time of a run
+#define BATCH_RATES			"600,1200,1800"
+#define BATCH_RUNWAYS		"0"			// all the runways of the airport
+#define BATCH_POLICIES		"fcfs,optimal"
+
+// ==================================================================
+//                    STRUCTURES DEFINITION
+// ==================================================================
+// Parameters swept by the batch
+typedef struct {
+	sim_config_t base;					// common parameters of the runs
+	float rates[BATCH_MAX_VALUES];
+	int n_rates;
+	int runways[BATCH_MAX_VALUES];
+	int n_runways;
+	enum sequencer_policy policies[BATCH_MAX_VALUES];
+	int n_policies;
+	int n_seeds;
+	uint64_t first_seed;
+	int n_workers;
+} batch_t;
+
+// Outcome of a single run
+typedef struct {
+	sim_config_t config;
+	sim_results_t results;
+	bool failed;
+} batch_run_t;
+
+// Runs shared by the workers
+typedef struct {
+	batch_run_t* runs;
+	int n_runs;
+	int next_run;					// index of the first run to execute
+	int n_done;
+	pthread_mutex_t mutex;
+} batch_queue_t;
+
+// Mean and standard deviation of a metric
+typedef struct {
+	double sum;
+	double sum_sq;
+	int n;
+} batch_stat_t;
+
+
+// ==================================================================
+//                      FUNCTIONS DECLARATION
+// ==================================================================
+void parse_batch_options(int argc, char* argv[], batch_t* batch);
+int parse_float_list(const char* arg, float* values);
+int parse_int_list(const char* arg, int* values);
+int parse_policy_list(const char* arg, enum sequencer_policy* values);
+int parse_positive(const char* arg, const char* argv0);
+void init_runs(const batch_t* batch, batch_queue_t* queue);
+void* batch_worker(void* arg);
+void print_summary(const batch_t* batch, const batch_queue_t* queue);
+
+
+// ==================================================================
+//                    			MAIN
+// ==================================================================
+int main(int argc, char* argv[]) {
+	batch_t batch;
+	batch_queue_t queue;
+	pthread_t workers[BATCH_MAX_WORKERS];
+	int n_started = 0;
+	int i = 0;
+
+	parse_batch_options(argc, argv, &batch);
+	init_runs(&batch, &queue);
+	if (!queue.runs) {
+		fprintf(stderr, "Can't allocate %d runs\n", queue.n_runs);
+		return EXIT_FAILURE;
+	}
+	if (batch.n_workers > queue.n_runs) batch.n_workers = queue.n_runs;
+	fprintf(stderr, "Running %d simulations of %d s of %s traffic on %d workers\n",
+		queue.n_runs, batch.base.duration_s,
+		traffic_model_name(batch.base.traffic.model), batch.n_workers);
+
+	for (i = 0; i < batch.n_workers; ++i) {
+		if (pthread_create(&workers[i], NULL, batch_worker, &queue) != 0) {
+			fprintf(stderr, "Error while creating worker %d\n", i);
+			break;
+		}
+		++n_started;
+	}
+	for (i = 0; i < n_started; ++i)
+		pthread_join(workers[i], NULL);
+	fprintf(stderr, "\n");
+
+	print_summary(&batch, &queue);
+	free(queue.runs);
+	return n_started > 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+
+// ==================================================================
+//                           OPTIONS
+// ==================================================================
+// Read the swept parameters from the command line. Exit on invalid options
+void parse_batch_options(int argc, char* argv[], batch_t* batch) {
+	const char* rates = BATCH_RATES;
+	const char* runways = BATCH_RUNWAYS;
+	const char* policies = BATCH_POLICIES;
+	long n_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	int opt = 0;
+
+	sim_config_init(&batch->base);
+	batch->base.clock_mode = SIM_CLOCK_AFAP;
+	batch->base.random_gen = true;
+	batch->base.duration_s = BATCH_DURATION_S;
+	batch->base.verbose = false;
+	batch->n_seeds = BATCH_SEEDS;
+	batch->first_seed = 1;
+	batch->n_workers = (n_cpus > 0) ? (int) n_cpus : 1;
+
+	while ((opt = getopt(argc, argv, "a:d:t:r:n:p:s:S:j:")) != -1) {
+		switch (opt) {
+			case 'a':
+				batch->base.airport_file = optarg;
+				break;
+			case 'd':
+				batch->base.duration_s = parse_positive(optarg, argv[0]);
+				break;
+			case 't':
+				if (traffic_parse_model(optarg, &batch->base.traffic.model) !=
+						SUCCESS) {
+					fprintf(stderr, BATCH_USAGE, argv[0]);
+					exit(EXIT_FAILURE);
+				}
+				break;
+			case 'r':
+				rates = optarg;
+				break;
+			case 'n':
+				runways = optarg;
+				break;
+			case 'p':
+				policies = optarg;
+				break;
+			case 's':
+				batch->n_seeds = parse_positive(optarg, argv[0]);
+				break;
+			case 'S':
+				batch->first_seed = (uint64_t) parse_positive(optarg, argv[0]);
+				break;
+			case 'j':
+				batch->n_workers = parse_positive(optarg, argv[0]);
+				break;
+			default:
+				fprintf(stderr, BATCH_USAGE, argv[0]);
+				exit(EXIT_FAILURE);
+		}
+	}
+
+	batch->n_rates = parse_float_list(rates, batch->rates);
+	batch->n_runways = parse_int_list(runways, batch->runways);
+	batch->n_policies = parse_policy_list(policies, batch->policies);
+	if (optind < argc || batch->n_rates <= 0 || batch->n_runways <= 0 ||
+			batch->n_policies <= 0) {
+		fprintf(stderr, BATCH_USAGE, argv[0]);
+		exit(EXIT_FAILURE);
+	}
+	if (batch->n_workers > BATCH_MAX_WORKERS)
+		batch->n_workers = BATCH_MAX_WORKERS;
+}
+
+// Parse a comma separated list of non negative numbers.
+// Return the number of values or ERROR_GENERIC
+int parse_float_list(const char* arg, float* values) {
+	char* end = NULL;
+	int n = 0;
+
+	do {
+		if (n == BATCH_MAX_VALUES) return ERROR_GENERIC;
+		values[n] = strtof(arg, &end);
+		if (end == arg || values[n] < 0.0f || (*end != ',' && *end != '\0')) {
+			fprintf(stderr, "Invalid list: %s\n", arg);
+			return ERROR_GENERIC;
+		}
+		++n;
+		arg = end + 1;
+	} while (*end == ',');
+	return n;
+}
+
+// Parse a comma separated list of non negative integers.
+// Return the number of values or ERROR_GENERIC
+int parse_int_list(const char* arg, int* values) {
+	char* end = NULL;
+	long value = 0;
+	int n = 0;
+
+	do {
+		if (n == BATCH_MAX_VALUES) return ERROR_GENERIC;
+		value = strtol(arg, &end, 10);
+		if (end == arg || value < 0 || value > MAX_RUNWAYS ||
+				(*end != ',' && *end != '\0')) {
+			fprintf(stderr, "Invalid list: %s\n", arg);
+			return ERROR_GENERIC;
+		}
+		values[n++] = (int) value;
+		arg = end + 1;
+	} while (*end == ',');
+	return n;
+}
+
+// Parse a comma separated list of sequencing policies.
+// Return the number of policies or ERROR_GENERIC
+int parse_policy_list(const char* arg, enum sequencer_policy* values) {
+	size_t len = 0;
+	int n = 0;
+
+	do {
+		if (n == BATCH_MAX_VALUES) return ERROR_GENERIC;
+		len = strcspn(arg, ",");
+		if (len == 4 && strncmp(arg, "fcfs", len) == 0) {
+			values[n++] = SEQUENCER_FCFS;
+		} else if (len == 7 && strncmp(arg, "optimal", len) == 0) {
+			values[n++] = SEQUENCER_OPTIMAL;
+		} else {
+			fprintf(stderr, "Invalid policy list: %s\n", arg);
+			return ERROR_GENERIC;
+		}
+		arg += len;
+	} while (*arg++ == ',');
+	return n;
+}
+
+// Return the positive integer in "arg". Exit if it is not valid
+int parse_positive(const char* arg, const char* argv0) {
+	char* end = NULL;
+	long value = strtol(arg, &end, 10);
+
+	if (end == arg || *end != '\0' || value <= 0 || value > INT32_MAX) {
+		fprintf(stderr, "Invalid number: %s\n", arg);
+		fprintf(stderr, BATCH_USAGE, argv0);
+		exit(EXIT_FAILURE);
+	}
+	return (int) value;
+}
+
+
+// ==================================================================
+//                             RUNS
+// ==================================================================
+// Allocate the runs: the seeds of a combination are consecutive
+void init_runs(const batch_t* batch, batch_queue_t* queue) {
+	batch_run_t* run = NULL;
+	int r, w, p, s;
+
+	queue->n_runs = batch->n_rates * batch->n_runways * batch->n_policies *
+		batch->n_seeds;
+	queue->next_run = 0;
+	queue->n_done = 0;
+	pthread_mutex_init(&queue->mutex, NULL);
+	queue->runs = calloc((size_t) queue->n_runs, sizeof(batch_run_t));
+	if (!queue->runs) return;
+
+	run = queue->runs;
+	for (r = 0; r < batch->n_rates; ++r) {
+		for (w = 0; w < batch->n_runways; ++w) {
+			for (p = 0; p < batch->n_policies; ++p) {
+				for (s = 0; s < batch->n_seeds; ++s) {
+					run->config = batch->base;
+					run->config.traffic.rate_h = batch->rates[r];
+					run->config.n_runways = batch->runways[w];
+					run->config.policy = batch->policies[p];
+					run->config.seed = batch->first_seed + (uint64_t) s;
+					++run;
+				}
+			}
+		}
+	}
+}
+
+// Execute the runs not yet taken by the other workers
+void* batch_worker(void* arg) {
+	batch_queue_t* queue = (batch_queue_t*) arg;
+	batch_run_t* run = NULL;
+	int i = 0;
+
+	while (true) {
+		pthread_mutex_lock(&queue->mutex);
+		i = queue->next_run++;
+		pthread_mutex_unlock(&queue->mutex);
+		if (i >= queue->n_runs) break;
+
+		run = &queue->runs[i];
+		run->failed = (sim_run(&run->config, &run->results) != SUCCESS);
+
+		pthread_mutex_lock(&queue->mutex);
+		++queue->n_done;
+		fprintf(stderr, "\r%d/%d runs", queue->n_done, queue->n_runs);
+		pthread_mutex_unlock(&queue->mutex);
+	}
+	return NULL;
+}
+
+
+// ==================================================================
+//                           SUMMARY
+// ==================================================================
+void _stat_add(batch_stat_t* stat, double value) {
+	stat->sum += value;
+	stat->sum_sq += value * value;
+	++stat->n;
+}
+
+double _stat_mean(const batch_stat_t* stat) {
+	return stat->n > 0 ? stat->sum / stat->n : 0.0;
+}
+
+// Return the sample standard deviation
+double _stat_stddev(const batch_stat_t* stat) {
+	double var = 0.0;
+
+	if (stat->n < 2) return 0.0;
+	var = (stat->sum_sq - stat->sum * stat->sum / stat->n) / (stat->n - 1);
+	return var > 0.0 ? sqrt(var) : 0.0;
+}
+
+// Print the aggregated results of each combination of the parameters
+void print_summary(const batch_t* batch, const batch_queue_t* queue) {
+	const batch_run_t* run = NULL;
+	batch_stat_t throughput, delay, loss;
+	double max_delay = 0.0;
+	int n_failed = 0;
+	int c, s;
+
+	printf("\n%8s %7s %8s %6s %18s %18s %9s %14s\n", "Rate/h", "Runways",
+		"Policy", "Runs", "Throughput/h", "Mean delay s", "Max delay",
+		"Sep. loss %");
+
+	for (c = 0; c < queue->n_runs; c += batch->n_seeds) {
+		memset(&throughput, 0, sizeof(throughput));
+		memset(&delay, 0, sizeof(delay));
+		memset(&loss, 0, sizeof(loss));
+		max_delay = 0.0;
+		n_failed = 0;
+
+		for (s = 0; s < batch->n_seeds; ++s) {
+			run = &queue->runs[c + s];
+			if (run->failed) {
+				++n_failed;
+				continue;
+			}
+			_stat_add(&throughput, run->results.throughput_h);
+			_stat_add(&delay, run->results.mean_delay_s);
+			_stat_add(&loss, 100.0 * run->results.separation_loss);
+			if (run->results.max_delay_s > max_delay)
+				max_delay = run->results.max_delay_s;
+		}
+
+		run = &queue->runs[c];
+		printf("%8.0f %7d %8s %6d %9.1f +- %5.1f %9.1f +- %5.1f %9.1f "
+			"%6.2f +- %4.2f\n", (double) run->config.traffic.rate_h,
+			run->config.n_runways,
+			run->config.policy == SEQUENCER_FCFS ? "fcfs" : "optimal",
+			batch->n_seeds - n_failed,
+			_stat_mean(&throughput), _stat_stddev(&throughput),
+			_stat_mean(&delay), _stat_stddev(&delay), max_delay,
+			_stat_mean(&loss), _stat_stddev(&loss));
+	}
+}
@@ -0,0 +1,649 @@
+/*
+ * checkpoint.c
+ *
+ * Save and restore of the whole state of a simulation. The image is
+ * captured while the jobs that change the state are held at the job gate
+ * of the simulation, so it is consistent without stopping the tasks.
+ * A restore is done by sim_init, before the tasks are created
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "checkpoint.h"
+
+// ==================================================================
+//                        ERROR MESSAGES
+// ==================================================================
+#define ERR_MSG_CHECKPOINT_ALLOC	"Can't allocate the checkpoint image\n"
+#define ERR_MSG_CHECKPOINT_WRITE	"Can't write the checkpoint %s: %s\n"
+#define ERR_MSG_CHECKPOINT_READ		"Can't read the checkpoint %s: %s\n"
+#define ERR_MSG_CHECKPOINT_FORMAT	"Invalid checkpoint %s: %s\n"
+
+#define CHECKPOINT_TMP_SUFFIX		".tmp"
+
+
+// ==================================================================
+//                       		IDS
+// ==================================================================
+// Return the pool slot of an airplane, -1 for NULL
+int32_t _airplane_ref(const shared_airplane_t* airplane) {
+	return airplane ? (int32_t) airplane->airplane.unique_id : -1;
+}
+
+// Return the airplane of a pool slot, NULL if the slot is not valid
+shared_airplane_t* _airplane_resolve(sim_context_t* ctx, int32_t ref) {
+	if (ref < 0 || ref >= AIRPLANE_POOL_SIZE) return NULL;
+	return &ctx->airplane_pool.elems[ref];
+}
+
+
+// ==================================================================
+//                            CAPTURE
+// ==================================================================
+// Copy the airplanes of the pool. The times are saved as offsets from the
+// checkpoint, so they follow the clock of the restored simulation
+void _capture_airplanes(sim_context_t* ctx, checkpoint_image_t* image,
+		const struct timespec* now) {
+	checkpoint_airplane_t* dst = NULL;
+	shared_airplane_t* src = NULL;
+	int i = 0;
+
+	for (i = 0; i < AIRPLANE_POOL_SIZE; ++i) {
+		dst = &image->airplanes[i];
+		src = &ctx->airplane_pool.elems[i];
+		pthread_mutex_lock(&ctx->airplane_pool.mutex);
+		dst->is_free = ctx->airplane_pool.is_free[i];
+		pthread_mutex_unlock(&ctx->airplane_pool.mutex);
+		if (dst->is_free) continue;
+
+		pthread_mutex_lock(&src->mutex);
+		dst->airplane = src->airplane;
+		pthread_mutex_unlock(&src->mutex);
+		dst->airplane.des_traj = NULL;
+		dst->spawn_offset_us = time_diff_us(&ctx->spawn_times[i], now);
+		dst->taxi_reserved = ctx->taxi_reserved[i];
+		dst->taxi_released = ctx->taxi_released[i];
+	}
+}
+
+// Copy the queues in their order
+void _capture_queues(sim_context_t* ctx, checkpoint_image_t* image) {
+	airplane_queue_t* queue = &ctx->airplane_queue;
+	runway_queue_t* released = &ctx->released_runways;
+	spawn_wait_list_t* wait_list = &ctx->spawn_wait_list;
+	int i = 0;
+
+	pthread_mutex_lock(&queue->mutex);
+	for (i = queue->top; i != queue->bottom; i = (i + 1) % AIRPLANE_QUEUE_LENGTH)
+		image->queue[image->n_queue++] = _airplane_ref(queue->elems[i]);
+	pthread_mutex_unlock(&queue->mutex);
+
+	pthread_mutex_lock(&released->mutex);
+	for (i = released->top; i != released->bottom;
+			i = (i + 1) % RUNWAY_QUEUE_LENGTH)
+		image->released_runways[image->n_released_runways++] = released->elems[i];
+	pthread_mutex_unlock(&released->mutex);
+
+	pthread_mutex_lock(&wait_list->mutex);
+	for (i = wait_list->top; i != wait_list->bottom;
+			i = (i + 1) % SPAWN_WAIT_LIST_LENGTH)
+		image->spawn_wait_list[image->n_spawn_wait_list++] = wait_list->elems[i];
+	pthread_mutex_unlock(&wait_list->mutex);
+}
+
+// Copy the state of the traffic controller: the sequencer and the runways
+void _capture_controller(const sim_context_t* ctx, checkpoint_image_t* image) {
+	const sequencer_t* seq = &ctx->sequencer;
+	int i = 0;
+
+	for (i = seq->backlog_top; i != seq->backlog_bottom;
+			i = (i + 1) % AIRPLANE_QUEUE_LENGTH)
+		image->backlog[image->n_backlog++] = _airplane_ref(seq->backlog[i]);
+	for (i = 0; i < seq->n_window; ++i) {
+		image->window[i] = (checkpoint_seq_slot_t) {
+			.airplane = _airplane_ref(seq->window[i].airplane),
+			.is_arrival = seq->window[i].is_arrival,
+			.eta_us = seq->window[i].eta_us
+		};
+	}
+	image->n_window = seq->n_window;
+	for (i = 0; i < seq->n_sequence; ++i)
+		image->sequence[i] = seq->sequence[i];
+	image->n_sequence = seq->n_sequence;
+	image->seq_ticks = seq->ticks;
+	image->seq_is_dirty = seq->is_dirty;
+
+	for (i = 0; i < MAX_RUNWAYS; ++i)
+		image->runways[i] = _airplane_ref(ctx->runways[i]);
+	for (i = 0; i < ctx->n_free_runways; ++i)
+		image->free_runways[i] = ctx->free_runways[i];
+	image->n_free_runways = ctx->n_free_runways;
+	// the ones the free runways were chosen with, maybe not published last
+	for (i = 0; i < ctx->airport.n_runways; ++i)
+		image->runways_in_use[i] = seq->trajectories->is_in_use[i];
+}
+
+// Copy the occupied holding slots and the taxiway reservations
+void _capture_airport(sim_context_t* ctx, checkpoint_image_t* image,
+		const struct timespec* now) {
+	holding_manager_t* hm = &ctx->holding_manager;
+	taxiway_t* taxiway = &ctx->airport.taxiway;
+	int i = 0;
+	int j = 0;
+
+	pthread_mutex_lock(&hm->mutex);
+	for (i = 0; i < MAX_HOLDING_STACKS; ++i) {
+		for (j = 0; j < HOLDING_SLOTS; ++j)
+			image->holding_slots[i][j] = i < hm->n_stacks ?
+				_airplane_ref(hm->stacks[i].slots[j]) : -1;
+	}
+	image->holding_t0_offset_us = time_diff_us(&hm->t0, now);
+	pthread_mutex_unlock(&hm->mutex);
+
+	pthread_mutex_lock(&taxiway->mutex);
+	for (i = 0; i < MAX_TAXI_EDGES; ++i)
+		image->edge_owner[i] = taxiway->edge_owner[i];
+	pthread_mutex_unlock(&taxiway->mutex);
+}
+
+// Fill the image with the state of the simulation at time "now"
+void _capture(sim_context_t* ctx, checkpoint_image_t* image,
+		const struct timespec* now) {
+	memset(image, 0, sizeof(*image));
+	image->header = (checkpoint_header_t) {
+		.version = CHECKPOINT_VERSION,
+		.image_size = sizeof(checkpoint_image_t),
+		.seed = ctx->config.seed,
+		.t_us = time_diff_us(now, &ctx->start_time),
+		.n_runways = ctx->airport.n_runways,
+		.n_holdings = ctx->airport.n_holdings,
+		.n_gates = ctx->airport.n_gates,
+		.n_taxi_nodes = ctx->airport.taxiway.n_nodes,
+		.n_taxi_edges = ctx->airport.taxiway.n_edges
+	};
+	strncpy(image->header.magic, CHECKPOINT_MAGIC, sizeof(image->header.magic));
+
+	_capture_airplanes(ctx, image, now);
+	_capture_queues(ctx, image);
+	_capture_controller(ctx, image);
+	_capture_airport(ctx, image, now);
+
+	pthread_mutex_lock(&ctx->admission_mutex);
+	image->airplane_wcet_us = ctx->airplane_wcet_us;
+	pthread_mutex_unlock(&ctx->admission_mutex);
+	image->next_gate = ctx->next_gate;
+	image->scenario_next = ctx->scenario.next;
+	image->enable_random_gen = ctx->enable_random_gen;
+	image->rng = ctx->rng;
+	image->traffic = ctx->traffic;
+
+	pthread_mutex_lock(&ctx->system_state.mutex);
+	image->system_state = ctx->system_state.state;
+	pthread_mutex_unlock(&ctx->system_state.mutex);
+}
+
+// Save the state of the simulation at time "now" to "path". The image is
+// written to a temporary file and renamed, so a failed save never
+// replaces a valid checkpoint. The jobs that change the state must be
+// held by the caller.
+// Return ERROR_GENERIC if the file can't be written
+int checkpoint_save(sim_context_t* ctx, const char* path,
+		const struct timespec* now) {
+	checkpoint_image_t* image = malloc(sizeof(checkpoint_image_t));
+	char tmp_path[FILENAME_MAX];
+	FILE* file = NULL;
+	int ret = SUCCESS;
+
+	if (!image) {
+		fprintf(stderr, ERR_MSG_CHECKPOINT_ALLOC);
+		return ERROR_GENERIC;
+	}
+	_capture(ctx, image, now);
+
+	snprintf(tmp_path, sizeof(tmp_path), "%s%s", path, CHECKPOINT_TMP_SUFFIX);
+	file = fopen(tmp_path, "wb");
+	if (!file) {
+		fprintf(stderr, ERR_MSG_CHECKPOINT_WRITE, tmp_path, strerror(errno));
+		free(image);
+		return ERROR_GENERIC;
+	}
+	if (fwrite(image, sizeof(*image), 1, file) != 1)
+		ret = ERROR_GENERIC;
+	if (fclose(file) != 0)
+		ret = ERROR_GENERIC;
+	if (ret == SUCCESS && rename(tmp_path, path) != 0)
+		ret = ERROR_GENERIC;
+	if (ret != SUCCESS) {
+		fprintf(stderr, ERR_MSG_CHECKPOINT_WRITE, path, strerror(errno));
+		remove(tmp_path);
+	}
+	free(image);
+	return ret;
+}
+
+
+// ==================================================================
+//                            RESTORE
+// ==================================================================
+// Return true if "ref" refers to an airplane of the image pool in use
+bool _is_live_ref(const checkpoint_image_t* image, int32_t ref) {
+	return ref >= 0 && ref < AIRPLANE_POOL_SIZE && !image->airplanes[ref].is_free;
+}
+
+// Count a reference to an airplane waiting for a runway in the queue, the
+// backlog or the window. Return false if the airplane is not live, not
+// holding or already referenced
+bool _count_waiting(const checkpoint_image_t* image, int32_t ref,
+		int* n_refs) {
+	enum airplane_status status;
+
+	if (!_is_live_ref(image, ref) || n_refs[ref] > 0)
+		return false;
+	status = image->airplanes[ref].airplane.status;
+	if (status != INBOUND_HOLDING && status != OUTBOUND_HOLDING)
+		return false;
+	++n_refs[ref];
+	return true;
+}
+
+// Return NULL if the airplanes waiting for a runway and the runways refer
+// to the pool consistently, the reason otherwise. Each holding airplane
+// waits exactly once, each airplane on a runway holds it at most once
+const char* _check_controller(const checkpoint_image_t* image) {
+	const int n_runways = image->header.n_runways;
+	const checkpoint_airplane_t* airplane = NULL;
+	int n_refs[AIRPLANE_POOL_SIZE] = { 0 };	// references of each airplane
+	bool is_sequenced[SEQUENCER_WINDOW] = { false };
+	int32_t ref = 0;
+	int i = 0;
+
+	for (i = 0; i < image->n_queue; ++i) {
+		if (!_count_waiting(image, image->queue[i], n_refs))
+			return "corrupted serving queue";
+	}
+	for (i = 0; i < image->n_backlog; ++i) {
+		if (!_count_waiting(image, image->backlog[i], n_refs))
+			return "corrupted sequencer backlog";
+	}
+	for (i = 0; i < image->n_window; ++i) {
+		if (!_count_waiting(image, image->window[i].airplane, n_refs))
+			return "corrupted sequencer window";
+	}
+	for (i = 0; i < AIRPLANE_POOL_SIZE; ++i) {
+		airplane = &image->airplanes[i];
+		if (!airplane->is_free && n_refs[i] == 0 &&
+				(airplane->airplane.status == INBOUND_HOLDING ||
+				airplane->airplane.status == OUTBOUND_HOLDING))
+			return "holding airplane not waiting for a runway";
+	}
+
+	// The sequence is a permutation of the window
+	if (image->n_sequence != image->n_window)
+		return "corrupted sequence";
+	for (i = 0; i < image->n_sequence; ++i) {
+		if (image->sequence[i] < 0 || image->sequence[i] >= image->n_window ||
+				is_sequenced[image->sequence[i]])
+			return "corrupted sequence";
+		is_sequenced[image->sequence[i]] = true;
+	}
+
+	for (i = 0; i < MAX_RUNWAYS; ++i) {
+		ref = image->runways[i];
+		if (ref == -1) continue;
+		if (i >= n_runways || !_is_live_ref(image, ref) || n_refs[ref] > 0 ||
+				(image->airplanes[ref].airplane.status != INBOUND_LANDING &&
+				image->airplanes[ref].airplane.status != OUTBOUND_TAKEOFF) ||
+				image->airplanes[ref].airplane.runway_id != i)
+			return "corrupted runway owner";
+		++n_refs[ref];
+	}
+	for (i = 0; i < image->n_free_runways; ++i) {
+		if (image->runways[image->free_runways[i]] != -1)
+			return "corrupted runways";
+	}
+	for (i = 0; i < image->n_released_runways; ++i) {
+		if (image->released_runways[i] < 0 ||
+				image->released_runways[i] >= n_runways)
+			return "corrupted released runways";
+	}
+	return NULL;
+}
+
+// Return NULL if the taxi progress of each airplane lies on the route from
+// its gate to its runway, the reason otherwise. Only the airplanes taking
+// off have reserved taxiway edges
+const char* _check_taxi_progress(const sim_context_t* ctx,
+		const checkpoint_image_t* image) {
+	const checkpoint_airplane_t* airplane = NULL;
+	taxi_route_t route;
+	int n_nodes = 0;
+	int i = 0;
+
+	for (i = 0; i < AIRPLANE_POOL_SIZE; ++i) {
+		airplane = &image->airplanes[i];
+		if (airplane->is_free) continue;
+		n_nodes = 1;
+		if (airplane->airplane.status == OUTBOUND_TAKEOFF) {
+			if (taxiway_route(&ctx->airport.taxiway,
+					ctx->airport.gates[airplane->airplane.gate_id],
+					ctx->airport.runways[airplane->airplane.runway_id].entry_node,
+					&route) < 0)
+				return "no taxi route";
+			n_nodes = route.n_nodes;
+		}
+		if (airplane->taxi_released < 0 ||
+				airplane->taxi_released > airplane->taxi_reserved ||
+				airplane->taxi_reserved >= n_nodes)
+			return "corrupted taxi progress";
+	}
+	return NULL;
+}
+
+// Return NULL if the image can be restored on the simulation, the reason
+// otherwise
+const char* _check_image(const sim_context_t* ctx,
+		const checkpoint_image_t* image) {
+	const checkpoint_header_t* header = &image->header;
+	const checkpoint_airplane_t* airplane = NULL;
+	int n_slots[AIRPLANE_POOL_SIZE] = { 0 };	// holding slots of each airplane
+	const char* err = NULL;
+	int32_t ref = 0;
+	int i = 0;
+	int j = 0;
+
+	if (strncmp(header->magic, CHECKPOINT_MAGIC, sizeof(header->magic)) != 0)
+		return "not a checkpoint";
+	if (header->version != CHECKPOINT_VERSION)
+		return "unsupported version";
+	if (header->image_size != sizeof(checkpoint_image_t))
+		return "image layout of another build";
+	if (header->n_runways != ctx->airport.n_runways ||
+			header->n_holdings != ctx->airport.n_holdings ||
+			header->n_gates != ctx->airport.n_gates ||
+			header->n_taxi_nodes != ctx->airport.taxiway.n_nodes ||
+			header->n_taxi_edges != ctx->airport.taxiway.n_edges)
+		return "taken on another airport";
+	if (header->t_us < 0)
+		return "negative time";
+
+	// Counts that index the arrays of the image
+	if (image->n_queue < 0 || image->n_queue >= AIRPLANE_QUEUE_LENGTH ||
+			image->n_backlog < 0 || image->n_backlog >= AIRPLANE_QUEUE_LENGTH ||
+			image->n_window < 0 || image->n_window > SEQUENCER_WINDOW ||
+			image->n_sequence < 0 || image->n_sequence > image->n_window ||
+			image->n_free_runways < 0 ||
+			image->n_free_runways > header->n_runways ||
+			image->n_released_runways < 0 ||
+			image->n_released_runways >= RUNWAY_QUEUE_LENGTH ||
+			image->n_spawn_wait_list < 0 ||
+			image->n_spawn_wait_list >= SPAWN_WAIT_LIST_LENGTH)
+		return "corrupted queues";
+	for (i = 0; i < image->n_free_runways; ++i) {
+		if (image->free_runways[i] < 0 ||
+				image->free_runways[i] >= header->n_runways ||
+				!image->runways_in_use[image->free_runways[i]])
+			return "corrupted runways";
+	}
+	for (i = 0; i < header->n_runways && !image->runways_in_use[i]; ++i)
+		continue;
+	if (i == header->n_runways)
+		return "no runway in use";
+	for (i = 0; i < AIRPLANE_POOL_SIZE; ++i) {
+		airplane = &image->airplanes[i];
+		if (airplane->is_free) continue;
+		if (airplane->airplane.unique_id != i)
+			return "corrupted airplane pool";
+		// the trajectories are found again from the gate and the runway
+		if (airplane->airplane.status != INBOUND_HOLDING &&
+				airplane->airplane.status != OUTBOUND_HOLDING &&
+				(airplane->airplane.runway_id < 0 ||
+				airplane->airplane.runway_id >= header->n_runways))
+			return "corrupted runway assignment";
+		if (airplane->airplane.status >= OUTBOUND_HOLDING &&
+				(airplane->airplane.gate_id < 0 ||
+				airplane->airplane.gate_id >= header->n_gates))
+			return "corrupted gate assignment";
+	}
+	err = _check_controller(image);
+	if (!err)
+		err = _check_taxi_progress(ctx, image);
+	if (err)
+		return err;
+
+	// Each holding airplane has exactly one slot, the slots refer to
+	// holding airplanes only
+	for (i = 0; i < MAX_HOLDING_STACKS; ++i) {
+		for (j = 0; j < HOLDING_SLOTS; ++j) {
+			ref = image->holding_slots[i][j];
+			if (ref == -1) continue;
+			if (i >= header->n_holdings || !_is_live_ref(image, ref) ||
+					image->airplanes[ref].airplane.status != INBOUND_HOLDING ||
+					n_slots[ref] > 0)
+				return "corrupted holding slots";
+			++n_slots[ref];
+		}
+	}
+	for (i = 0; i < AIRPLANE_POOL_SIZE; ++i) {
+		airplane = &image->airplanes[i];
+		if (!airplane->is_free && airplane->airplane.status == INBOUND_HOLDING &&
+				n_slots[i] != 1)
+			return "corrupted holding slots";
+	}
+	for (i = 0; i < MAX_TAXI_EDGES; ++i) {
+		if (image->edge_owner[i] != -1 &&
+				!_is_live_ref(image, image->edge_owner[i]))
+			return "corrupted taxiway reservations";
+	}
+	if (image->next_gate < 0 || image->next_gate >= header->n_gates)
+		return "corrupted gate";
+	return NULL;
+}
+
+// Rebuild the airplane pool. The spawn times follow the new clock, the
+// trajectories are restored with the airport
+void _restore_airplanes(sim_context_t* ctx, const checkpoint_image_t* image,
+		const struct timespec* now) {
+	const checkpoint_airplane_t* src = NULL;
+	shared_airplane_t* dst = NULL;
+	int i = 0;
+
+	for (i = 0; i < AIRPLANE_POOL_SIZE; ++i) {
+		src = &image->airplanes[i];
+		ctx->taxi_reserved[i] = 0;
+		ctx->taxi_released[i] = 0;
+		if (src->is_free) continue;
+
+		dst = &ctx->airplane_pool.elems[i];
+		ctx->airplane_pool.is_free[i] = false;
+		--ctx->airplane_pool.n_free;
+		dst->airplane = src->airplane;
+		ptask_mutex_init(&dst->mutex);
+
+		time_copy(&ctx->spawn_times[i], now);
+		time_add_us(&ctx->spawn_times[i], (long) src->spawn_offset_us);
+		ctx->taxi_reserved[i] = src->taxi_reserved;
+		ctx->taxi_released[i] = src->taxi_released;
+	}
+}
+
+// Refill the queues, which are empty after the initialization
+void _restore_queues(sim_context_t* ctx, const checkpoint_image_t* image) {
+	int i = 0;
+
+	for (i = 0; i < image->n_queue; ++i)
+		airplane_queue_push(&ctx->airplane_queue,
+			_airplane_resolve(ctx, image->queue[i]));
+	for (i = 0; i < image->n_released_runways; ++i)
+		runway_queue_push(&ctx->released_runways, image->released_runways[i]);
+	for (i = 0; i < image->n_spawn_wait_list; ++i)
+		spawn_wait_list_push(&ctx->spawn_wait_list, &image->spawn_wait_list[i]);
+}
+
+// Restore the sequencer and the runways of the traffic controller
+void _restore_controller(sim_context_t* ctx, const checkpoint_image_t* image) {
+	sequencer_t* seq = &ctx->sequencer;
+	int i = 0;
+
+	for (i = 0; i < image->n_backlog; ++i)
+		sequencer_add(seq, _airplane_resolve(ctx, image->backlog[i]));
+	for (i = 0; i < image->n_window; ++i) {
+		seq->window[i] = (sequencer_slot_t) {
+			.airplane = _airplane_resolve(ctx, image->window[i].airplane),
+			.is_arrival = image->window[i].is_arrival,
+			.eta_us = (long) image->window[i].eta_us
+		};
+	}
+	seq->n_window = image->n_window;
+	for (i = 0; i < image->n_sequence; ++i)
+		seq->sequence[i] = image->sequence[i];
+	seq->n_sequence = image->n_sequence;
+	seq->ticks = image->seq_ticks;
+	seq->is_dirty = image->seq_is_dirty;
+
+	for (i = 0; i < MAX_RUNWAYS; ++i)
+		ctx->runways[i] = _airplane_resolve(ctx, image->runways[i]);
+	for (i = 0; i < image->n_free_runways; ++i)
+		ctx->free_runways[i] = image->free_runways[i];
+	ctx->n_free_runways = image->n_free_runways;
+}
+
+// Give back to the airplanes the trajectories of their role in the first
+// set: the pattern of their stack, the landing of their runway, their gate
+// or their departure, rebuilt in place.
+// Return ERROR_GENERIC if a departure can't be built
+int _restore_trajectories(sim_context_t* ctx) {
+	const traj_set_t* set = ctx->traj_set;
+	const holding_manager_t* hm = &ctx->holding_manager;
+	airplane_t* airplane = NULL;
+	int i = 0;
+
+	for (i = 0; i < AIRPLANE_POOL_SIZE; ++i) {
+		if (ctx->airplane_pool.is_free[i]) continue;
+		airplane = &ctx->airplane_pool.elems[i].airplane;
+		switch (airplane->status) {
+			case INBOUND_HOLDING:
+				airplane->des_traj = hm->stack_of[i] >= 0 ?
+					hm->stacks[hm->stack_of[i]].pattern : NULL;
+				break;
+			case INBOUND_LANDING:
+				airplane->des_traj = set->landing[airplane->runway_id];
+				break;
+			case OUTBOUND_HOLDING:
+				airplane->des_traj = ctx->gate_trajectories[airplane->gate_id];
+				break;
+			case OUTBOUND_TAKEOFF:
+			default:
+				airplane->des_traj = build_departure_trajectory(ctx, set, i,
+					airplane->gate_id, airplane->runway_id);
+				if (!airplane->des_traj)
+					return ERROR_GENERIC;
+				break;
+		}
+	}
+	return SUCCESS;
+}
+
+// Restore the holding slots and the taxiway reservations
+void _restore_airport(sim_context_t* ctx, const checkpoint_image_t* image,
+		const struct timespec* now) {
+	holding_manager_t* hm = &ctx->holding_manager;
+	holding_stack_t* stack = NULL;
+	int i = 0;
+	int j = 0;
+
+	for (i = 0; i < hm->n_stacks; ++i) {
+		stack = &hm->stacks[i];
+		stack->n_occupied = 0;
+		for (j = 0; j < HOLDING_SLOTS; ++j) {
+			stack->slots[j] = _airplane_resolve(ctx, image->holding_slots[i][j]);
+			if (!stack->slots[j]) continue;
+			++stack->n_occupied;
+			hm->stack_of[image->holding_slots[i][j]] = i;
+			hm->slot_of[image->holding_slots[i][j]] = j;
+		}
+	}
+	time_copy(&hm->t0, now);
+	time_add_us(&hm->t0, (long) image->holding_t0_offset_us);
+
+	for (i = 0; i < MAX_TAXI_EDGES; ++i)
+		ctx->airport.taxiway.edge_owner[i] = image->edge_owner[i];
+}
+
+// Restore the simulation saved in "path". The simulation must be
+// initialized and its tasks not created yet; the simulated time of the
+// checkpoint becomes "now".
+// Return ERROR_GENERIC if the file can't be read or doesn't match the
+// simulation
+int checkpoint_load(sim_context_t* ctx, const char* path,
+		const struct timespec* now) {
+	checkpoint_image_t* image = malloc(sizeof(checkpoint_image_t));
+	FILE* file = NULL;
+	const char* err = NULL;
+	size_t n_read = 0;
+	int i = 0;
+
+	if (!image) {
+		fprintf(stderr, ERR_MSG_CHECKPOINT_ALLOC);
+		return ERROR_GENERIC;
+	}
+	file = fopen(path, "rb");
+	if (!file) {
+		fprintf(stderr, ERR_MSG_CHECKPOINT_READ, path, strerror(errno));
+		free(image);
+		return ERROR_GENERIC;
+	}
+	n_read = fread(image, 1, sizeof(*image), file);
+	fclose(file);
+	if (n_read == sizeof(*image))
+		err = _check_image(ctx, image);
+	else if (n_read >= sizeof(image->header) &&
+			image->header.version != CHECKPOINT_VERSION)
+		err = "unsupported version";	// images of other versions differ in size
+	else
+		err = "truncated image";
+	if (err) {
+		fprintf(stderr, ERR_MSG_CHECKPOINT_FORMAT, path, err);
+		free(image);
+		return ERROR_GENERIC;
+	}
+
+	// The simulated time continues from the checkpoint
+	time_copy(&ctx->start_time, now);
+	time_add_us(&ctx->start_time, -(long) image->header.t_us);
+
+	// The first set is not published to any task yet, it takes the
+	// runways in use of the checkpoint
+	for (i = 0; i < ctx->airport.n_runways; ++i)
+		ctx->traj_sets[0].is_in_use[i] = image->runways_in_use[i];
+	sequencer_set_trajectories(&ctx->sequencer, ctx->traj_set);
+	holding_set_trajectories(&ctx->holding_manager, &ctx->airport,
+		ctx->traj_set);
+
+	_restore_airplanes(ctx, image, now);
+	_restore_queues(ctx, image);
+	_restore_controller(ctx, image);
+	_restore_airport(ctx, image, now);
+	if (_restore_trajectories(ctx) != SUCCESS) {
+		fprintf(stderr, ERR_MSG_CHECKPOINT_FORMAT, path, "no departure route");
+		free(image);
+		return ERROR_GENERIC;
+	}
+
+	ctx->airplane_wcet_us = (long) image->airplane_wcet_us;
+	ctx->next_gate = image->next_gate;
+	// The scenario, if any, must be the one of the checkpoint
+	if (image->scenario_next >= 0 &&
+			image->scenario_next < ctx->scenario.n_events)
+		ctx->scenario.next = (long) image->scenario_next;
+	else
+		ctx->scenario.next = ctx->scenario.n_events;
+	ctx->enable_random_gen = image->enable_random_gen;
+	ctx->rng = image->rng;
+	ctx->traffic = image->traffic;
+	ctx->system_state.state = image->system_state;
+	free(image);
+	return SUCCESS;
+}
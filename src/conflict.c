@@ -0,0 +1,216 @@
+/*
+ * conflict.c
+ *
+ * Conflict prediction. The track of an airplane starts at its position,
+ * reaches its desired point at the current velocity and then follows the
+ * next waypoints at their velocities until the horizon is covered. The
+ * tracks are sorted by the left side of their bounding box and swept, so
+ * that only the pairs with overlapping boxes get the exact closest point
+ * of approach, computed interval by interval on the merged breakpoints
+ */
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "conflict.h"
+
+// ==================================================================
+//                           TRACKS
+// ==================================================================
+// Append a point to the track and extend its bounding box
+void _track_append(track_t* track, float t, float x, float y) {
+	track->points[track->n_points++] = (track_point_t) { .t = t, .x = x, .y = y };
+	track->min_x = fminf(track->min_x, x);
+	track->max_x = fmaxf(track->max_x, x);
+	track->min_y = fminf(track->min_y, y);
+	track->max_y = fmaxf(track->max_y, y);
+}
+
+// Return the position of the track at time t, which must be covered
+// by the segment starting at the point of index i
+void _track_position(const track_t* track, int i, float t, float* x, float* y) {
+	const track_point_t* p = &track->points[i];
+	const track_point_t* q = NULL;
+	float s = 0.0f;
+
+	if (i + 1 >= track->n_points) {
+		*x = p->x;
+		*y = p->y;
+		return;
+	}
+	q = &track->points[i + 1];
+	s = (q->t > p->t) ? (t - p->t) / (q->t - p->t) : 0.0f;
+	*x = p->x + (q->x - p->x) * s;
+	*y = p->y + (q->y - p->y) * s;
+}
+
+// Compare two tracks by the left side of their bounding box
+int _track_compare(const void* a, const void* b) {
+	const track_t* ta = *(const track_t* const*) a;
+	const track_t* tb = *(const track_t* const*) b;
+
+	if (ta->min_x < tb->min_x) return -1;
+	return (ta->min_x > tb->min_x) ? 1 : 0;
+}
+
+// ==================================================================
+//                      CLOSEST POINT OF APPROACH
+// ==================================================================
+// Compute the closest point of approach of two tracks within the time
+// both are defined. The relative motion is linear between two merged
+// breakpoints, so the minimum of each interval has a closed form
+void _closest_approach(const track_t* a, const track_t* b, float* t_cpa,
+		float* d_cpa) {
+	const float t_end = fminf(a->points[a->n_points - 1].t,
+		b->points[b->n_points - 1].t);
+	float t_lo = 0.0f;
+	float t_hi = 0.0f;
+	float ax0, ay0, bx0, by0;		// positions at t_lo
+	float ax1, ay1, bx1, by1;		// positions at t_hi
+	float rx, ry, vx, vy;			// relative position and its change
+	float s, d;
+	int i = 0;
+	int j = 0;
+
+	_track_position(a, 0, 0.0f, &ax0, &ay0);
+	_track_position(b, 0, 0.0f, &bx0, &by0);
+	*t_cpa = 0.0f;
+	*d_cpa = hypotf(ax0 - bx0, ay0 - by0);
+
+	while (t_lo < t_end) {
+		// moving to the segments covering t_lo
+		while (i + 1 < a->n_points && a->points[i + 1].t <= t_lo) ++i;
+		while (j + 1 < b->n_points && b->points[j + 1].t <= t_lo) ++j;
+		t_hi = t_end;
+		if (i + 1 < a->n_points) t_hi = fminf(t_hi, a->points[i + 1].t);
+		if (j + 1 < b->n_points) t_hi = fminf(t_hi, b->points[j + 1].t);
+
+		_track_position(a, i, t_lo, &ax0, &ay0);
+		_track_position(b, j, t_lo, &bx0, &by0);
+		_track_position(a, i, t_hi, &ax1, &ay1);
+		_track_position(b, j, t_hi, &bx1, &by1);
+		rx = ax0 - bx0;
+		ry = ay0 - by0;
+		vx = (ax1 - bx1) - rx;
+		vy = (ay1 - by1) - ry;
+
+		s = 0.0f;
+		if (vx*vx + vy*vy > 0.0f)
+			s = fminf(fmaxf(-(rx*vx + ry*vy) / (vx*vx + vy*vy), 0.0f), 1.0f);
+		d = hypotf(rx + vx * s, ry + vy * s);
+		if (d < *d_cpa) {
+			*d_cpa = d;
+			*t_cpa = t_lo + (t_hi - t_lo) * s;
+		}
+		t_lo = t_hi;
+	}
+}
+
+// ==================================================================
+//                           PREDICTOR
+// ==================================================================
+// Initialize the predictor with the look-ahead horizon in seconds
+void conflict_init(conflict_predictor_t* cp, float horizon, float min_dist) {
+	cp->horizon = horizon;
+	cp->min_dist = min_dist;
+	cp->n_tracks = 0;
+}
+
+// Remove all the tracks of the previous prediction
+void conflict_clear(conflict_predictor_t* cp) {
+	cp->n_tracks = 0;
+}
+
+// Predict the track of the airplane. Without a desired point the airplane
+// keeps its heading and velocity
+void conflict_add_airplane(conflict_predictor_t* cp, const airplane_t* airplane) {
+	track_t* track = NULL;
+	waypoint_t point;
+	float x = airplane->x;
+	float y = airplane->y;
+	float t = 0.0f;
+	float dt = 0.0f;
+	float vel = fmaxf(airplane->vel, CONFLICT_MIN_VEL);
+	float s = 0.0f;
+	int index = airplane->traj_index;
+
+	if (cp->n_tracks == MAX_AIRPLANE) return;
+	track = &cp->tracks[cp->n_tracks++];
+	track->n_points = 0;
+	track->id = airplane->unique_id;
+	track->min_x = track->max_x = x;
+	track->min_y = track->max_y = y;
+	_track_append(track, t, x, y);
+
+	if (airplane->traj_finished ||
+			!trajectory_get_point(airplane->des_traj, index, &point)) {
+		_track_append(track, cp->horizon,
+			x + vel * cosf(airplane->angle) * cp->horizon,
+			y + vel * sinf(airplane->angle) * cp->horizon);
+		return;
+	}
+
+	while (track->n_points <= CONFLICT_MAX_LEGS && t < cp->horizon) {
+		if (!trajectory_get_point(airplane->des_traj, index, &point)) break;
+
+		dt = hypotf(point.x - x, point.y - y) / vel;
+		if (t + dt > cp->horizon) {
+			// cutting the last leg at the horizon
+			s = (cp->horizon - t) / dt;
+			_track_append(track, cp->horizon, x + (point.x - x) * s,
+				y + (point.y - y) * s);
+			break;
+		}
+		t += dt;
+		x = point.x;
+		y = point.y;
+		_track_append(track, t, x, y);
+
+		// the next legs are flown at the velocity of their waypoints
+		vel = fmaxf(point.vel, CONFLICT_MIN_VEL);
+		++index;
+	}
+}
+
+// Find the pairs of tracks that come closer than the separation minimum
+// within the horizon. At most max_conflicts conflicts are stored, sorted
+// by the sweep order. Return the total number of conflicts
+int conflict_detect(conflict_predictor_t* cp, conflict_t* conflicts,
+		int max_conflicts) {
+	const float margin = cp->min_dist;
+	const track_t* a = NULL;
+	const track_t* b = NULL;
+	float t_cpa, d_cpa;
+	int n = 0;
+	int i, j;
+
+	for (i = 0; i < cp->n_tracks; ++i)
+		cp->sorted[i] = &cp->tracks[i];
+	qsort(cp->sorted, (size_t) cp->n_tracks, sizeof(cp->sorted[0]),
+		_track_compare);
+
+	for (i = 0; i < cp->n_tracks; ++i) {
+		a = cp->sorted[i];
+		// the following boxes start further right: stopping at the first
+		// one that starts after the end of this box
+		for (j = i + 1; j < cp->n_tracks; ++j) {
+			b = cp->sorted[j];
+			if (b->min_x > a->max_x + margin) break;
+			if (b->min_y > a->max_y + margin || a->min_y > b->max_y + margin)
+				continue;
+
+			_closest_approach(a, b, &t_cpa, &d_cpa);
+			if (d_cpa >= cp->min_dist) continue;
+			if (n < max_conflicts) {
+				conflicts[n] = (conflict_t) {
+					.id_a = a->id,
+					.id_b = b->id,
+					.t_cpa = t_cpa,
+					.distance = d_cpa
+				};
+			}
+			++n;
+		}
+	}
+	return n;
+}
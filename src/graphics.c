@@ -21,6 +21,35 @@ static int sidebar_box_tasks_state_y_start = 0;
 static int sidebar_box_tasks_state_y_end = 0;
 
 
+// ==================================================================
+//                            BACKEND
+// ==================================================================
+// Initialize Allegro, the keyboard and the window
+// Return SUCCESS or ERROR_GENERIC
+int graphics_init(void) {
+	allegro_init();
+	install_keyboard();
+	set_color_depth(8);
+	if (set_gfx_mode(GFX_AUTODETECT_WINDOWED, SCREEN_WIDTH, SCREEN_HEIGHT,
+			0, 0) != 0) {
+		fprintf(stderr, "Error while setting the graphic mode: %s\n",
+			allegro_error);
+		return ERROR_GENERIC;
+	}
+	clear_to_color(screen, BG_COLOR);
+	return SUCCESS;
+}
+
+// Close the window and release Allegro
+void graphics_exit(void) {
+	allegro_exit();
+}
+
+// Release a box created by create_main_box or create_sidebar_box
+void destroy_box(BITMAP* box) {
+	destroy_bitmap(box);
+}
+
 // ==================================================================
 //                            MAIN BOX
 // =================================================================
@@ -79,6 +108,10 @@ BITMAP* create_sidebar_box(void) {
 	y += SIDEBAR_BOX_VSPACE;
 	_sidebar_textout_ex(sidebar_box, "W:   show / hide next waypoint", y);
 	y += SIDEBAR_BOX_VSPACE;
+	_sidebar_textout_ex(sidebar_box, "C:   save a checkpoint", y);
+	y += SIDEBAR_BOX_VSPACE;
+	_sidebar_textout_ex(sidebar_box, "U/1-8: reload routes / runways", y);
+	y += SIDEBAR_BOX_VSPACE;
 	_sidebar_textout_ex(sidebar_box, "ESC: quit", y);
 	y += SIDEBAR_BOX_VSPACE + SIDEBAR_BOX_PADDING;
 	line(sidebar_box, 0, y, SIDEBAR_BOX_WIDTH, y, MAIN_COLOR);
@@ -88,7 +121,7 @@ BITMAP* create_sidebar_box(void) {
 	_sidebar_textout_ex(sidebar_box, "SYSTEM STATE", y);
 	y += SIDEBAR_BOX_VSPACE + SIDEBAR_BOX_PADDING;
 	sidebar_box_system_state_y_start = y;
-	y += 4 * SIDEBAR_BOX_VSPACE;
+	y += 11 * SIDEBAR_BOX_VSPACE;
 	sidebar_box_system_state_y_end = y;
 	y += SIDEBAR_BOX_PADDING;
 	line(sidebar_box, 0, y, SIDEBAR_BOX_WIDTH, y, MAIN_COLOR);
@@ -120,7 +153,6 @@ void update_sidebar_box(BITMAP* sidebar_box, shared_system_state_t* system_state
 void update_sidebar_system_state(BITMAP* sidebar_box,
 		shared_system_state_t* system_state) {
 	char str[SIDEBAR_STR_LENGTH] = { 0 };
-	int i = 0;
 	int y = sidebar_box_system_state_y_start;	// text y-coordinate
 	system_state_t local_system_state;
 
@@ -140,14 +172,10 @@ void update_sidebar_system_state(BITMAP* sidebar_box,
 	y += SIDEBAR_BOX_VSPACE;
 
 	// Writing the state of the runways
-	for (i = 0; i < N_RUNWAYS; ++i) {
-		if (local_system_state.is_runway_free[i])
-			sprintf(str, "Runway %d:   %s", i + 1, "free");
-		else
-			sprintf(str, "Runway %d:   %s", i + 1, "busy");
-		_sidebar_textout_ex(sidebar_box, str, y);
-		y += SIDEBAR_BOX_VSPACE;
-	}
+	sprintf(str, "Runways:    %d / %d free", local_system_state.n_free_runways,
+		local_system_state.n_runways);
+	_sidebar_textout_ex(sidebar_box, str, y);
+	y += SIDEBAR_BOX_VSPACE;
 
 	// Writing the random generation state
 	if (local_system_state.random_gen_enabled)
@@ -155,15 +183,67 @@ void update_sidebar_system_state(BITMAP* sidebar_box,
 	else
 		strcpy(str, "Random gen: disabled");
 	_sidebar_textout_ex(sidebar_box, str, y);
+	y += SIDEBAR_BOX_VSPACE;
+
+	// Writing the overload degradation level
+	sprintf(str, "Overload:   level %d", local_system_state.overload_level);
+	_sidebar_textout_ex(sidebar_box, str, y);
+	y += SIDEBAR_BOX_VSPACE;
+
+	// Writing the graphic period
+	sprintf(str, "Frame:      %d ms", local_system_state.graphic_period_ms);
+	_sidebar_textout_ex(sidebar_box, str, y);
+	y += SIDEBAR_BOX_VSPACE;
+
+	// Writing the admission statistics
+	sprintf(str, "Adm/Def/Rej: %d/%d/%d", local_system_state.n_admitted,
+		local_system_state.n_deferred, local_system_state.n_rejected);
+	_sidebar_textout_ex(sidebar_box, str, y);
+	y += SIDEBAR_BOX_VSPACE;
+	sprintf(str, "Utilization: %.2f", (double) local_system_state.utilization);
+	_sidebar_textout_ex(sidebar_box, str, y);
+	y += SIDEBAR_BOX_VSPACE;
+
+	// Writing the number of stalls detected by the watchdog
+	sprintf(str, "Stalls:     %d", local_system_state.n_stalls);
+	_sidebar_textout_ex(sidebar_box, str, y);
+	y += SIDEBAR_BOX_VSPACE;
+
+	// Writing the separation violations of the last check
+	sprintf(str, "Separation: %d violations", local_system_state.n_violations);
+	_sidebar_textout_ex(sidebar_box, str, y);
+	y += SIDEBAR_BOX_VSPACE;
+
+	// Writing the predicted conflicts
+	sprintf(str, "Conflicts:  %d predicted", local_system_state.n_conflicts);
+	_sidebar_textout_ex(sidebar_box, str, y);
+	y += SIDEBAR_BOX_VSPACE;
+
+	// Writing the airplanes that have left the system
+	sprintf(str, "Completed:  %d in, %d out", local_system_state.n_landed,
+		local_system_state.n_departed);
+	_sidebar_textout_ex(sidebar_box, str, y);
 }
 
-// Update the task states in the sidebar box
+// Return the character that represents the state of a task
+char _get_task_state_char(const task_state_t* task_state) {
+	if (task_state->is_stalled) return 'H';
+	if (task_state->is_dormant) return 'D';
+	return task_state->is_running ? 'R' : 'S';
+}
+
+// Update the task states in the sidebar box. The first SIDEBAR_COMPACT_TASKS
+// tasks are written on two columns
 void update_sidebar_tasks_state(BITMAP* sidebar_box,
 		task_state_t* task_states, const int task_states_size) {
 	char str[SIDEBAR_STR_LENGTH] = { 0 };
+	// number of lines on two columns
+	const int n_pairs = ((task_states_size < SIDEBAR_COMPACT_TASKS) ?
+		task_states_size : SIDEBAR_COMPACT_TASKS) / 2;
 	int i = 0;
 	int y = sidebar_box_tasks_state_y_start;	// text y-coordinate
 	char state;									// state of the task
+	char state2;								// state of the second column
 
 	// Clearing the old information
 	rectfill(sidebar_box,
@@ -172,15 +252,28 @@ void update_sidebar_tasks_state(BITMAP* sidebar_box,
 		BG_COLOR);
 
 	// Writing columns header
-	sprintf(str, "%-16s %3s %3s", "", "sts", "dlm");
+	sprintf(str, "%-16s %3s %3s %3s", "", "sts", "dlm", "stl");
 	_sidebar_textout_ex(sidebar_box, str, y);
 	y += SIDEBAR_BOX_VSPACE + SIDEBAR_BOX_PADDING;
 
-	// Writing the state of each task
-	for (i = 0; i < task_states_size; ++i) {
-		state = task_states[i].is_running ? 'R' : 'S';
-		sprintf(str, "%-16s  %c  %3d",
-			task_states[i].str, state, task_states[i].deadline_miss);
+	// Writing the state of the compact tasks, two for each line
+	for (i = 0; i < 2 * n_pairs; i += 2) {
+		state = _get_task_state_char(&task_states[i]);
+		state2 = _get_task_state_char(&task_states[i + 1]);
+		sprintf(str, "%-7s %c%3d%3d  %-7s %c%3d%3d",
+			task_states[i].str, state, task_states[i].deadline_miss,
+			task_states[i].stall_count,
+			task_states[i + 1].str, state2, task_states[i + 1].deadline_miss,
+			task_states[i + 1].stall_count);
+		_sidebar_textout_ex(sidebar_box, str, y);
+		y += SIDEBAR_BOX_VSPACE;
+	}
+
+	// Writing the state of the other tasks
+	for (; i < task_states_size; ++i) {
+		state = _get_task_state_char(&task_states[i]);
+		sprintf(str, "%-16s  %c  %3d %3d", task_states[i].str, state,
+			task_states[i].deadline_miss, task_states[i].stall_count);
 		_sidebar_textout_ex(sidebar_box, str, y);
 		y += SIDEBAR_BOX_VSPACE;
 	}
@@ -0,0 +1,147 @@
+/*
+ * graphics_null.c
+ *
+ * Null backend of the functions declared in graphics.h, linked by the
+ * headless build in place of graphics.c. Nothing is drawn and no key is
+ * ever read, so the simulation runs without Allegro and without a display
+ */
+
+#include <stdio.h>
+
+#include "graphics.h"
+#include "consts.h"
+
+// ==================================================================
+//                            BACKEND
+// ==================================================================
+int graphics_init(void) {
+	return SUCCESS;
+}
+
+void graphics_exit(void) {
+}
+
+void destroy_box(BITMAP* box) {
+	(void) box;
+}
+
+// ==================================================================
+//                            MAIN BOX
+// ==================================================================
+BITMAP* create_main_box(void) {
+	return NULL;
+}
+
+void clear_main_box(BITMAP* main_box) {
+	(void) main_box;
+}
+
+void blit_main_box(BITMAP* main_box) {
+	(void) main_box;
+}
+
+// ==================================================================
+//                         SIDEBAR BOX
+// ==================================================================
+BITMAP* create_sidebar_box(void) {
+	return NULL;
+}
+
+void blit_sidebar_box(BITMAP* sidebar_box) {
+	(void) sidebar_box;
+}
+
+void update_sidebar_box(BITMAP* sidebar_box,
+		shared_system_state_t* system_state,
+		task_state_t* task_states, const int task_states_size) {
+	(void) sidebar_box;
+	(void) system_state;
+	(void) task_states;
+	(void) task_states_size;
+}
+
+void update_sidebar_system_state(BITMAP* sidebar_box,
+		shared_system_state_t* system_state) {
+	(void) sidebar_box;
+	(void) system_state;
+}
+
+void update_sidebar_tasks_state(BITMAP* sidebar_box,
+		task_state_t* task_states, const int task_states_size) {
+	(void) sidebar_box;
+	(void) task_states;
+	(void) task_states_size;
+}
+
+// ==================================================================
+//                        AIRPLANE GRAPHIC
+// ==================================================================
+// There is no display: all the points are mapped to its origin
+void get_triangle_coord(float xc, float yc, float radius, float angle,
+		int* xs, int* ys) {
+	int i = 0;
+
+	(void) xc;
+	(void) yc;
+	(void) radius;
+	(void) angle;
+	for (i = 0; i < 3; ++i)
+		xs[i] = ys[i] = 0;
+}
+
+void draw_triangle(BITMAP* bitmap, int xc, int yc, int radius, float angle,
+		int color) {
+	(void) bitmap;
+	(void) xc;
+	(void) yc;
+	(void) radius;
+	(void) angle;
+	(void) color;
+}
+
+void rotate_point(float* x, float* y, float xc, float yc,
+		float cos_angle, float sin_angle) {
+	(void) x;
+	(void) y;
+	(void) xc;
+	(void) yc;
+	(void) cos_angle;
+	(void) sin_angle;
+}
+
+void convert_coord_to_display(float src_x, float src_y, int* dst_x, int* dst_y) {
+	(void) src_x;
+	(void) src_y;
+	*dst_x = 0;
+	*dst_y = 0;
+}
+
+void draw_airplane(BITMAP* bitmap, const airplane_t* airplane) {
+	(void) bitmap;
+	(void) airplane;
+}
+
+void draw_waypoint(BITMAP* bitmap, const waypoint_t* point) {
+	(void) bitmap;
+	(void) point;
+}
+
+void draw_trail(BITMAP* bitmap, const cbuffer_t* trails, int color) {
+	(void) bitmap;
+	(void) trails;
+	(void) color;
+}
+
+int get_airplane_color(const airplane_t* airplane) {
+	(void) airplane;
+	return AIRPLANE_COLOR;
+}
+
+// ==================================================================
+//                          KEYBOARD
+// ==================================================================
+bool get_keycodes(char* scan, char* ascii) {
+	(void) scan;
+	(void) ascii;
+	return false;
+}
@@ -0,0 +1,361 @@
+/*
+ * holding.c
+ *
+ * Slot allocation of the holding stacks. The slots of a stack rotate
+ * along its pattern at the holding velocity; an airplane entering a slot
+ * is sent to the point the slot will have reached when the airplane
+ * joins the pattern, then its velocity is trimmed at each job to stay
+ * on the slot. New arrivals go to the stack with the lowest
+ * expected delay, and the stacks are rebalanced one airplane at a time
+ * when an airplane leaves for landing
+ */
+
+#include <math.h>
+
+#include "holding.h"
+#include "ptask.h"
+
+// ==================================================================
+//                         HOLDING PATTERNS
+// ==================================================================
+// Return the point of the oval pattern centered in (0, 0) at the distance
+// "u" along the pattern, starting from the right end of the oval
+void _oval_point(float u, waypoint_t* point) {
+	const float turn = M_PI_F * HOLDING_TRAJECTORY_RADIUS;	// length of a turn
+	const float leg = 2.0f * HOLDING_TRAJECTORY_ARM;		// of a straight leg
+	float angle = 0.0f;
+
+	if (u < 0.5f * turn) {						// right turn
+		angle = u / HOLDING_TRAJECTORY_RADIUS;
+		point->x = HOLDING_TRAJECTORY_ARM;
+	} else if (u < 0.5f * turn + leg) {			// northern leg
+		point->x = HOLDING_TRAJECTORY_ARM - (u - 0.5f * turn);
+		point->y = HOLDING_TRAJECTORY_RADIUS;
+		return;
+	} else if (u < 1.5f * turn + leg) {			// left turn
+		angle = M_PI_2_F + (u - 0.5f * turn - leg) / HOLDING_TRAJECTORY_RADIUS;
+		point->x = -HOLDING_TRAJECTORY_ARM;
+	} else if (u < 1.5f * turn + 2.0f * leg) {	// southern leg
+		point->x = -HOLDING_TRAJECTORY_ARM + (u - 1.5f * turn - leg);
+		point->y = -HOLDING_TRAJECTORY_RADIUS;
+		return;
+	} else {									// right turn
+		angle = 3.0f * M_PI_2_F +
+			(u - 1.5f * turn - 2.0f * leg) / HOLDING_TRAJECTORY_RADIUS;
+		point->x = HOLDING_TRAJECTORY_ARM;
+	}
+	point->x += HOLDING_TRAJECTORY_RADIUS * cosf(angle);
+	point->y = HOLDING_TRAJECTORY_RADIUS * sinf(angle);
+}
+
+// Store in the bank the oval pattern centered in the holding fix. The
+// points are evenly spaced, so that the slots are too.
+// Return NULL if the bank is full
+const trajectory_t* holding_build_pattern(traj_bank_t* bank,
+		const holding_fix_t* fix) {
+	int i = 0;
+	waypoint_t point;			// Working point
+	const float step = 2.0f * (M_PI_F * HOLDING_TRAJECTORY_RADIUS +
+		2.0f * HOLDING_TRAJECTORY_ARM) / HOLDING_TRAJECTORY_SIZE;
+	trajectory_t* traj = traj_bank_alloc(bank, HOLDING_TRAJECTORY_SIZE, true);
+
+	if (!traj) return NULL;
+	for (i = 0; i < HOLDING_TRAJECTORY_SIZE; ++i) {
+		_oval_point((float) i * step, &point);
+		point.x += fix->x;
+		point.y += fix->y;
+		point.vel = HOLDING_TRAJECTORY_VEL;
+		trajectory_append(traj, point, SEGMENT_APPROACH);
+	}
+	trajectory_seal(traj);
+	return traj;
+}
+
+// Return the distance along the pattern from its first point to the
+// point "index"
+float _pattern_distance(const trajectory_t* traj, int index) {
+	float distance = 0.0f;
+	int i = 0;
+
+	for (i = 0; i < index; ++i)
+		distance += traj->length[i];
+	return distance;
+}
+
+// Return the distance of the slot from the first point of the pattern,
+// "elapsed_s" seconds after the start of the manager. The slots are evenly
+// spaced and move at the holding velocity
+float _slot_distance(const holding_manager_t* hm, int slot, double elapsed_s) {
+	return (float) fmod(elapsed_s * (double) HOLDING_TRAJECTORY_VEL +
+		(double) ((float) slot * hm->length / HOLDING_SLOTS),
+		(double) hm->length);
+}
+
+// Return the distance of an airplane from its slot, wrapped in
+// [-length / 2, length / 2). Positive if the airplane is behind the slot
+float _slot_error(const holding_manager_t* hm, float slot_distance,
+		float distance) {
+	return fmodf(slot_distance - distance + 1.5f * hm->length, hm->length) -
+		0.5f * hm->length;
+}
+
+// Put in "index" the pattern point where an airplane in (x, y) best meets
+// its slot, flying straight at the holding velocity, and return the slot
+// error there
+float _slot_point(const holding_manager_t* hm, const holding_stack_t* stack,
+		int slot, float x, float y, int* index) {
+	struct timespec now;
+	waypoint_t point;
+	double elapsed_s = 0.0;
+	float distance = 0.0f;				// of the point along the pattern
+	float error = 0.0f;
+	float min_error = INFINITY;
+	int i = 0;
+
+	ptask_clock_now(hm->clock, &now);
+	elapsed_s = (double) time_diff_us(&now, &hm->t0) / 1e6;
+
+	for (i = 0; i < stack->pattern->size; ++i) {
+		// the slot moves on while the airplane reaches the point
+		trajectory_get_point(stack->pattern, i, &point);
+		error = fabsf(_slot_error(hm, _slot_distance(hm, slot, elapsed_s) +
+			hypotf(point.x - x, point.y - y), distance));
+		if (error < min_error) {
+			min_error = error;
+			*index = i;
+		}
+		distance += stack->pattern->length[i];
+	}
+	return min_error;
+}
+
+// Expected delay of a new arrival in the stack
+long _expected_delay_us(const holding_manager_t* hm,
+		const holding_stack_t* stack) {
+	return stack->transit_us + stack->n_occupied * hm->sep_us;
+}
+
+// Put the airplane in the free slot of the stack that it best meets. Must
+// be called with the manager locked and the airplane not running or locked
+void _assign_slot(holding_manager_t* hm, int stack_id, airplane_t* airplane,
+		shared_airplane_t* owner) {
+	holding_stack_t* stack = &hm->stacks[stack_id];
+	float error = 0.0f;					// of the airplane at the join
+	float min_error = INFINITY;
+	int best = -1;
+	int index = 0;
+	int i = 0;
+
+	for (i = 0; i < HOLDING_SLOTS; ++i) {
+		if (stack->slots[i] != NULL) continue;
+		error = _slot_point(hm, stack, i, airplane->x, airplane->y, &index);
+		if (best < 0 || error < min_error) {
+			min_error = error;
+			best = i;
+			airplane->traj_index = index;
+		}
+	}
+	stack->slots[best] = owner;
+	++stack->n_occupied;
+	hm->stack_of[airplane->unique_id] = stack_id;
+	hm->slot_of[airplane->unique_id] = best;
+
+	airplane->des_traj = stack->pattern;
+	airplane->traj_finished = false;
+}
+
+// ==================================================================
+//                         HOLDING MANAGER
+// ==================================================================
+// Initialize the stacks described by the airport, flying the patterns of
+// "set". The slots turn with the time of "clock"
+void holding_init(holding_manager_t* hm, const airport_t* airport,
+		const traj_set_t* set, sim_clock_t* clock) {
+	int i = 0;
+	int j = 0;
+
+	hm->n_stacks = airport->n_holdings;
+	for (i = 0; i < hm->n_stacks; ++i) {
+		for (j = 0; j < HOLDING_SLOTS; ++j)
+			hm->stacks[i].slots[j] = NULL;
+		hm->stacks[i].n_occupied = 0;
+	}
+
+	// all the patterns have the same shape
+	hm->length = _pattern_distance(set->holding[0], set->holding[0]->size);
+	for (i = 0; i < AIRPLANE_POOL_SIZE; ++i) {
+		hm->stack_of[i] = -1;
+		hm->slot_of[i] = -1;
+	}
+	hm->clock = clock;
+	ptask_clock_now(hm->clock, &hm->t0);
+	ptask_mutex_init(&hm->mutex);
+	holding_set_trajectories(hm, airport, set);
+}
+
+// Make the stacks fly the patterns of "set". The airplanes already holding
+// are moved to the same slot of the new pattern. The transit time of a
+// stack is estimated up to the nearest landing trajectory of a runway in use
+void holding_set_trajectories(holding_manager_t* hm, const airport_t* airport,
+		const traj_set_t* set) {
+	holding_stack_t* stack = NULL;
+	shared_airplane_t* airplane = NULL;
+	waypoint_t start;					// first point of a landing
+	long transit_us = 0;
+	int n_in_use = 0;					// numb. of runways in use
+	int i = 0;
+	int j = 0;
+
+	pthread_mutex_lock(&hm->mutex);
+	for (i = 0; i < hm->n_stacks; ++i) {
+		stack = &hm->stacks[i];
+		stack->pattern = set->holding[i];
+		for (j = 0; j < HOLDING_SLOTS; ++j) {
+			airplane = stack->slots[j];
+			if (!airplane) continue;
+			pthread_mutex_lock(&airplane->mutex);
+			airplane->airplane.des_traj = stack->pattern;
+			_slot_point(hm, stack, j, airplane->airplane.x,
+				airplane->airplane.y, &airplane->airplane.traj_index);
+			++airplane->airplane.cmd_count;
+			pthread_mutex_unlock(&airplane->mutex);
+		}
+
+		stack->transit_us = -1;
+		for (j = 0; j < airport->n_runways; ++j) {
+			if (!set->is_in_use[j]) continue;
+			trajectory_get_point(set->landing[j], 0, &start);
+			transit_us = (long) (hypotf(start.x - airport->holdings[i].x,
+				start.y - airport->holdings[i].y) / HOLDING_TRAJECTORY_VEL *
+				1000000.0f);
+			if (stack->transit_us < 0 || transit_us < stack->transit_us)
+				stack->transit_us = transit_us;
+		}
+	}
+
+	for (j = 0; j < airport->n_runways; ++j)
+		n_in_use += set->is_in_use[j] ? 1 : 0;
+	hm->sep_us = SEP_ARR_ARR_MS * 1000 / n_in_use;
+	pthread_mutex_unlock(&hm->mutex);
+}
+
+// Check if a new arrival can enter a stack
+bool holding_has_free_slot(holding_manager_t* hm) {
+	bool found = false;
+	int i = 0;
+
+	pthread_mutex_lock(&hm->mutex);
+	for (i = 0; i < hm->n_stacks && !found; ++i)
+		found = hm->stacks[i].n_occupied < HOLDING_SLOTS;
+	pthread_mutex_unlock(&hm->mutex);
+	return found;
+}
+
+// Assign a new arrival to the stack with the lowest expected delay. The
+// airplane must not be running yet. ERROR_GENERIC is returned if all the
+// stacks are full
+int holding_enter(holding_manager_t* hm, shared_airplane_t* airplane) {
+	int best = -1;			// stack with the lowest expected delay
+	int i = 0;
+
+	pthread_mutex_lock(&hm->mutex);
+	for (i = 0; i < hm->n_stacks; ++i) {
+		if (hm->stacks[i].n_occupied == HOLDING_SLOTS) continue;
+		if (best < 0 || _expected_delay_us(hm, &hm->stacks[i]) <
+				_expected_delay_us(hm, &hm->stacks[best]))
+			best = i;
+	}
+	if (best >= 0)
+		_assign_slot(hm, best, &airplane->airplane, airplane);
+	pthread_mutex_unlock(&hm->mutex);
+
+	return best >= 0 ? SUCCESS : ERROR_GENERIC;
+}
+
+// Free the slot of an airplane leaving for landing. If another stack has
+// at least two airplanes more, one of its airplanes is moved to the freed
+// stack. The moved airplane is commanded through its cmd_count
+void holding_leave(holding_manager_t* hm, const shared_airplane_t* airplane) {
+	const int id = airplane->airplane.unique_id;
+	holding_stack_t* stack = NULL;
+	shared_airplane_t* moved = NULL;
+	int stack_id = 0;
+	int fullest = -1;		// most occupied stack
+	int i = 0;
+
+	pthread_mutex_lock(&hm->mutex);
+	stack_id = hm->stack_of[id];
+	if (stack_id < 0) {
+		pthread_mutex_unlock(&hm->mutex);
+		return;
+	}
+	stack = &hm->stacks[stack_id];
+	stack->slots[hm->slot_of[id]] = NULL;
+	--stack->n_occupied;
+	hm->stack_of[id] = -1;
+	hm->slot_of[id] = -1;
+
+	// Rebalancing the stacks
+	for (i = 0; i < hm->n_stacks; ++i) {
+		if (fullest < 0 || hm->stacks[i].n_occupied >
+				hm->stacks[fullest].n_occupied)
+			fullest = i;
+	}
+	if (hm->stacks[fullest].n_occupied - stack->n_occupied > 1) {
+		// moving the airplane in the last occupied slot
+		i = HOLDING_SLOTS - 1;
+		while (hm->stacks[fullest].slots[i] == NULL)
+			--i;
+		moved = hm->stacks[fullest].slots[i];
+		hm->stacks[fullest].slots[i] = NULL;
+		--hm->stacks[fullest].n_occupied;
+
+		pthread_mutex_lock(&moved->mutex);
+		_assign_slot(hm, stack_id, &moved->airplane, moved);
+		++moved->airplane.cmd_count;
+		pthread_mutex_unlock(&moved->mutex);
+	}
+	pthread_mutex_unlock(&hm->mutex);
+}
+
+// Trim the velocity of a holding airplane to keep it on its slot. While
+// joining the pattern, the airplane flies at the holding velocity to meet
+// the slot where planned
+void holding_track_slot(holding_manager_t* hm, airplane_t* airplane) {
+	const trajectory_t* pattern = airplane->des_traj;
+	const float max_trim = HOLDING_SLOT_MAX_TRIM * HOLDING_TRAJECTORY_VEL;
+	struct timespec now;
+	waypoint_t target;
+	float slot_distance = 0.0f;		// of the slot along the pattern
+	float range = 0.0f;				// from the airplane to its target
+	float error = 0.0f;
+	bool on_slot = false;
+	int stack_id = 0;
+	int index = 0;
+
+	airplane->slot_vel = 0.0f;
+	pthread_mutex_lock(&hm->mutex);
+	stack_id = hm->stack_of[airplane->unique_id];
+	on_slot = stack_id >= 0 && hm->stacks[stack_id].pattern == pattern;
+	if (on_slot) {
+		ptask_clock_now(hm->clock, &now);
+		slot_distance = _slot_distance(hm, hm->slot_of[airplane->unique_id],
+			(double) time_diff_us(&now, &hm->t0) / 1e6);
+	}
+	pthread_mutex_unlock(&hm->mutex);
+	if (!on_slot) return;
+
+	airplane->slot_vel = HOLDING_TRAJECTORY_VEL;
+	index = airplane->traj_index % pattern->size;
+	trajectory_get_point(pattern, index, &target);
+	range = hypotf(target.x - airplane->x, target.y - airplane->y);
+	if (range > trajectory_leg_length(pattern, index + pattern->size - 1) +
+			AIRPLANE_CTRL_MIN_DIST)
+		return;
+
+	// Position of the airplane on the leg to its target point
+	error = _slot_error(hm, slot_distance,
+		_pattern_distance(pattern, index) - range);
+	airplane->slot_vel += fmaxf(-max_trim,
+		fminf(max_trim, error / HOLDING_SLOT_CATCH_S));
+}
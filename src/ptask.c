@@ -6,6 +6,10 @@
 
 
 #include <time.h>
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <limits.h>
 #include <stdbool.h>
 
 #include "ptask.h"
@@ -20,6 +24,236 @@
 #define MIN_PRIORITY 0
 #define MAX_PRIORITY 99
 
+// Overload detection thresholds
+#define OVERLOAD_MISS_RATE_TH	0.01f	// miss rate that triggers a degradation
+#define OVERLOAD_HEADROOM_LOW	0.2f	// slack / deadline that triggers a degradation
+#define OVERLOAD_HEADROOM_HIGH	0.5f	// slack / deadline needed to recover
+#define OVERLOAD_RECOVERY_EVALS	10		// updates with headroom before recovering
+
+// Timing wheel
+#define TIMER_WHEEL_MASK	((long) TIMER_WHEEL_SLOTS - 1)
+#define TIMER_WHEEL_SPAN	(1L << (TIMER_WHEEL_LEVELS * TIMER_WHEEL_BITS))
+
+// ==================================================================
+//                        SIMULATION CLOCK
+// ==================================================================
+// Thread waiting on the simulation clock in SIM_CLOCK_AFAP mode
+struct sim_clock_waiter {
+	const pthread_cond_t* cond;		// waited condition, NULL for a sleep
+	const struct timespec* wake;	// wake up time, NULL if none
+	bool is_woken;					// set by a timeout or by a signal
+	bool timed_out;
+};
+
+// Return true if the clock runs as fast as possible. A NULL clock is
+// the real time
+static bool _clock_is_afap(const sim_clock_t* clock) {
+	return clock && clock->mode == SIM_CLOCK_AFAP;
+}
+
+// Convert a simulated time to the real time it is reached at
+static void _clock_to_real(const sim_clock_t* clock, const struct timespec* sim,
+		struct timespec* real) {
+	time_copy(real, &clock->origin);
+	time_add_us(real, (long) ((double) time_diff_us(sim, &clock->origin) /
+		(double) clock->scale));
+}
+
+// Move the time to the first wake up and wake the waiters that have
+// reached it. Must be called with the clock locked and no running task
+static void _clock_advance(sim_clock_t* clock) {
+	const struct timespec* first = NULL;	// first wake up time
+	struct sim_clock_waiter* w = NULL;
+	int i = 0;
+
+	for (i = 0; i < clock->n_waiters; ++i) {
+		w = clock->waiters[i];
+		if (!w->is_woken && w->wake && (!first || time_cmp(w->wake, first) < 0))
+			first = w->wake;
+	}
+	if (!first) return;			// all the tasks wait for an event
+	if (time_cmp(first, &clock->now) > 0)
+		time_copy(&clock->now, first);
+
+	for (i = 0; i < clock->n_waiters; ++i) {
+		w = clock->waiters[i];
+		if (!w->is_woken && w->wake && time_cmp(w->wake, &clock->now) <= 0) {
+			w->is_woken = true;
+			w->timed_out = true;
+			++clock->n_running;
+		}
+	}
+	pthread_cond_broadcast(&clock->cond);
+}
+
+// Wait in SIM_CLOCK_AFAP mode until "wake" or until "cond" is signaled.
+// "mutex", if any, is released during the wait as pthread_cond_timedwait
+// does. Return 0 or ETIMEDOUT
+static int _clock_afap_wait(sim_clock_t* clock, const pthread_cond_t* cond,
+		pthread_mutex_t* mutex, const struct timespec* wake) {
+	struct sim_clock_waiter waiter = {
+		.cond = cond,
+		.wake = wake,
+		.is_woken = false,
+		.timed_out = false
+	};
+	int i = 0;
+
+	pthread_mutex_lock(&clock->mutex);
+	if ((wake && time_cmp(wake, &clock->now) <= 0) ||
+			clock->n_waiters == SIM_CLOCK_MAX_WAITERS) {
+		pthread_mutex_unlock(&clock->mutex);
+		return ETIMEDOUT;
+	}
+	clock->waiters[clock->n_waiters++] = &waiter;
+	--clock->n_running;
+	if (mutex) pthread_mutex_unlock(mutex);
+	if (clock->n_running == 0) _clock_advance(clock);
+
+	while (!waiter.is_woken)
+		pthread_cond_wait(&clock->cond, &clock->mutex);
+
+	// removing the waiter, the order of the waiters is not relevant
+	while (clock->waiters[i] != &waiter)
+		++i;
+	clock->waiters[i] = clock->waiters[--clock->n_waiters];
+	pthread_mutex_unlock(&clock->mutex);
+
+	if (mutex) pthread_mutex_lock(mutex);
+	return waiter.timed_out ? ETIMEDOUT : 0;
+}
+
+// Account a task thread that starts or stops running
+static void _clock_thread_started(sim_clock_t* clock) {
+	if (!_clock_is_afap(clock)) return;
+	pthread_mutex_lock(&clock->mutex);
+	++clock->n_running;
+	pthread_mutex_unlock(&clock->mutex);
+}
+
+static void _clock_thread_stopped(sim_clock_t* clock) {
+	if (!_clock_is_afap(clock)) return;
+	pthread_mutex_lock(&clock->mutex);
+	if (--clock->n_running == 0) _clock_advance(clock);
+	pthread_mutex_unlock(&clock->mutex);
+}
+
+// Initialize a time base for a set of tasks. Must be called before
+// creating any of its tasks. "scale" is only used by SIM_CLOCK_SCALED.
+// The calling thread holds the simulated time until ptask_clock_start
+// is called
+void ptask_clock_init(sim_clock_t* clock, enum sim_clock_mode mode,
+		float scale) {
+	pthread_condattr_t attr;
+
+	clock->mode = mode;
+	clock->scale = (mode == SIM_CLOCK_SCALED && scale > 0.0f) ? scale : 1.0f;
+	clock_gettime(CLOCK_MONOTONIC, &clock->origin);
+	time_copy(&clock->now, &clock->origin);
+	clock->n_running = 1;
+	clock->n_waiters = 0;
+	ptask_mutex_init(&clock->mutex);
+	pthread_condattr_init(&attr);
+	pthread_cond_init(&clock->cond, &attr);
+	pthread_condattr_destroy(&attr);
+}
+
+// Let the simulated time run without the calling thread. Until then the
+// thread counts as a running task and can only wait on the clock
+void ptask_clock_start(sim_clock_t* clock) {
+	_clock_thread_stopped(clock);
+}
+
+// Return the time base of the clock
+enum sim_clock_mode ptask_clock_mode(const sim_clock_t* clock) {
+	return clock ? clock->mode : SIM_CLOCK_REAL;
+}
+
+// Read the current simulated time
+void ptask_clock_now(sim_clock_t* clock, struct timespec* now) {
+	struct timespec real;
+
+	switch (ptask_clock_mode(clock)) {
+		case SIM_CLOCK_AFAP:
+			pthread_mutex_lock(&clock->mutex);
+			time_copy(now, &clock->now);
+			pthread_mutex_unlock(&clock->mutex);
+			break;
+		case SIM_CLOCK_SCALED:
+			clock_gettime(CLOCK_MONOTONIC, &real);
+			time_copy(now, &clock->origin);
+			time_add_us(now, (long) ((double) time_diff_us(&real,
+				&clock->origin) * (double) clock->scale));
+			break;
+		case SIM_CLOCK_REAL:
+		default:
+			clock_gettime(CLOCK_MONOTONIC, now);
+			break;
+	}
+}
+
+// Sleep until the simulated time "time"
+// Return SUCCESS or ERROR_GENERIC
+int ptask_clock_sleep_until(sim_clock_t* clock, const struct timespec* time) {
+	struct timespec real;
+
+	switch (ptask_clock_mode(clock)) {
+		case SIM_CLOCK_AFAP:
+			_clock_afap_wait(clock, NULL, NULL, time);
+			return SUCCESS;
+		case SIM_CLOCK_SCALED:
+			_clock_to_real(clock, time, &real);
+			return clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &real, NULL) ?
+				ERROR_GENERIC : SUCCESS;
+		case SIM_CLOCK_REAL:
+		default:
+			return clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, time, NULL) ?
+				ERROR_GENERIC : SUCCESS;
+	}
+}
+
+// Wait on a condition until it is signaled with ptask_cond_signal or until
+// the simulated time "abs_time" (never if NULL). The condition must use
+// CLOCK_MONOTONIC. Return the same values of pthread_cond_timedwait
+int ptask_cond_timedwait(sim_clock_t* clock, pthread_cond_t* cond,
+		pthread_mutex_t* mutex, const struct timespec* abs_time) {
+	struct timespec real;
+
+	if (_clock_is_afap(clock))
+		return _clock_afap_wait(clock, cond, mutex, abs_time);
+	if (!abs_time)
+		return pthread_cond_wait(cond, mutex);
+	if (ptask_clock_mode(clock) == SIM_CLOCK_SCALED) {
+		_clock_to_real(clock, abs_time, &real);
+		return pthread_cond_timedwait(cond, mutex, &real);
+	}
+	return pthread_cond_timedwait(cond, mutex, abs_time);
+}
+
+// Wake a task waiting on the condition with ptask_cond_timedwait
+void ptask_cond_signal(sim_clock_t* clock, pthread_cond_t* cond) {
+	struct sim_clock_waiter* w = NULL;
+	int i = 0;
+
+	if (!_clock_is_afap(clock)) {
+		pthread_cond_signal(cond);
+		return;
+	}
+
+	pthread_mutex_lock(&clock->mutex);
+	for (i = 0; i < clock->n_waiters; ++i) {
+		w = clock->waiters[i];
+		if (w->cond == cond && !w->is_woken) {
+			w->is_woken = true;
+			++clock->n_running;
+			pthread_cond_broadcast(&clock->cond);
+			break;
+		}
+	}
+	pthread_mutex_unlock(&clock->mutex);
+}
+
+
 // ==================================================================
 //                         TASK FUNCTIONS
 // ==================================================================
@@ -27,6 +261,8 @@
 // Return SUCCESS or ERROR_GENERIC
 int task_info_init(task_info_t* task,
 		int task_num, int period_ms, int deadline_ms, int priority) {
+	pthread_condattr_t attr;
+
 	// checking the arguments
 	if (priority < MIN_PRIORITY || priority > MAX_PRIORITY) return ERROR_GENERIC;
 	if (period_ms <= 0 || deadline_ms <= 0) return ERROR_GENERIC;
@@ -38,17 +274,57 @@ int task_info_init(task_info_t* task,
 	task->deadline_ms = deadline_ms;
 	task->priority = priority;
 	task->deadline_miss = 0;
+	task->criticality = TASK_CRIT_HIGH;
+	task->n_jobs = 0;
+	task->min_slack_us = LONG_MAX;
+	task->exec_us = 0;
+	task->max_exec_us = 0;
+	task->is_suspended = false;
+	task->resume_pending = false;
+	ptask_mutex_init(&task->wake_mutex);
+
+	// the timed waits on wake_cond are done on the activation times
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(&task->wake_cond, &attr);
+	pthread_condattr_destroy(&attr);
+	task->clock = NULL;
+	task->body = NULL;
+	task->is_active = false;
+	task->heartbeat = 0;
+	task->phase = "init";
+	task->is_stalled = false;
+	task->stall_count = 0;
 	return SUCCESS;
 }
 
-// Check whether or not a deadline miss has occurred
+// Check whether or not a deadline miss has occurred. It must be called at
+// the end of each job since it also updates the job statistics
 // Return true if a deadline miss has occurred
 int task_deadline_missed(task_info_t* task) {
 	struct timespec now;
-	clock_gettime(CLOCK_MONOTONIC, &now);
+	struct timespec now_cpu;
+	long slack_us;
+	long min_slack_us;
+	ptask_clock_now(task->clock, &now);
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now_cpu);
+
+	// updating the job statistics
+	task->exec_us = time_diff_us(&now_cpu, &task->job_start_cpu);
+	// the maximum, the window minimum and the counters are also read by the
+	// admission test and the overload manager
+	if (task->exec_us > task->max_exec_us)
+		__atomic_store_n(&task->max_exec_us, task->exec_us, __ATOMIC_RELAXED);
+	slack_us = time_diff_us(&task->abs_deadline, &now);
+	min_slack_us = __atomic_load_n(&task->min_slack_us, __ATOMIC_RELAXED);
+	while (slack_us < min_slack_us &&
+		!__atomic_compare_exchange_n(&task->min_slack_us, &min_slack_us,
+			slack_us, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+	__atomic_add_fetch(&task->n_jobs, 1, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&task->heartbeat, 1, __ATOMIC_RELEASE);
 	
 	if (time_cmp(&now, &task->abs_deadline) > 0) {
-		++(task->deadline_miss);
+		__atomic_add_fetch(&task->deadline_miss, 1, __ATOMIC_RELAXED);
 		return true;
 	}
 	return false;
@@ -57,34 +333,146 @@ int task_deadline_missed(task_info_t* task) {
 // Set the next activation time and the absolute deadline
 // Return SUCCESS or ERROR_GENERIC
 int task_set_activation(task_info_t* task) {
-	int err;
 	struct timespec now;
 
-	err = clock_gettime(CLOCK_MONOTONIC, &now);
-	if (err) return ERROR_GENERIC;
+	ptask_clock_now(task->clock, &now);
 
 	time_copy(&task->next_activation, &now);
 	time_add_ms(&task->next_activation, task->period_ms);
 
 	time_copy(&task->abs_deadline, &now);
 	time_add_ms(&task->abs_deadline, task->deadline_ms);
+
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &task->job_start_cpu);
 	return SUCCESS;
 }
 
 // Suspend the task until the next activation
 // Return SUCCESS or ERROR_GENERIC
 int task_wait_for_activation(task_info_t* task) {
-	int err;
-
-	err = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME,
-			&task->next_activation, NULL);
-	if (err) return ERROR_GENERIC;
+	if (ptask_clock_sleep_until(task->clock, &task->next_activation) != SUCCESS)
+		return ERROR_GENERIC;
 
+	// the deadline is relative to the activation time of the new job
+	time_copy(&task->abs_deadline, &task->next_activation);
+	time_add_ms(&task->abs_deadline, task->deadline_ms);
 	time_add_ms(&task->next_activation, task->period_ms);
-	time_add_ms(&task->abs_deadline, task->period_ms);
+
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &task->job_start_cpu);
+	return SUCCESS;
+}
+
+// Suspend the task until the next activation or until an event is notified
+// with task_resume, whichever comes first. A job released by an event has
+// its deadline relative to the event time and does not move the periodic
+// activations
+// Return SUCCESS or ERROR_GENERIC
+int task_wait_for_activation_or_event(task_info_t* task) {
+	int err = 0;
+	struct timespec now;
+
+	pthread_mutex_lock(&task->wake_mutex);
+	while (!task->resume_pending && err != ETIMEDOUT) {
+		err = ptask_cond_timedwait(task->clock, &task->wake_cond,
+			&task->wake_mutex, &task->next_activation);
+		if (err && err != ETIMEDOUT) break;
+	}
+	task->resume_pending = false;
+	pthread_mutex_unlock(&task->wake_mutex);
+	if (err && err != ETIMEDOUT) return ERROR_GENERIC;
+
+	ptask_clock_now(task->clock, &now);
+	if (time_cmp(&now, &task->next_activation) >= 0) {
+		// periodic activation
+		time_copy(&task->abs_deadline, &task->next_activation);
+		time_add_ms(&task->next_activation, task->period_ms);
+	} else {
+		// activation triggered by an event
+		time_copy(&task->abs_deadline, &now);
+	}
+	time_add_ms(&task->abs_deadline, task->deadline_ms);
+
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &task->job_start_cpu);
+	return SUCCESS;
+}
+
+// Put the calling task to sleep until task_resume is called. If a resume
+// has been requested since the last suspension the task is not suspended,
+// so that an event raised just before the call is not lost. On return the
+// next activation is moved to the first activation in the future that
+// keeps the original phase of the task
+// Return SUCCESS or ERROR_GENERIC
+int task_suspend(task_info_t* task) {
+	struct timespec now;
+	long late_ms;			// time elapsed from the skipped activation
+	long skip_ms;			// time covered by the skipped periods
+
+	pthread_mutex_lock(&task->wake_mutex);
+	task->is_suspended = true;
+	while (!task->resume_pending)
+		ptask_cond_timedwait(task->clock, &task->wake_cond, &task->wake_mutex,
+			NULL);
+	task->resume_pending = false;
+	task->is_suspended = false;
+	pthread_mutex_unlock(&task->wake_mutex);
+
+	// waking up counts as progress: the watchdog may have sampled the
+	// heartbeat while the task was still suspended
+	__atomic_add_fetch(&task->heartbeat, 1, __ATOMIC_RELEASE);
+
+	// skipping the activations that fell during the suspension
+	ptask_clock_now(task->clock, &now);
+	late_ms = time_diff_us(&now, &task->next_activation) / 1000;
+	if (late_ms >= 0) {
+		skip_ms = (late_ms / task->period_ms + 1) * task->period_ms;
+		task->next_activation.tv_sec += skip_ms / MS_IN_SEC;
+		time_add_ms(&task->next_activation, (int) (skip_ms % MS_IN_SEC));
+	}
+	return SUCCESS;
+}
+
+// Wake up a task suspended with task_suspend or waiting in
+// task_wait_for_activation_or_event. If the task is not waiting, its next
+// call to one of those functions will return immediately
+void task_resume(task_info_t* task) {
+	pthread_mutex_lock(&task->wake_mutex);
+	task->resume_pending = true;
+	ptask_cond_signal(task->clock, &task->wake_cond);
+	pthread_mutex_unlock(&task->wake_mutex);
+}
+
+// Record what the current job of the task is doing. Read by the watchdog
+// when the task stalls. "phase" must be a string literal
+void task_set_phase(task_info_t* task, const char* phase) {
+	__atomic_store_n(&task->phase, phase, __ATOMIC_RELEASE);
+}
+
+// Change the period and the relative deadline of a task. The next
+// activation is moved to one new period after the last one, so that a job
+// changing the period runs for exactly the new period; the new deadline
+// applies from the next job
+// Return SUCCESS or ERROR_GENERIC
+int task_set_period(task_info_t* task, int period_ms, int deadline_ms) {
+	if (period_ms <= 0 || deadline_ms <= 0) return ERROR_GENERIC;
+
+	time_add_us(&task->next_activation,
+		(long) (period_ms - task->period_ms) * 1000L);
+	__atomic_store_n(&task->period_ms, period_ms, __ATOMIC_RELAXED);
+	task->deadline_ms = deadline_ms;
 	return SUCCESS;
 }
 
+// Entry point of every task: run the task function and mark the
+// task as no longer active when it returns
+static void* _task_body(void* arg) {
+	task_info_t* task_info = (task_info_t*) arg;
+	void* rv = task_info->body(task_info);
+
+	__atomic_store_n(&task_info->is_active, false, __ATOMIC_RELEASE);
+	_clock_thread_stopped(task_info->clock);
+	return rv;
+}
+
 // Create a new task using with SCHED_FIFO as scheduler
 // Return SUCCESS or ERROR_GENERIC
 int task_create(task_info_t* task_info, void* (*func)(void*)) {
@@ -92,6 +480,9 @@ int task_create(task_info_t* task_info, void* (*func)(void*)) {
 	pthread_attr_t attr;
 	struct sched_param s_param;
 
+	task_info->body = func;
+	task_info->is_active = true;
+
 	// setting pthread attributes
 	s_param.sched_priority = task_info->priority;
 	err = pthread_attr_init(&attr);
@@ -101,8 +492,14 @@ int task_create(task_info_t* task_info, void* (*func)(void*)) {
 	if (!err) err |= pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
 	if (!err) err |= pthread_attr_setschedparam(&attr, &s_param);
 
-	// creating the thread
-	if (!err) err |= pthread_create(&task_info->thread_id, &attr, func, task_info);
+	// creating the thread, which runs until it waits on the clock
+	if (!err) {
+		_clock_thread_started(task_info->clock);
+		err |= pthread_create(&task_info->thread_id, &attr, _task_body,
+			task_info);
+		if (err) _clock_thread_stopped(task_info->clock);
+	}
+	if (err) task_info->is_active = false;
 
 	// cleanup
 	err |= pthread_attr_destroy(&attr);
@@ -116,6 +513,596 @@ int task_join(task_info_t* task_info, void** return_value) {
 }
 
 
+// Return the utilization of a task computed from the max measured
+// execution time of its jobs
+float task_utilization(const task_info_t* task) {
+	const long max_exec_us = __atomic_load_n(&task->max_exec_us, __ATOMIC_RELAXED);
+	const int period_ms = __atomic_load_n(&task->period_ms, __ATOMIC_RELAXED);
+
+	return (float) max_exec_us / (float) (period_ms * 1000);
+}
+
+// Return the max measured execution time of the jobs of a task (us)
+long task_max_exec_us(const task_info_t* task) {
+	return __atomic_load_n(&task->max_exec_us, __ATOMIC_RELAXED);
+}
+
+// Check if a set of "n_tasks" tasks with total utilization "utilization"
+// passes the schedulability test "test"
+bool task_set_schedulable(float utilization, int n_tasks, enum sched_test test) {
+	float bound = 1.0f;		// utilization bound
+
+	if (test == SCHED_TEST_RM && n_tasks > 0)
+		bound = (float) n_tasks * (powf(2.0f, 1.0f / (float) n_tasks) - 1.0f);
+	return utilization <= bound;
+}
+
+
+// ==================================================================
+//                        OVERLOAD MANAGER
+// ==================================================================
+// Initialize the overload manager
+void overload_manager_init(overload_manager_t* mgr, int max_level) {
+	mgr->n_tasks = 0;
+	mgr->max_level = max_level;
+	mgr->level = 0;
+	mgr->recovery_count = 0;
+	mgr->miss_rate = 0.0f;
+	mgr->headroom = 1.0f;
+	ptask_mutex_init(&mgr->mutex);
+}
+
+// Add a task to the set of the monitored tasks
+// Return SUCCESS or ERROR_GENERIC
+int overload_manager_register(overload_manager_t* mgr, task_info_t* task) {
+	int rv = SUCCESS;
+
+	pthread_mutex_lock(&mgr->mutex);
+	if (mgr->n_tasks < OVERLOAD_MAX_TASKS) {
+		mgr->tasks[mgr->n_tasks] = task;
+		mgr->n_jobs[mgr->n_tasks] = 0;
+		mgr->deadline_miss[mgr->n_tasks] = 0;
+		++mgr->n_tasks;
+	} else {
+		rv = ERROR_GENERIC;
+	}
+	pthread_mutex_unlock(&mgr->mutex);
+	return rv;
+}
+
+// Compute the deadline miss rate and the headroom of the jobs completed
+// since the last call and update the degradation level. The level is
+// raised by one step when the system is overloaded and lowered by one
+// step after OVERLOAD_RECOVERY_EVALS updates with enough headroom.
+// The new degradation level is stored in level
+// Return the level change (+1, 0 or -1)
+int overload_manager_update(overload_manager_t* mgr, int* level) {
+	int i = 0;
+	int jobs = 0;				// jobs completed in the window
+	int misses = 0;				// deadline misses in the window
+	int d_jobs = 0;
+	int n_jobs = 0;				// task counters read once per update
+	int deadline_miss = 0;
+	long min_slack_us = 0;		// task min slack in the window, reset on read
+	float headroom = 1.0f;		// min slack / deadline of the HIGH tasks
+	float task_headroom = 0.0f;
+	task_info_t* task = NULL;
+	bool overloaded = false;
+	int change = 0;
+
+	pthread_mutex_lock(&mgr->mutex);
+	for (i = 0; i < mgr->n_tasks; ++i) {
+		task = mgr->tasks[i];
+
+		// the fields are updated by the owning task without the mutex
+		n_jobs = __atomic_load_n(&task->n_jobs, __ATOMIC_RELAXED);
+		deadline_miss = __atomic_load_n(&task->deadline_miss, __ATOMIC_RELAXED);
+		min_slack_us = __atomic_exchange_n(&task->min_slack_us, LONG_MAX,
+			__ATOMIC_RELAXED);
+
+		// the counters are reset when the task_info is reinitialized
+		if (n_jobs < mgr->n_jobs[i]) mgr->n_jobs[i] = 0;
+		if (deadline_miss < mgr->deadline_miss[i]) mgr->deadline_miss[i] = 0;
+
+		d_jobs = n_jobs - mgr->n_jobs[i];
+		jobs += d_jobs;
+		misses += deadline_miss - mgr->deadline_miss[i];
+		mgr->n_jobs[i] = n_jobs;
+		mgr->deadline_miss[i] = deadline_miss;
+
+		// only the HIGH tasks that have run in the window count for the headroom
+		if (task->criticality == TASK_CRIT_HIGH && d_jobs > 0) {
+			task_headroom = (float) min_slack_us / 
+				(float) (task->deadline_ms * 1000);
+			if (task_headroom < headroom) headroom = task_headroom;
+		}
+	}
+
+	mgr->miss_rate = (jobs > 0) ? (float) misses / (float) jobs : 0.0f;
+	mgr->headroom = headroom;
+	overloaded = mgr->miss_rate > OVERLOAD_MISS_RATE_TH ||
+		headroom < OVERLOAD_HEADROOM_LOW;
+
+	if (overloaded) {
+		mgr->recovery_count = 0;
+		if (mgr->level < mgr->max_level) {
+			++mgr->level;
+			change = 1;
+		}
+	} else if (misses == 0 && headroom > OVERLOAD_HEADROOM_HIGH) {
+		// saturating, so that the count cannot overflow while the level is 0
+		if (mgr->recovery_count < OVERLOAD_RECOVERY_EVALS) ++mgr->recovery_count;
+		if (mgr->level > 0 && mgr->recovery_count == OVERLOAD_RECOVERY_EVALS) {
+			mgr->recovery_count = 0;
+			--mgr->level;
+			change = -1;
+		}
+	} else {
+		mgr->recovery_count = 0;
+	}
+	*level = mgr->level;
+	pthread_mutex_unlock(&mgr->mutex);
+	return change;
+}
+
+// Return the current degradation level
+int overload_manager_get_level(overload_manager_t* mgr) {
+	int level = 0;
+	pthread_mutex_lock(&mgr->mutex);
+	level = mgr->level;
+	pthread_mutex_unlock(&mgr->mutex);
+	return level;
+}
+
+// Return the headroom (min slack / deadline of the HIGH tasks)
+// measured by the last update
+float overload_manager_get_headroom(overload_manager_t* mgr) {
+	float headroom = 0.0f;
+	pthread_mutex_lock(&mgr->mutex);
+	headroom = mgr->headroom;
+	pthread_mutex_unlock(&mgr->mutex);
+	return headroom;
+}
+
+
+// ==================================================================
+//                            WATCHDOG
+// ==================================================================
+// Initialize the watchdog of the tasks running on "clock". A stall is
+// detected when a task does not complete a job for "k_periods" periods
+void watchdog_init(watchdog_t* wd, sim_clock_t* clock, int k_periods) {
+	wd->clock = clock;
+	wd->n_tasks = 0;
+	wd->k_periods = k_periods;
+	wd->n_stalls = 0;
+	ptask_mutex_init(&wd->mutex);
+}
+
+// Add a task to the set of the watched tasks
+// Return SUCCESS or ERROR_GENERIC
+int watchdog_register(watchdog_t* wd, task_info_t* task) {
+	int rv = SUCCESS;
+
+	pthread_mutex_lock(&wd->mutex);
+	if (wd->n_tasks < WATCHDOG_MAX_TASKS) {
+		wd->tasks[wd->n_tasks] = task;
+		wd->heartbeat[wd->n_tasks] = 0;
+		ptask_clock_now(wd->clock, &wd->progress[wd->n_tasks]);
+		++wd->n_tasks;
+	} else {
+		rv = ERROR_GENERIC;
+	}
+	pthread_mutex_unlock(&wd->mutex);
+	return rv;
+}
+
+// Check the heartbeats of the active tasks. A task that is not suspended
+// and whose heartbeat has not changed for k periods is marked as stalled,
+// and its phase is reported once per stall.
+// Return the number of tasks currently stalled
+int watchdog_check(watchdog_t* wd) {
+	int i = 0;
+	int heartbeat = 0;
+	int n_stalled = 0;
+	long limit_us = 0;			// max time without progress
+	struct timespec now;
+	task_info_t* task = NULL;
+
+	ptask_clock_now(wd->clock, &now);
+	pthread_mutex_lock(&wd->mutex);
+	for (i = 0; i < wd->n_tasks; ++i) {
+		task = wd->tasks[i];
+		heartbeat = __atomic_load_n(&task->heartbeat, __ATOMIC_ACQUIRE);
+
+		// idle tasks and tasks that made progress are not stalled
+		if (!__atomic_load_n(&task->is_active, __ATOMIC_ACQUIRE) ||
+				task->is_suspended || heartbeat != wd->heartbeat[i]) {
+			wd->heartbeat[i] = heartbeat;
+			time_copy(&wd->progress[i], &now);
+			task->is_stalled = false;
+			continue;
+		}
+
+		limit_us = (long) wd->k_periods *
+			__atomic_load_n(&task->period_ms, __ATOMIC_RELAXED) * 1000;
+		if (time_diff_us(&now, &wd->progress[i]) > limit_us) {
+			if (!task->is_stalled) {
+				++task->stall_count;
+				++wd->n_stalls;
+				fprintf(stderr, "Watchdog: task %d stalled (phase: %s)\n",
+					task->task_num, __atomic_load_n(&task->phase, __ATOMIC_ACQUIRE));
+			}
+			task->is_stalled = true;
+			++n_stalled;
+		}
+	}
+	pthread_mutex_unlock(&wd->mutex);
+	return n_stalled;
+}
+
+
+// ==================================================================
+//                          GRACE PERIOD
+// ==================================================================
+// Initialize a grace period without tasks. It has elapsed until started
+void grace_period_init(grace_period_t* gp) {
+	gp->n_tasks = 0;
+}
+
+// Add a task to the readers waited by the grace period
+// Return SUCCESS or ERROR_GENERIC
+int grace_period_register(grace_period_t* gp, task_info_t* task) {
+	if (gp->n_tasks == GRACE_PERIOD_MAX_TASKS) return ERROR_GENERIC;
+
+	gp->tasks[gp->n_tasks] = task;
+	gp->is_waited[gp->n_tasks] = false;
+	++gp->n_tasks;
+	return SUCCESS;
+}
+
+// Start a grace period: the jobs running now are waited
+void grace_period_start(grace_period_t* gp) {
+	task_info_t* task = NULL;
+	int i = 0;
+
+	for (i = 0; i < gp->n_tasks; ++i) {
+		task = gp->tasks[i];
+		gp->heartbeat[i] = __atomic_load_n(&task->heartbeat, __ATOMIC_ACQUIRE);
+		gp->is_waited[i] = __atomic_load_n(&task->is_active, __ATOMIC_ACQUIRE);
+	}
+}
+
+// Return true if every job running at the start of the grace period has
+// completed. A suspended task is between two jobs
+bool grace_period_elapsed(grace_period_t* gp) {
+	task_info_t* task = NULL;
+	int i = 0;
+
+	for (i = 0; i < gp->n_tasks; ++i) {
+		task = gp->tasks[i];
+		if (gp->is_waited[i] &&
+				__atomic_load_n(&task->is_active, __ATOMIC_ACQUIRE) &&
+				!__atomic_load_n(&task->is_suspended, __ATOMIC_ACQUIRE) &&
+				__atomic_load_n(&task->heartbeat, __ATOMIC_ACQUIRE) ==
+				gp->heartbeat[i])
+			return false;
+		gp->is_waited[i] = false;
+	}
+	return true;
+}
+
+
+// ==================================================================
+//                        APERIODIC SERVER
+// ==================================================================
+// Initialize a deferrable server with the provided budget. The jobs are
+// served by a task running on "clock"
+void aperiodic_server_init(aperiodic_server_t* server, sim_clock_t* clock,
+		long budget_us) {
+	pthread_condattr_t attr;
+
+	server->clock = clock;
+	server->top = 0;
+	server->bottom = 0;
+	server->budget_us = budget_us;
+	server->remaining_us = budget_us;
+	server->n_served = 0;
+	server->n_dropped = 0;
+	server->stop = false;
+	ptask_mutex_init(&server->mutex);
+
+	// the timed waits are done on the task activation times
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(&server->cond, &attr);
+	pthread_condattr_destroy(&attr);
+}
+
+// Queue an aperiodic job to the server
+// Return SUCCESS or ERROR_GENERIC if the queue is full
+int aperiodic_server_submit(aperiodic_server_t* server,
+		void (*func)(task_info_t*, void*), void* arg) {
+	int rv = SUCCESS;
+
+	pthread_mutex_lock(&server->mutex);
+	if (((server->bottom + 1) % SERVER_QUEUE_LENGTH) != server->top) {
+		server->jobs[server->bottom] = (aperiodic_job_t) {
+			.func = func,
+			.arg = arg
+		};
+		server->bottom = (server->bottom + 1) % SERVER_QUEUE_LENGTH;
+		ptask_cond_signal(server->clock, &server->cond);
+	} else {
+		++server->n_dropped;
+		rv = ERROR_GENERIC;
+	}
+	pthread_mutex_unlock(&server->mutex);
+	return rv;
+}
+
+// Body of the server task. The period of "task" is the replenishment
+// period of the server. The cpu time of each job is charged to the budget;
+// a job is never interrupted, so an overrun is subtracted from the next
+// replenishment. Return when aperiodic_server_stop is called
+void aperiodic_server_serve(aperiodic_server_t* server, task_info_t* task) {
+	aperiodic_job_t job;
+	struct timespec start_cpu;
+	struct timespec end_cpu;
+	struct timespec now;
+
+	task_set_activation(task);
+
+	pthread_mutex_lock(&server->mutex);
+	while (!server->stop) {
+		// serving the pending jobs while the budget lasts
+		while (server->top != server->bottom && server->remaining_us > 0) {
+			job = server->jobs[server->top];
+			server->top = (server->top + 1) % SERVER_QUEUE_LENGTH;
+			pthread_mutex_unlock(&server->mutex);
+
+			clock_gettime(CLOCK_THREAD_CPUTIME_ID, &start_cpu);
+			job.func(task, job.arg);
+			clock_gettime(CLOCK_THREAD_CPUTIME_ID, &end_cpu);
+
+			pthread_mutex_lock(&server->mutex);
+			server->remaining_us -= time_diff_us(&end_cpu, &start_cpu);
+			++server->n_served;
+		}
+
+		// waiting for a new job or for the replenishment
+		ptask_cond_timedwait(server->clock, &server->cond, &server->mutex,
+			&task->next_activation);
+
+		ptask_clock_now(task->clock, &now);
+		if (time_cmp(&now, &task->next_activation) >= 0) {
+			// the consumed budget is accounted as the execution time
+			task->exec_us = server->budget_us - server->remaining_us;
+			if (task->exec_us > task->max_exec_us)
+				__atomic_store_n(&task->max_exec_us, task->exec_us,
+					__ATOMIC_RELAXED);
+			__atomic_add_fetch(&task->n_jobs, 1, __ATOMIC_RELAXED);
+			__atomic_add_fetch(&task->heartbeat, 1, __ATOMIC_RELEASE);
+
+			// replenishment, keeping the debt of an overrun
+			if (server->remaining_us > 0) server->remaining_us = 0;
+			server->remaining_us += server->budget_us;
+			time_add_ms(&task->next_activation, task->period_ms);
+		}
+	}
+	pthread_mutex_unlock(&server->mutex);
+}
+
+// Ask the server task to terminate
+void aperiodic_server_stop(aperiodic_server_t* server) {
+	pthread_mutex_lock(&server->mutex);
+	server->stop = true;
+	ptask_cond_signal(server->clock, &server->cond);
+	pthread_mutex_unlock(&server->mutex);
+}
+
+
+// ==================================================================
+//                          TIMING WHEEL
+// ==================================================================
+static void _link_init(struct timer_link* list) {
+	list->next = list;
+	list->prev = list;
+}
+
+static bool _link_is_empty(const struct timer_link* list) {
+	return list->next == list;
+}
+
+static void _link_add_tail(struct timer_link* list, struct timer_link* link) {
+	link->prev = list->prev;
+	link->next = list;
+	list->prev->next = link;
+	list->prev = link;
+}
+
+static void _link_remove(struct timer_link* link) {
+	link->prev->next = link->next;
+	link->next->prev = link->prev;
+	_link_init(link);
+}
+
+// Move all the links of "src" at the end of "dst"
+static void _link_splice(struct timer_link* dst, struct timer_link* src) {
+	if (_link_is_empty(src)) return;
+	src->next->prev = dst->prev;
+	src->prev->next = dst;
+	dst->prev->next = src->next;
+	dst->prev = src->prev;
+	_link_init(src);
+}
+
+// Put the timer in the slot of its expiry tick, on the lowest level that
+// reaches it. The late timers expire at the next tick and the timers
+// beyond the last level wait in its farthest slot
+static void _timer_wheel_place(timer_wheel_t* wheel, wheel_timer_t* timer) {
+	long delta = timer->expires - wheel->current;
+	long expires = timer->expires;
+	int level = 0;
+
+	if (delta < 0) {
+		delta = 0;
+		expires = wheel->current;
+	} else if (delta >= TIMER_WHEEL_SPAN) {
+		delta = TIMER_WHEEL_SPAN - 1;
+		expires = wheel->current + delta;
+	}
+	while (level < TIMER_WHEEL_LEVELS - 1 &&
+			delta >= (1L << ((level + 1) * TIMER_WHEEL_BITS)))
+		++level;
+	_link_add_tail(&wheel->slots[level][(expires >> (level * TIMER_WHEEL_BITS))
+		& TIMER_WHEEL_MASK], &timer->link);
+}
+
+// Move the timers of the current tick to the expired list. Each time a
+// level wraps around, the next slot of the upper level is spread on the
+// lower ones
+static void _timer_wheel_tick(timer_wheel_t* wheel) {
+	struct timer_link cascade;		// timers of the upper slot
+	struct timer_link* link = NULL;
+	long index = wheel->current & TIMER_WHEEL_MASK;
+	int level = 1;
+
+	while (index == 0 && level < TIMER_WHEEL_LEVELS) {
+		index = (wheel->current >> (level * TIMER_WHEEL_BITS)) & TIMER_WHEEL_MASK;
+		_link_init(&cascade);
+		_link_splice(&cascade, &wheel->slots[level][index]);
+		while (!_link_is_empty(&cascade)) {
+			link = cascade.next;
+			_link_remove(link);
+			_timer_wheel_place(wheel, (wheel_timer_t*) link);
+		}
+		++level;
+	}
+	_link_splice(&wheel->expired,
+		&wheel->slots[0][wheel->current & TIMER_WHEEL_MASK]);
+}
+
+// Initialize an empty wheel with ticks of "tick_ms" on "clock". The tick 0
+// starts now
+void timer_wheel_init(timer_wheel_t* wheel, sim_clock_t* clock, int tick_ms) {
+	int i = 0;
+	int j = 0;
+
+	for (i = 0; i < TIMER_WHEEL_LEVELS; ++i)
+		for (j = 0; j < TIMER_WHEEL_SLOTS; ++j)
+			_link_init(&wheel->slots[i][j]);
+	_link_init(&wheel->expired);
+	wheel->tick_us = (long) tick_ms * 1000;
+	wheel->current = 0;
+	wheel->n_pending = 0;
+	wheel->clock = clock;
+	ptask_clock_now(clock, &wheel->origin);
+	ptask_mutex_init(&wheel->mutex);
+}
+
+// Initialize a timer that executes "func" when it expires
+void wheel_timer_init(wheel_timer_t* timer,
+		void (*func)(task_info_t*, void*), void* arg) {
+	_link_init(&timer->link);
+	timer->expires = 0;
+	timer->func = func;
+	timer->arg = arg;
+	timer->is_pending = false;
+}
+
+// Arm the timer to expire at "time", at the first tick that starts after
+// it. A pending timer is moved to the new time
+void timer_wheel_add(timer_wheel_t* wheel, wheel_timer_t* timer,
+		const struct timespec* time) {
+	long delay_us = time_diff_us(time, &wheel->origin);
+
+	pthread_mutex_lock(&wheel->mutex);
+	if (timer->is_pending)
+		_link_remove(&timer->link);
+	else
+		++wheel->n_pending;
+	timer->is_pending = true;
+	timer->expires = (delay_us > 0) ?
+		(delay_us + wheel->tick_us - 1) / wheel->tick_us : 0;
+	_timer_wheel_place(wheel, timer);
+	pthread_mutex_unlock(&wheel->mutex);
+}
+
+// Disarm the timer. Return true if it was pending
+bool timer_wheel_cancel(timer_wheel_t* wheel, wheel_timer_t* timer) {
+	bool was_pending = false;
+
+	pthread_mutex_lock(&wheel->mutex);
+	was_pending = timer->is_pending;
+	if (was_pending) {
+		_link_remove(&timer->link);
+		timer->is_pending = false;
+		--wheel->n_pending;
+	}
+	pthread_mutex_unlock(&wheel->mutex);
+	return was_pending;
+}
+
+bool timer_wheel_is_pending(timer_wheel_t* wheel, const wheel_timer_t* timer) {
+	bool is_pending = false;
+
+	pthread_mutex_lock(&wheel->mutex);
+	is_pending = timer->is_pending;
+	pthread_mutex_unlock(&wheel->mutex);
+	return is_pending;
+}
+
+bool timer_wheel_is_empty(timer_wheel_t* wheel) {
+	bool is_empty = false;
+
+	pthread_mutex_lock(&wheel->mutex);
+	is_empty = (wheel->n_pending == 0);
+	pthread_mutex_unlock(&wheel->mutex);
+	return is_empty;
+}
+
+// Run the ticks elapsed since the last call and execute the expired
+// timers in "task", in expiry order. The functions are called without the
+// wheel locked, so they can arm and cancel timers. An empty wheel skips
+// the elapsed ticks at once.
+// Return the number of expired timers
+int timer_wheel_run(timer_wheel_t* wheel, task_info_t* task) {
+	struct timespec now;
+	struct timer_link* link = NULL;
+	wheel_timer_t* timer = NULL;
+	long last = 0;				// last elapsed tick
+	int n_expired = 0;
+
+	ptask_clock_now(wheel->clock, &now);
+	last = time_diff_us(&now, &wheel->origin) / wheel->tick_us;
+
+	pthread_mutex_lock(&wheel->mutex);
+	while (wheel->current <= last) {
+		if (wheel->n_pending == 0) {
+			wheel->current = last + 1;
+			break;
+		}
+		_timer_wheel_tick(wheel);
+		++wheel->current;
+
+		while (!_link_is_empty(&wheel->expired)) {
+			link = wheel->expired.next;
+			timer = (wheel_timer_t*) link;
+			_link_remove(link);
+			timer->is_pending = false;
+			--wheel->n_pending;
+
+			pthread_mutex_unlock(&wheel->mutex);
+			timer->func(task, timer->arg);
+			++n_expired;
+			pthread_mutex_lock(&wheel->mutex);
+		}
+	}
+	pthread_mutex_unlock(&wheel->mutex);
+	return n_expired;
+}
+
+
 // ==================================================================
 //                    		MUTEX FUNCTIONS
 // ==================================================================
@@ -145,12 +1132,25 @@ void time_add_ms(struct timespec* time, int msec) {
 	time->tv_sec += msec / MS_IN_SEC;
 	time->tv_nsec += (msec % MS_IN_SEC) * NSEC_IN_MS;
 
-	if (time->tv_nsec > NSEC_IN_SEC) {
+	if (time->tv_nsec >= NSEC_IN_SEC) {
 		time->tv_nsec -= NSEC_IN_SEC;
 		time->tv_sec += 1;
 	}
 }
 
+// Add "usec" microseconds to "time". "usec" can be negative
+void time_add_us(struct timespec* time, long usec) {
+	time->tv_sec += usec / 1000000L;
+	time->tv_nsec += (usec % 1000000L) * 1000L;
+	if (time->tv_nsec >= NSEC_IN_SEC) {
+		time->tv_nsec -= NSEC_IN_SEC;
+		time->tv_sec += 1;
+	} else if (time->tv_nsec < 0) {
+		time->tv_nsec += NSEC_IN_SEC;
+		time->tv_sec -= 1;
+	}
+}
+
 // return:
 //   0 if t1 == t2
 //   1 if t1 > t2
@@ -161,4 +1161,10 @@ int time_cmp(const struct timespec* t1, const struct timespec* t2) {
 	if (t1->tv_nsec > t2->tv_nsec) return 1;
 	if (t1->tv_nsec < t2->tv_nsec) return -1;
 	return 0;
+}
+
+// Return t1 - t2 in microseconds
+long time_diff_us(const struct timespec* t1, const struct timespec* t2) {
+	return (t1->tv_sec - t2->tv_sec) * MS_IN_SEC * 1000 +
+		(t1->tv_nsec - t2->tv_nsec) / 1000;
 }
\ No newline at end of file
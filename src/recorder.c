@@ -0,0 +1,269 @@
+/*
+ * recorder.c
+ *
+ * Record and replay of the fleet state through memory mapped logs
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "recorder.h"
+
+// ==================================================================
+//                        ERROR MESSAGES
+// ==================================================================
+#define ERR_MSG_RECORD_OPEN		"Can't create the record %s: %s\n"
+#define ERR_MSG_RECORD_ALLOC	"Can't preallocate %ld frames for the record %s: %s\n"
+#define ERR_MSG_REPLAY_OPEN		"Can't open the record %s: %s\n"
+#define ERR_MSG_REPLAY_FORMAT	"Invalid record %s: %s\n"
+
+
+// ==================================================================
+//                           RECORDER
+// ==================================================================
+void recorder_init(recorder_t* rec) {
+	rec->fd = -1;
+	rec->header = NULL;
+	rec->frames = NULL;
+	rec->size = 0;
+	rec->n_dropped = 0;
+}
+
+// Create the log at "path" with room for "max_frames" frames. The file is
+// allocated and mapped here, so appending a frame never calls the kernel.
+// Return ERROR_GENERIC if the file can't be created or allocated
+int recorder_open(recorder_t* rec, const char* path, long max_frames,
+		int tick_ms, uint64_t seed) {
+	const size_t size = sizeof(record_header_t) +
+		(size_t) max_frames * sizeof(record_frame_t);
+	void* map = NULL;
+	int err = 0;
+
+	recorder_init(rec);
+	rec->fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (rec->fd < 0) {
+		fprintf(stderr, ERR_MSG_RECORD_OPEN, path, strerror(errno));
+		return ERROR_GENERIC;
+	}
+
+	// Reserving the blocks now, a full disk can't fault the mapping later
+	err = posix_fallocate(rec->fd, 0, (off_t) size);
+	if (err == 0) {
+		map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, rec->fd, 0);
+		if (map == MAP_FAILED) err = errno;
+	}
+	if (err != 0) {
+		fprintf(stderr, ERR_MSG_RECORD_ALLOC, max_frames, path, strerror(err));
+		close(rec->fd);
+		rec->fd = -1;
+		return ERROR_GENERIC;
+	}
+
+	rec->header = (record_header_t*) map;
+	rec->frames = (record_frame_t*) (rec->header + 1);
+	rec->size = size;
+	*rec->header = (record_header_t) {
+		.version = RECORD_VERSION,
+		.header_size = sizeof(record_header_t),
+		.frame_size = sizeof(record_frame_t),
+		.max_airplanes = AIRPLANE_POOL_SIZE,
+		.tick_ms = (uint32_t) tick_ms,
+		.max_frames = (uint64_t) max_frames,
+		.seed = seed,
+		.n_frames = 0
+	};
+	strncpy(rec->header->magic, RECORD_MAGIC, sizeof(rec->header->magic));
+	return SUCCESS;
+}
+
+bool recorder_is_open(const recorder_t* rec) {
+	return rec->header != NULL;
+}
+
+// Append the state of the airplanes at time t. The frame is written in
+// place in the mapping; when the log is full the frame is dropped
+void recorder_append(recorder_t* rec, long t_us, const airplane_t* airplanes,
+		int n) {
+	const uint64_t index = rec->header ? rec->header->n_frames : 0;
+	record_frame_t* frame = NULL;
+	record_airplane_t* dst = NULL;
+	int i = 0;
+
+	if (!rec->header) return;
+	if (index >= rec->header->max_frames) {
+		++rec->n_dropped;
+		return;
+	}
+
+	frame = &rec->frames[index];
+	frame->t_us = t_us;
+	frame->n_airplanes = (uint32_t) (n < AIRPLANE_POOL_SIZE ? n : AIRPLANE_POOL_SIZE);
+	frame->reserved = 0;
+	for (i = 0; i < (int) frame->n_airplanes; ++i) {
+		dst = &frame->airplanes[i];
+		*dst = (record_airplane_t) {
+			.unique_id = airplanes[i].unique_id,
+			.x = airplanes[i].x,
+			.y = airplanes[i].y,
+			.angle = airplanes[i].angle,
+			.vel = airplanes[i].vel,
+			.traj_index = (int16_t) airplanes[i].traj_index,
+			.status = (uint8_t) airplanes[i].status,
+			.flags = (uint8_t) ((airplanes[i].traj_finished ?
+				RECORD_FLAG_TRAJ_FINISHED : 0) |
+				(airplanes[i].hold_short ? RECORD_FLAG_HOLD_SHORT : 0)),
+			.runway_id = (int8_t) airplanes[i].runway_id,
+			.gate_id = (int8_t) airplanes[i].gate_id,
+			.reserved = 0
+		};
+	}
+
+	// Publishing the frame only once it is complete
+	__atomic_store_n(&rec->header->n_frames, index + 1, __ATOMIC_RELEASE);
+}
+
+// Close the log, trimming the frames that were not used
+void recorder_close(recorder_t* rec) {
+	size_t used = 0;
+
+	if (!rec->header) return;
+	used = sizeof(record_header_t) +
+		(size_t) rec->header->n_frames * sizeof(record_frame_t);
+	if (rec->n_dropped > 0)
+		fprintf(stderr, "Record full: %ld frames dropped\n", rec->n_dropped);
+
+	munmap(rec->header, rec->size);
+	if (ftruncate(rec->fd, (off_t) used) != 0)
+		fprintf(stderr, "Can't trim the record: %s\n", strerror(errno));
+	close(rec->fd);
+	rec->fd = -1;
+	rec->header = NULL;
+	rec->frames = NULL;
+}
+
+
+// ==================================================================
+//                            REPLAY
+// ==================================================================
+// Return NULL if the header describes a log this build can read, the
+// reason otherwise
+const char* _replay_check_header(const record_header_t* header, size_t size) {
+	if (size < sizeof(record_header_t))
+		return "truncated header";
+	if (strncmp(header->magic, RECORD_MAGIC, sizeof(header->magic)) != 0)
+		return "not a record";
+	if (header->version != RECORD_VERSION)
+		return "unsupported version";
+	if (header->header_size != sizeof(record_header_t) ||
+			header->frame_size != sizeof(record_frame_t) ||
+			header->max_airplanes != AIRPLANE_POOL_SIZE)
+		return "frame layout of another build";
+	return NULL;
+}
+
+// Map the log at "path" for reading. A log still being recorded can be
+// opened: only the frames written so far are read.
+// Return ERROR_GENERIC if the file can't be read or is not a valid log
+int replay_open(replay_t* replay, const char* path) {
+	struct stat st;
+	const char* err = NULL;
+	void* map = NULL;
+	long n_stored = 0;
+
+	replay->fd = open(path, O_RDONLY);
+	if (replay->fd < 0 || fstat(replay->fd, &st) != 0) {
+		fprintf(stderr, ERR_MSG_REPLAY_OPEN, path, strerror(errno));
+		if (replay->fd >= 0) close(replay->fd);
+		return ERROR_GENERIC;
+	}
+	replay->size = (size_t) st.st_size;
+	if (replay->size < sizeof(record_header_t)) {
+		fprintf(stderr, ERR_MSG_REPLAY_FORMAT, path, "truncated header");
+		close(replay->fd);
+		return ERROR_GENERIC;
+	}
+
+	map = mmap(NULL, replay->size, PROT_READ, MAP_SHARED, replay->fd, 0);
+	if (map == MAP_FAILED) {
+		fprintf(stderr, ERR_MSG_REPLAY_OPEN, path, strerror(errno));
+		close(replay->fd);
+		return ERROR_GENERIC;
+	}
+	replay->map = map;
+	replay->header = (const record_header_t*) map;
+	err = _replay_check_header(replay->header, replay->size);
+	if (err) {
+		fprintf(stderr, ERR_MSG_REPLAY_FORMAT, path, err);
+		replay_close(replay);
+		return ERROR_GENERIC;
+	}
+
+	replay->frames = (const record_frame_t*) (replay->header + 1);
+	n_stored = (long) ((replay->size - sizeof(record_header_t)) /
+		sizeof(record_frame_t));
+	replay->n_frames = (long) __atomic_load_n(&replay->header->n_frames,
+		__ATOMIC_ACQUIRE);
+	if (replay->n_frames > n_stored)
+		replay->n_frames = n_stored;
+	return SUCCESS;
+}
+
+// Return the frame at "index", NULL if it is out of the log
+const record_frame_t* replay_frame(const replay_t* replay, long index) {
+	if (index < 0 || index >= replay->n_frames) return NULL;
+	return &replay->frames[index];
+}
+
+// Return the index of the last frame recorded at or before t, 0 if t
+// precedes the whole log. The frames are sorted by time
+long replay_seek(const replay_t* replay, long t_us) {
+	long lo = 0;
+	long hi = replay->n_frames;
+	long mid = 0;
+
+	while (hi - lo > 1) {
+		mid = lo + (hi - lo) / 2;
+		if (replay->frames[mid].t_us <= t_us)
+			lo = mid;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+// Rebuild the airplane drawn by the renderer. The trajectory is not
+// recorded, only its index
+void replay_get_airplane(const record_airplane_t* src, airplane_t* dst) {
+	*dst = (airplane_t) {
+		.x = src->x,
+		.y = src->y,
+		.angle = src->angle,
+		.vel = src->vel,
+		.des_traj = NULL,
+		.traj_index = src->traj_index,
+		.traj_finished = (src->flags & RECORD_FLAG_TRAJ_FINISHED) != 0,
+		.status = (enum airplane_status) src->status,
+		.unique_id = src->unique_id,
+		.kill = false,
+		.runway_id = src->runway_id,
+		.cmd_count = 0,
+		.gate_id = src->gate_id,
+		.hold_short = (src->flags & RECORD_FLAG_HOLD_SHORT) != 0,
+		.runway_hint = -1,
+		.slot_vel = 0.0f
+	};
+}
+
+void replay_close(replay_t* replay) {
+	munmap(replay->map, replay->size);
+	close(replay->fd);
+	replay->map = NULL;
+	replay->header = NULL;
+	replay->frames = NULL;
+	replay->n_frames = 0;
+}
@@ -0,0 +1,252 @@
+/*
+ * replay.c
+ *
+ * Replay of a fleet state record. With a display the frames are drawn at
+ * the chosen speed, and the keys pause, seek and change the speed. The
+ * headless build prints the frames as CSV lines for the analysis tools
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "recorder.h"
+#include "graphics.h"
+#include "ptask.h"
+#include "consts.h"
+
+#define REPLAY_USAGE			"Usage: %s [-f from_s] [-e to_s] " \
+	"[-x speed] record_file\n"
+#define REPLAY_PERIOD_MS		GRAPHIC_PERIOD_MS
+
+// Part of the record to replay
+typedef struct {
+	const char* path;
+	long from_us;
+	long to_us;							// -1 for the end of the record
+	double speed;						// 0 as fast as possible
+} replay_options_t;
+
+// Position of the replay, changed by the keys
+typedef struct {
+	long play_us;						// time of the shown frame
+	double speed;
+	bool paused;
+} replay_state_t;
+
+
+// ==================================================================
+//                      FUNCTIONS DECLARATION
+// ==================================================================
+void parse_replay_options(int argc, char* argv[], replay_options_t* options);
+double parse_seconds(const char* arg, const char* argv0);
+void replay_run(const replay_t* replay, const replay_options_t* options);
+void show_frames(BITMAP* main_box, const replay_t* replay, long first,
+	long last);
+bool read_replay_keys(replay_state_t* state);
+
+
+// ==================================================================
+//                    			MAIN
+// ==================================================================
+int main(int argc, char* argv[]) {
+	replay_options_t options;
+	replay_t replay;
+
+	parse_replay_options(argc, argv, &options);
+	if (replay_open(&replay, options.path) != SUCCESS)
+		return EXIT_FAILURE;
+	fprintf(stderr, "Record of seed %llu: %ld frames every %u ms, %.1f s\n",
+		(unsigned long long) replay.header->seed, replay.n_frames,
+		replay.header->tick_ms, replay.n_frames > 0 ? (double)
+		replay.frames[replay.n_frames - 1].t_us / 1e6 : 0.0);
+
+#ifdef HEADLESS
+	printf("t_s,id,status,x,y,angle,vel,traj_index,runway_id,gate_id\n");
+#endif
+	if (graphics_init() != SUCCESS) {
+		replay_close(&replay);
+		return EXIT_FAILURE;
+	}
+	replay_run(&replay, &options);
+	graphics_exit();
+	replay_close(&replay);
+	return 0;
+}
+
+
+// ==================================================================
+//                           OPTIONS
+// ==================================================================
+// Read the options from the command line. Exit on invalid options
+void parse_replay_options(int argc, char* argv[], replay_options_t* options) {
+	int opt = 0;
+
+	*options = (replay_options_t) {
+		.path = NULL,
+		.from_us = 0,
+		.to_us = -1,
+#ifdef HEADLESS
+		.speed = 0.0
+#else
+		.speed = 1.0
+#endif
+	};
+	while ((opt = getopt(argc, argv, "f:e:x:")) != -1) {
+		switch (opt) {
+			case 'f':
+				options->from_us = (long) (parse_seconds(optarg, argv[0]) * 1e6);
+				break;
+			case 'e':
+				options->to_us = (long) (parse_seconds(optarg, argv[0]) * 1e6);
+				break;
+			case 'x':
+				options->speed = parse_seconds(optarg, argv[0]);
+				break;
+			default:
+				fprintf(stderr, REPLAY_USAGE, argv[0]);
+				exit(EXIT_FAILURE);
+		}
+	}
+	if (optind != argc - 1) {
+		fprintf(stderr, REPLAY_USAGE, argv[0]);
+		exit(EXIT_FAILURE);
+	}
+	options->path = argv[optind];
+}
+
+// Return the non negative number in "arg". Exit if it is not valid
+double parse_seconds(const char* arg, const char* argv0) {
+	char* end = NULL;
+	double value = strtod(arg, &end);
+
+	if (end == arg || *end != '\0' || value < 0.0) {
+		fprintf(stderr, "Invalid number: %s\n", arg);
+		fprintf(stderr, REPLAY_USAGE, argv0);
+		exit(EXIT_FAILURE);
+	}
+	return value;
+}
+
+
+// ==================================================================
+//                             REPLAY
+// ==================================================================
+// Play the record from "from" to "to". The replay time advances with the
+// real time multiplied by the speed; at speed 0 all the frames are shown
+// without waiting
+void replay_run(const replay_t* replay, const replay_options_t* options) {
+	BITMAP* main_box = create_main_box();
+	struct timespec next_activation, now, prev;
+	const long end_us = (replay->n_frames > 0) ?
+		replay->frames[replay->n_frames - 1].t_us : 0;
+	const long to_us = (options->to_us >= 0 && options->to_us < end_us) ?
+		options->to_us : end_us;
+	replay_state_t state = {
+		.play_us = options->from_us,
+		.speed = options->speed,
+		.paused = false
+	};
+	long shown = replay_seek(replay, state.play_us) - 1;	// last frame shown
+	long index = 0;
+
+	ptask_clock_now(NULL, &prev);
+	time_copy(&next_activation, &prev);
+	while (replay->n_frames > 0) {
+		index = (state.speed > 0.0) ? replay_seek(replay, state.play_us) :
+			replay_seek(replay, to_us);
+		if (index != shown)
+			show_frames(main_box, replay, shown + 1, index);
+		shown = index;
+		if (state.speed <= 0.0 || !read_replay_keys(&state))
+			break;
+		// Without a display the replay ends with the last frame, with a
+		// display the last frame is held until ESC
+		if (!main_box && state.play_us >= to_us)
+			break;
+
+		time_add_ms(&next_activation, REPLAY_PERIOD_MS);
+		ptask_clock_sleep_until(NULL, &next_activation);
+		ptask_clock_now(NULL, &now);
+		if (!state.paused)
+			state.play_us += (long) ((double) time_diff_us(&now, &prev) *
+				state.speed);
+		if (state.play_us > to_us) state.play_us = to_us;
+		if (state.play_us < 0) state.play_us = 0;
+		time_copy(&prev, &now);
+	}
+	destroy_box(main_box);
+}
+
+#ifdef HEADLESS
+// Print the frames in [first, last], one line per airplane
+void show_frames(BITMAP* main_box, const replay_t* replay, long first,
+		long last) {
+	const record_frame_t* frame = NULL;
+	const record_airplane_t* a = NULL;
+	long i = 0;
+	uint32_t j = 0;
+
+	(void) main_box;
+	for (i = (first > 0 ? first : 0); i <= last; ++i) {
+		frame = replay_frame(replay, i);
+		for (j = 0; frame && j < frame->n_airplanes; ++j) {
+			a = &frame->airplanes[j];
+			printf("%.3f,%d,%u,%.2f,%.2f,%.4f,%.2f,%d,%d,%d\n",
+				(double) frame->t_us / 1e6, a->unique_id, a->status,
+				(double) a->x, (double) a->y, (double) a->angle,
+				(double) a->vel, a->traj_index, a->runway_id, a->gate_id);
+		}
+	}
+}
+
+// Without a display the replay can't be controlled
+bool read_replay_keys(replay_state_t* state) {
+	(void) state;
+	return true;
+}
+#else
+// Draw the last frame of [first, last], the previous ones are skipped
+void show_frames(BITMAP* main_box, const replay_t* replay, long first,
+		long last) {
+	const record_frame_t* frame = replay_frame(replay, last);
+	airplane_t airplane;
+	uint32_t j = 0;
+
+	(void) first;
+	clear_main_box(main_box);
+	for (j = 0; frame && j < frame->n_airplanes; ++j) {
+		replay_get_airplane(&frame->airplanes[j], &airplane);
+		draw_airplane(main_box, &airplane);
+	}
+	blit_main_box(main_box);
+}
+
+// Pause with SPACE, seek with LEFT and RIGHT, change the speed with UP
+// and DOWN. Return false when ESC is pressed
+bool read_replay_keys(replay_state_t* state) {
+	char scan = 0, ascii = 0;
+
+	if (!get_keycodes(&scan, &ascii))
+		return true;
+
+	if (scan == KEY_ESC) {
+		return false;
+	} else if (scan == KEY_SPACE) {
+		state->paused = !state->paused;
+	} else if (scan == KEY_LEFT) {
+		state->play_us -= REPLAY_SEEK_S * 1000000L;
+	} else if (scan == KEY_RIGHT) {
+		state->play_us += REPLAY_SEEK_S * 1000000L;
+	} else if (scan == KEY_UP) {
+		state->speed *= 2.0;
+	} else if (scan == KEY_DOWN && state->speed > 1.0 / 64.0) {
+		state->speed /= 2.0;
+	}
+	printf("Replay at %.1f s, speed %.3gx%s\n", (double) state->play_us / 1e6,
+		state->speed, state->paused ? ", paused" : "");
+	return true;
+}
+#endif
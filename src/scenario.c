@@ -0,0 +1,314 @@
+/*
+ * scenario.c
+ *
+ * Scheduled traffic: compiler of the text schedules and reader of the
+ * compiled scenarios. Each non empty line of a schedule that doesn't
+ * start with '#' is a spawn event:
+ *
+ *   <time s> inbound|outbound [runway <id>] [gate <id>]
+ *            [at <x> <y> <heading deg>]
+ *
+ * The lines can be in any order, the events with the same time keep the
+ * order of the file
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "scenario.h"
+
+// ==================================================================
+//                        ERROR MESSAGES
+// ==================================================================
+#define ERR_MSG_SCENARIO_OPEN	"Can't open the scenario %s: %s\n"
+#define ERR_MSG_SCENARIO_FORMAT	"Invalid scenario %s: %s\n"
+#define ERR_MSG_SCHEDULE_OPEN	"Error while opening the schedule %s\n"
+#define ERR_MSG_SCHEDULE_LINE	"Schedule %s, line %ld: %s\n"
+#define ERR_MSG_SCENARIO_WRITE	"Can't write the scenario %s: %s\n"
+
+#define SCHEDULE_LINE_LENGTH	256
+#define SCHEDULE_KEYWORD_LENGTH	16
+#define SCHEDULE_MIN_EVENTS		1024	// initial capacity of the compiler
+#define SCENARIO_TMP_SUFFIX		".tmp"
+
+
+// ==================================================================
+//                            READER
+// ==================================================================
+void scenario_init(scenario_t* sc) {
+	sc->fd = -1;
+	sc->map = NULL;
+	sc->size = 0;
+	sc->header = NULL;
+	sc->events = NULL;
+	sc->n_events = 0;
+	sc->next = 0;
+}
+
+// Return NULL if the header describes a scenario this build can read, the
+// reason otherwise
+const char* _scenario_check_header(const scenario_header_t* header,
+		size_t size) {
+	if (size < sizeof(scenario_header_t))
+		return "truncated header";
+	if (strncmp(header->magic, SCENARIO_MAGIC, sizeof(header->magic)) != 0)
+		return "not a scenario";
+	if (header->version != SCENARIO_VERSION)
+		return "unsupported version";
+	if (header->header_size != sizeof(scenario_header_t) ||
+			header->event_size != sizeof(scenario_event_t))
+		return "event layout of another build";
+	if (header->n_events > (size - sizeof(scenario_header_t)) /
+			sizeof(scenario_event_t))
+		return "truncated events";
+	return NULL;
+}
+
+// Map the compiled scenario at "path". Only the header is checked: the
+// events are read from the mapping when they are released.
+// Return ERROR_GENERIC if the file can't be read or is not a scenario
+int scenario_open(scenario_t* sc, const char* path) {
+	struct stat st;
+	const char* err = NULL;
+	void* map = NULL;
+
+	scenario_init(sc);
+	sc->fd = open(path, O_RDONLY);
+	if (sc->fd < 0 || fstat(sc->fd, &st) != 0) {
+		fprintf(stderr, ERR_MSG_SCENARIO_OPEN, path, strerror(errno));
+		if (sc->fd >= 0) close(sc->fd);
+		sc->fd = -1;
+		return ERROR_GENERIC;
+	}
+	sc->size = (size_t) st.st_size;
+	if (sc->size < sizeof(scenario_header_t)) {
+		fprintf(stderr, ERR_MSG_SCENARIO_FORMAT, path, "truncated header");
+		close(sc->fd);
+		sc->fd = -1;
+		return ERROR_GENERIC;
+	}
+
+	map = mmap(NULL, sc->size, PROT_READ, MAP_PRIVATE, sc->fd, 0);
+	if (map == MAP_FAILED) {
+		fprintf(stderr, ERR_MSG_SCENARIO_OPEN, path, strerror(errno));
+		close(sc->fd);
+		sc->fd = -1;
+		return ERROR_GENERIC;
+	}
+	sc->map = map;
+	sc->header = (const scenario_header_t*) map;
+	err = _scenario_check_header(sc->header, sc->size);
+	if (err) {
+		fprintf(stderr, ERR_MSG_SCENARIO_FORMAT, path, err);
+		scenario_close(sc);
+		return ERROR_GENERIC;
+	}
+
+	// The events are read once, in order
+	madvise(map, sc->size, MADV_SEQUENTIAL);
+	sc->events = (const scenario_event_t*) (sc->header + 1);
+	sc->n_events = (long) sc->header->n_events;
+	return SUCCESS;
+}
+
+bool scenario_is_open(const scenario_t* sc) {
+	return sc->header != NULL;
+}
+
+// Return true if all the events have been released
+bool scenario_is_done(const scenario_t* sc) {
+	return sc->next >= sc->n_events;
+}
+
+// Put in "index" the next event due at "until_us" and release it.
+// Return false if no event is due
+bool scenario_next(scenario_t* sc, long until_us, long* index) {
+	if (sc->next >= sc->n_events || sc->events[sc->next].t_us > until_us)
+		return false;
+	*index = sc->next++;
+	return true;
+}
+
+// Return the event at "index", NULL if it is out of the scenario
+const scenario_event_t* scenario_event(const scenario_t* sc, long index) {
+	if (index < 0 || index >= sc->n_events) return NULL;
+	return &sc->events[index];
+}
+
+void scenario_close(scenario_t* sc) {
+	if (sc->map) munmap(sc->map, sc->size);
+	if (sc->fd >= 0) close(sc->fd);
+	scenario_init(sc);
+}
+
+
+// ==================================================================
+//                           COMPILER
+// ==================================================================
+// Event of the schedule with its line, which breaks the ties
+typedef struct {
+	scenario_event_t event;
+	long line;
+} _schedule_entry_t;
+
+int _compare_entries(const void* a, const void* b) {
+	const _schedule_entry_t* ea = (const _schedule_entry_t*) a;
+	const _schedule_entry_t* eb = (const _schedule_entry_t*) b;
+
+	if (ea->event.t_us != eb->event.t_us)
+		return ea->event.t_us < eb->event.t_us ? -1 : 1;
+	return ea->line < eb->line ? -1 : (ea->line > eb->line);
+}
+
+// Parse a line of the schedule into "event". Return NULL on success,
+// otherwise the error message
+const char* _parse_event(const char* line, scenario_event_t* event) {
+	char keyword[SCHEDULE_KEYWORD_LENGTH];
+	double t_s = 0.0;
+	float heading_deg = 0.0f;
+	int id = 0;
+	int pos = 0;
+	int n = 0;
+
+	if (sscanf(line, "%lf %15s%n", &t_s, keyword, &pos) != 2)
+		return "expected a time and a kind";
+	if (t_s < 0.0)
+		return "negative time";
+	*event = (scenario_event_t) {
+		.t_us = (int64_t) (t_s * 1e6),
+		.flags = 0,
+		.runway = -1,
+		.gate = -1
+	};
+	if (strcmp(keyword, "inbound") == 0)
+		event->kind = INBOUND_HOLDING;
+	else if (strcmp(keyword, "outbound") == 0)
+		event->kind = OUTBOUND_HOLDING;
+	else
+		return "unknown kind";
+
+	while (sscanf(line + pos, "%15s%n", keyword, &n) == 1) {
+		pos += n;
+		if (keyword[0] == '#') break;
+		if (strcmp(keyword, "runway") == 0 || strcmp(keyword, "gate") == 0) {
+			if (sscanf(line + pos, "%d%n", &id, &n) != 1 || id < 0 ||
+					id >= (keyword[0] == 'r' ? MAX_RUNWAYS : MAX_GATES))
+				return "invalid runway or gate";
+			if (keyword[0] == 'r')
+				event->runway = (int8_t) id;
+			else
+				event->gate = (int8_t) id;
+		} else if (strcmp(keyword, "at") == 0) {
+			if (sscanf(line + pos, "%f %f %f%n", &event->x, &event->y,
+					&heading_deg, &n) != 3)
+				return "expected x, y and heading";
+			event->angle = heading_deg * M_PI_F / 180.0f;
+			event->flags |= SCENARIO_FLAG_STATE;
+		} else {
+			return "unknown keyword";
+		}
+		pos += n;
+	}
+	return NULL;
+}
+
+// Read the events of the schedule at "path" in "entries", sorted by time.
+// Return the number of events, -1 on error
+long _read_schedule(const char* path, _schedule_entry_t** entries) {
+	FILE* file = fopen(path, "r");
+	char line[SCHEDULE_LINE_LENGTH];
+	char first[2];
+	_schedule_entry_t* grown = NULL;
+	const char* err = NULL;
+	long capacity = SCHEDULE_MIN_EVENTS;
+	long n_entries = 0;
+	long line_num = 0;
+
+	if (file == NULL) {
+		fprintf(stderr, ERR_MSG_SCHEDULE_OPEN, path);
+		return -1;
+	}
+	*entries = malloc((size_t) capacity * sizeof(_schedule_entry_t));
+	if (!*entries) err = "out of memory";
+	while (err == NULL && fgets(line, sizeof(line), file) != NULL) {
+		++line_num;
+		if (sscanf(line, "%1s", first) != 1 || first[0] == '#')
+			continue;
+		if (n_entries == capacity) {
+			// The schedule is read once, its size is not known in advance
+			capacity *= 2;
+			grown = realloc(*entries, (size_t) capacity *
+				sizeof(_schedule_entry_t));
+			if (!grown) {
+				err = "out of memory";
+				break;
+			}
+			*entries = grown;
+		}
+		err = _parse_event(line, &(*entries)[n_entries].event);
+		(*entries)[n_entries++].line = line_num;
+	}
+	fclose(file);
+
+	if (err != NULL) {
+		fprintf(stderr, ERR_MSG_SCHEDULE_LINE, path, line_num, err);
+		free(*entries);
+		*entries = NULL;
+		return -1;
+	}
+	qsort(*entries, (size_t) n_entries, sizeof(_schedule_entry_t),
+		_compare_entries);
+	return n_entries;
+}
+
+// Compile the text schedule at "text_path" into the scenario at "path".
+// The scenario is written to a temporary file and renamed.
+// Return ERROR_GENERIC if the schedule is malformed or can't be written
+int scenario_compile(const char* text_path, const char* path) {
+	_schedule_entry_t* entries = NULL;
+	scenario_header_t header = {
+		.version = SCENARIO_VERSION,
+		.header_size = sizeof(scenario_header_t),
+		.event_size = sizeof(scenario_event_t),
+		.reserved = 0
+	};
+	char tmp_path[FILENAME_MAX];
+	FILE* file = NULL;
+	long n_events = _read_schedule(text_path, &entries);
+	long i = 0;
+	int ret = SUCCESS;
+
+	if (n_events < 0) return ERROR_GENERIC;
+	strncpy(header.magic, SCENARIO_MAGIC, sizeof(header.magic));
+	header.n_events = (uint64_t) n_events;
+
+	snprintf(tmp_path, sizeof(tmp_path), "%s%s", path, SCENARIO_TMP_SUFFIX);
+	file = fopen(tmp_path, "wb");
+	if (!file) {
+		fprintf(stderr, ERR_MSG_SCENARIO_WRITE, tmp_path, strerror(errno));
+		free(entries);
+		return ERROR_GENERIC;
+	}
+	if (fwrite(&header, sizeof(header), 1, file) != 1)
+		ret = ERROR_GENERIC;
+	for (i = 0; ret == SUCCESS && i < n_events; ++i) {
+		if (fwrite(&entries[i].event, sizeof(scenario_event_t), 1, file) != 1)
+			ret = ERROR_GENERIC;
+	}
+	if (fclose(file) != 0)
+		ret = ERROR_GENERIC;
+	if (ret == SUCCESS && rename(tmp_path, path) != 0)
+		ret = ERROR_GENERIC;
+	if (ret != SUCCESS) {
+		fprintf(stderr, ERR_MSG_SCENARIO_WRITE, path, strerror(errno));
+		remove(tmp_path);
+	}
+	free(entries);
+	return ret;
+}
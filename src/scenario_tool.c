@@ -0,0 +1,37 @@
+/*
+ * scenario_tool.c
+ *
+ * Compiler of the text schedules into scenarios for the simulator
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "scenario.h"
+#include "consts.h"
+
+#define SCENARIO_USAGE			"Usage: %s schedule_file scenario_file\n"
+
+
+// ==================================================================
+//                    			MAIN
+// ==================================================================
+int main(int argc, char* argv[]) {
+	scenario_t sc;
+
+	if (argc != 3) {
+		fprintf(stderr, SCENARIO_USAGE, argv[0]);
+		return EXIT_FAILURE;
+	}
+	if (scenario_compile(argv[1], argv[2]) != SUCCESS ||
+			scenario_open(&sc, argv[2]) != SUCCESS)
+		return EXIT_FAILURE;
+
+	printf("%s: %ld events", argv[2], sc.n_events);
+	if (sc.n_events > 0)
+		printf(" from %.3f s to %.3f s", (double) sc.events[0].t_us / 1e6,
+			(double) sc.events[sc.n_events - 1].t_us / 1e6);
+	printf("\n");
+	scenario_close(&sc);
+	return 0;
+}
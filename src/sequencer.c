@@ -0,0 +1,282 @@
+/*
+ * sequencer.c
+ *
+ * Arrival and departure manager. The airplanes are moved from the backlog
+ * into a bounded look-ahead window in arrival order. The window is
+ * sequenced by dynamic programming over its subsets, minimising the total
+ * delay with respect to the estimated times of arrival at the runway
+ * while keeping the minimum separations between consecutive operations.
+ * An airplane can't be delayed by more than SEQUENCER_MAX_SHIFT positions
+ * with respect to its arrival order
+ */
+
+#include <limits.h>
+#include <math.h>
+
+#include "sequencer.h"
+
+#define SEQUENCER_MIN_VEL	1.0f	// lower bound of the velocities (avoid /0)
+
+// ==================================================================
+//                            SEQUENCING
+// ==================================================================
+// Return the time needed to go from (x, y) to the first point of the
+// trajectory
+long _leg_time_us(float x, float y, const trajectory_t* traj) {
+	return (long) (hypotf(traj->x[0] - x, traj->y[0] - y) /
+		fmaxf(traj->vel[0], SEQUENCER_MIN_VEL) * 1000000.0f);
+}
+
+// Return the time needed to follow the trajectory from its first point
+// up to the end of its runway segment
+long _route_time_us(const trajectory_t* traj) {
+	float t = 0.0f;					// time in seconds
+	int i = 0;
+
+	// each leg is flown at the velocity of the point where it ends
+	for (i = 1; i < traj->segment_start[SEGMENT_EXIT] && i < traj->size; ++i)
+		t += traj->length[i - 1] / fmaxf(traj->vel[i], SEQUENCER_MIN_VEL);
+	return (long) (t * 1000000.0f);
+}
+
+// Update the estimated time needed by the airplane in the slot to clear
+// its runway, considering the best runway
+void _sequencer_estimate(sequencer_t* seq, sequencer_slot_t* slot) {
+	const airport_t* airport = seq->airport;
+	const traj_set_t* set = seq->trajectories;
+	const trajectory_t* traj = NULL;
+	long route_us = 0;				// cached time along the trajectory
+	long eta_us = 0;
+	float x, y;						// airplane position
+	int gate = -1;					// gate node of an outbound airplane
+	int entry = -1;					// entry node of the runway
+	int i = 0;
+
+	pthread_mutex_lock(&slot->airplane->mutex);
+	x = slot->airplane->airplane.x;
+	y = slot->airplane->airplane.y;
+	slot->is_arrival = (slot->airplane->airplane.status == INBOUND_HOLDING);
+	if (!slot->is_arrival)
+		gate = airport->gates[slot->airplane->airplane.gate_id];
+	pthread_mutex_unlock(&slot->airplane->mutex);
+
+	slot->eta_us = LONG_MAX;
+	for (i = 0; i < airport->n_runways; ++i) {
+		if (!set->is_in_use[i]) continue;
+		if (slot->is_arrival) {
+			traj = set->landing[i];
+			route_us = seq->landing_us[i];
+			eta_us = _leg_time_us(x, y, traj) + route_us;
+		} else {
+			// the airplane taxies from its gate to the runway entry
+			traj = set->departure[i];
+			entry = airport->runways[i].entry_node;
+			route_us = seq->departure_us[i];
+			eta_us = (long) (airport->taxiway.dist[gate][entry] /
+				TAXI_TRAJ_VEL * 1000000.0f) + _leg_time_us(
+				airport->taxiway.nodes[entry].x, airport->taxiway.nodes[entry].y,
+				traj) + route_us;
+		}
+		if (eta_us < slot->eta_us)
+			slot->eta_us = eta_us;
+	}
+}
+
+// Return the minimum separation between two consecutive operations. The
+// separation is shared among the runways in use
+long _sequencer_separation_us(const sequencer_t* seq,
+		const sequencer_slot_t* first, const sequencer_slot_t* second) {
+	long sep_ms = 0;
+
+	if (first->is_arrival)
+		sep_ms = second->is_arrival ? SEP_ARR_ARR_MS : SEP_ARR_DEP_MS;
+	else
+		sep_ms = second->is_arrival ? SEP_DEP_ARR_MS : SEP_DEP_DEP_MS;
+	return sep_ms * 1000 / seq->n_in_use;
+}
+
+// Compute the sequence of the window. The optimal policy searches the
+// order with the minimum total delay, FCFS keeps the arrival order
+void _sequencer_plan(sequencer_t* seq) {
+	const int n = seq->n_window;
+	const int full = (1 << n) - 1;	// subset with all the airplanes
+	sequencer_state_t* state = NULL;
+	sequencer_state_t* next = NULL;
+	long time_us = 0;
+	long delay_us = 0;
+	int mask = 0;
+	int pos = 0;					// position of the next airplane
+	int i = 0;
+	int j = 0;
+	int k = 0;
+
+	seq->n_sequence = n;
+	if (n == 0) return;
+
+	if (seq->policy == SEQUENCER_FCFS) {
+		for (i = 0; i < n; ++i)
+			seq->sequence[i] = i;
+		return;
+	}
+
+	for (mask = 1; mask <= full; ++mask)
+		for (j = 0; j < n; ++j)
+			seq->dp[mask][j].delay_us = LONG_MAX;
+
+	// Each airplane can start the sequence at its eta
+	for (j = 0; j < n; ++j)
+		seq->dp[1 << j][j] = (sequencer_state_t) {
+			.delay_us = 0,
+			.time_us = seq->window[j].eta_us,
+			.prev = -1
+		};
+
+	// Extending the partial sequences in order of subset
+	for (mask = 1; mask < full; ++mask) {
+		pos = __builtin_popcount((unsigned int) mask);
+		for (j = 0; j < n; ++j) {
+			state = &seq->dp[mask][j];
+			if (state->delay_us == LONG_MAX) continue;
+
+			for (k = 0; k < n; ++k) {
+				if ((mask & (1 << k)) || pos - k > SEQUENCER_MAX_SHIFT)
+					continue;
+
+				time_us = state->time_us + _sequencer_separation_us(seq,
+					&seq->window[j], &seq->window[k]);
+				if (time_us < seq->window[k].eta_us)
+					time_us = seq->window[k].eta_us;
+				delay_us = state->delay_us + time_us - seq->window[k].eta_us;
+
+				next = &seq->dp[mask | (1 << k)][k];
+				if (delay_us < next->delay_us ||
+						(delay_us == next->delay_us && time_us < next->time_us))
+					*next = (sequencer_state_t) {
+						.delay_us = delay_us,
+						.time_us = time_us,
+						.prev = j
+					};
+			}
+		}
+	}
+
+	// Picking the best complete sequence and walking it backward
+	j = 0;
+	for (i = 1; i < n; ++i) {
+		if (seq->dp[full][i].delay_us < seq->dp[full][j].delay_us ||
+				(seq->dp[full][i].delay_us == seq->dp[full][j].delay_us &&
+				seq->dp[full][i].time_us < seq->dp[full][j].time_us))
+			j = i;
+	}
+	mask = full;
+	while (mask != 0) {
+		pos = __builtin_popcount((unsigned int) mask);
+		seq->sequence[pos - 1] = j;
+		i = seq->dp[mask][j].prev;
+		mask &= ~(1 << j);
+		j = i;
+	}
+}
+
+// ==================================================================
+//                         SEQUENCER FUNCTIONS
+// ==================================================================
+// Initialize the sequencer and compute the runway time of the routes
+void sequencer_init(sequencer_t* seq, const airport_t* airport,
+		const traj_set_t* trajectories, enum sequencer_policy policy) {
+	seq->backlog_top = 0;
+	seq->backlog_bottom = 0;
+	seq->n_window = 0;
+	seq->n_sequence = 0;
+	seq->ticks = 0;
+	seq->policy = policy;
+	seq->airport = airport;
+	sequencer_set_trajectories(seq, trajectories);
+	seq->is_dirty = false;
+}
+
+// Estimate the next plans on the routes of "trajectories". The window is
+// planned again
+void sequencer_set_trajectories(sequencer_t* seq,
+		const traj_set_t* trajectories) {
+	int i = 0;
+
+	seq->trajectories = trajectories;
+	seq->version = trajectories->version;
+	seq->n_in_use = 0;
+	for (i = 0; i < seq->airport->n_runways; ++i) {
+		seq->landing_us[i] = _route_time_us(trajectories->landing[i]);
+		seq->departure_us[i] = _route_time_us(trajectories->departure[i]);
+		seq->n_in_use += trajectories->is_in_use[i] ? 1 : 0;
+	}
+	seq->is_dirty = true;
+}
+
+// Add an airplane to the backlog. ERROR_GENERIC is returned if the
+// backlog is full
+int sequencer_add(sequencer_t* seq, shared_airplane_t* airplane) {
+	int bottom = (seq->backlog_bottom + 1) % AIRPLANE_QUEUE_LENGTH;
+
+	if (bottom == seq->backlog_top)
+		return ERROR_GENERIC;
+	seq->backlog[seq->backlog_bottom] = airplane;
+	seq->backlog_bottom = bottom;
+	return SUCCESS;
+}
+
+// Move the airplanes from the backlog to the window and update the
+// sequence. The sequence is computed again only when the window has
+// changed or every SEQUENCER_REPLAN_PERIODS calls, to follow the etas
+void sequencer_update(sequencer_t* seq) {
+	int i = 0;
+
+	while (seq->n_window < SEQUENCER_WINDOW &&
+			seq->backlog_top != seq->backlog_bottom) {
+		seq->window[seq->n_window++].airplane = seq->backlog[seq->backlog_top];
+		seq->backlog_top = (seq->backlog_top + 1) % AIRPLANE_QUEUE_LENGTH;
+		seq->is_dirty = true;
+	}
+
+	if (!seq->is_dirty && seq->ticks < SEQUENCER_REPLAN_PERIODS - 1) {
+		++seq->ticks;
+		return;
+	}
+
+	for (i = 0; i < seq->n_window; ++i)
+		_sequencer_estimate(seq, &seq->window[i]);
+	_sequencer_plan(seq);
+	seq->is_dirty = false;
+	seq->ticks = 0;
+}
+
+// Remove the first airplane of the sequence. NULL is returned if the
+// sequence is empty. The rest of the sequence is kept
+shared_airplane_t* sequencer_pop(sequencer_t* seq) {
+	shared_airplane_t* airplane = NULL;
+	int w = 0;			// window index of the first airplane
+	int i = 0;
+
+	if (seq->n_sequence == 0)
+		return NULL;
+
+	w = seq->sequence[0];
+	airplane = seq->window[w].airplane;
+
+	// Removing the airplane from the window keeping the arrival order
+	for (i = w + 1; i < seq->n_window; ++i)
+		seq->window[i - 1] = seq->window[i];
+	--seq->n_window;
+
+	for (i = 1; i < seq->n_sequence; ++i) {
+		seq->sequence[i - 1] = seq->sequence[i];
+		if (seq->sequence[i - 1] > w) --seq->sequence[i - 1];
+	}
+	--seq->n_sequence;
+	seq->is_dirty = true;
+	return airplane;
+}
+
+// Check if there are no airplanes waiting for a runway
+bool sequencer_is_empty(const sequencer_t* seq) {
+	return seq->n_window == 0 && seq->backlog_top == seq->backlog_bottom;
+}
@@ -0,0 +1,2481 @@
+/*
+ * simulation.c
+ *
+ * Simulated airport: the airplane tasks, the system tasks and the
+ * functions they share. All the state is kept in the simulation context,
+ * which is the argument of every task
+ */
+
+#include <stdbool.h>
+#include <pthread.h>
+#include <math.h>
+#include <stdio.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "simulation.h"
+#include "checkpoint.h"
+#include "graphics.h"
+
+
+// ==================================================================
+//                        ERROR MESSAGES
+// ==================================================================
+#define ERR_MSG_TASK_CREATE 	"Error while creating %s. Errno %d\n"
+#define ERR_MSG_TASK_CREATE_AIR "Error while creating airplane task %d. Errno %d\n"
+#define ERR_MSG_TASK_JOIN   	"Error while joining %s. Errno %d\n"
+#define ERR_MSG_TASK_JOIN_AIR   "Error while joining airplane task %d. Errno %d\n"
+#define ERR_MSG_TASK_AIR_DM		"Airplane task %02d - deadline missed\n"
+#define ERR_MSG_CHECKPOINT		"Checkpoint not saved to %s\n"
+#define ERR_MSG_SPAWN_STATUS	"Invalid spawn status: %d\n"
+#define ERR_MSG_TRAJ_ARENA		"Not enough space for the trajectories\n"
+#define ERR_MSG_TRAJ_RUNWAYS	"No runway in use\n"
+#define ERR_MSG_TRAJ_RETIRED	"Previous trajectories still in use\n"
+#define ERR_MSG_TRAJ_LAYOUT		"%s: layout differs from the running airport\n"
+#define ERR_MSG_TRAJ_DEPARTURE	"No departure from gate %d to runway %d for %d\n"
+
+
+// ==================================================================
+//                      FUNCTIONS DECLARATION
+// ==================================================================
+// Init functions
+int init_runway_trajectories(const airport_t* airport, traj_bank_t* bank,
+	traj_set_t* set, unsigned runways);
+int init_gate_trajectories(sim_context_t* ctx);
+int init_departure_trajectories(sim_context_t* ctx);
+void init_task_states(sim_context_t* ctx);
+void init_system_state(sim_context_t* ctx);
+
+// Task functions
+void* graphic_task(void* arg);
+void* airplane_task(void* arg);
+void* traffic_controller_task(void* arg);
+void* input_task(void* arg);
+void* random_gen_task(void* arg);
+void* overload_task(void* arg);
+void* server_task(void* arg);
+void* watchdog_task(void* arg);
+void* separation_task(void* arg);
+void* conflict_task(void* arg);
+
+// Aperiodic jobs
+void key_command_job(task_info_t* task, void* arg);
+void spawn_request_job(task_info_t* task, void* arg);
+void scenario_spawn_job(task_info_t* task, void* arg);
+void retry_deferred_job(task_info_t* task, void* arg);
+
+// Timer functions
+void traffic_timer_expired(task_info_t* task, void* arg);
+void scenario_timer_expired(task_info_t* task, void* arg);
+void retry_timer_expired(task_info_t* task, void* arg);
+void arm_sim_timer(sim_context_t* ctx, wheel_timer_t* timer, long t_us);
+
+// Admission control
+void request_airplane(sim_context_t* ctx, const spawn_request_t* request);
+void retry_deferred_airplanes(sim_context_t* ctx);
+bool admission_test(sim_context_t* ctx, enum airplane_status status);
+void update_admission_stats(sim_context_t* ctx, int admitted, int deferred,
+	int rejected);
+
+// Airplane spawning functions
+void spawn_airplane(sim_context_t* ctx, const spawn_request_t* request);
+void spawn_inbound_airplane(sim_context_t* ctx, const scenario_event_t* event);
+void spawn_outbound_airplane(sim_context_t* ctx, const scenario_event_t* event);
+void run_new_airplane(sim_context_t* ctx, shared_airplane_t* airplane);
+void start_airplane_task(sim_context_t* ctx, int airplane_id);
+
+// Airplane control
+int airplane_period_ms(const airplane_t* airplane);
+void airplane_controller_evolve(airplane_t* airplane, float dt);
+void compute_airplane_controls(const airplane_t* airplane,
+	const waypoint_t* des_point, float* accel_cmd, float* omega_cmd);
+void update_airplane_state(airplane_t* airplane, float accel_cmd, 
+	float omega_cmd, float dt);
+void update_airplane_des_trajectory(airplane_t* airplane, 
+	const waypoint_t* des_point);
+bool airplane_runway_cleared(const airplane_t* airplane);
+float wrap_angle_pi(float angle);
+float points_distance(float x1, float y1, float x2, float y2);
+
+// Trajectory update
+void reclaim_trajectories(sim_context_t* ctx);
+
+// Traffic controller
+void traffic_controller_set_runways(sim_context_t* ctx, const traj_set_t* set);
+void traffic_controller_free_runway(sim_context_t* ctx, int runway_id);
+int traffic_controller_pick_runway(sim_context_t* ctx,
+	const shared_airplane_t* airplane);
+int traffic_controller_assign_runway(sim_context_t* ctx, int runway_id,
+	shared_airplane_t* airplane);
+
+// Taxiing
+void update_taxi_reservations(sim_context_t* ctx, airplane_t* airplane,
+	int* reserved, int* released);
+
+// Graphic task functions
+int update_main_box(sim_context_t* ctx, BITMAP* main_box, airplane_t* airplanes,
+	cbuffer_t* trails, bool draw_trails);
+int copy_shared_airplanes(sim_context_t* ctx, airplane_t* dst, int max_size);
+void update_airplane_trail(const airplane_t* airplane, cbuffer_t* trail);
+void handle_trails(BITMAP* bitmap, airplane_t* airplanes, int n_airplanes,
+	cbuffer_t* trails, bool show_trails);
+void toggle_trails(sim_context_t* ctx);
+void toggle_next_waypoint(sim_context_t* ctx);
+int adapt_graphic_period(int period_ms, long frame_cost_us, float headroom,
+	int level);
+
+// Utility functions
+void update_task_states(sim_context_t* ctx, const task_info_t* task_info);
+void update_task_stall_states(sim_context_t* ctx);
+void suspend_task(sim_context_t* ctx, task_info_t* task_info);
+void job_gate_enter(sim_context_t* ctx);
+void job_gate_exit(sim_context_t* ctx);
+float linear_interpolate(float start, float end, int n, int index);
+float get_random_float(sim_context_t* ctx, float min, float max);
+void get_random_inbound_state(sim_context_t* ctx, float* x, float* y,
+	float* angle);
+void get_random_outbound_state(sim_context_t* ctx, float* x, float* y,
+	float* angle);
+
+
+// ==================================================================
+//                         SIMULATION RUN
+// ==================================================================
+// Set the default parameters: the bundled airport in real time, with
+// the default traffic
+void sim_config_init(sim_config_t* config) {
+	*config = (sim_config_t) {
+		.airport_file = AIRPORT_FILE,
+		.clock_mode = SIM_CLOCK_REAL,
+		.clock_scale = 1.0f,
+		.seed = (uint64_t) time(NULL),
+		.n_inbound = 0,
+		.n_outbound = 0,
+		.random_gen = false,
+		.n_runways = 0,
+		.update_s = -1,
+		.update_file = NULL,
+		.update_runways = 0,
+		.policy = SEQUENCER_OPTIMAL,
+		.duration_s = HEADLESS_DURATION_S,
+		.display = false,
+		.verbose = true,
+		.scenario_file = NULL,
+		.record_file = NULL,
+		.checkpoint_file = NULL,
+		.restore_file = NULL
+	};
+	traffic_params_init(&config->traffic);
+}
+
+// Select the time base of the simulation: "afap" runs as fast as possible,
+// a number N runs N times faster than the real time. NULL is the real time
+int sim_config_set_clock(sim_config_t* config, const char* clock_arg) {
+	float scale = 1.0f;
+	char* end = NULL;
+
+	if (!clock_arg) {
+		config->clock_mode = SIM_CLOCK_REAL;
+		config->clock_scale = 1.0f;
+	} else if (strcmp(clock_arg, "afap") == 0) {
+		config->clock_mode = SIM_CLOCK_AFAP;
+		config->clock_scale = 1.0f;
+	} else {
+		scale = strtof(clock_arg, &end);
+		if (end == clock_arg || *end != '\0' || scale <= 0.0f) {
+			fprintf(stderr, "Invalid clock: %s (expected afap or a scale)\n",
+				clock_arg);
+			return ERROR_GENERIC;
+		}
+		config->clock_mode = SIM_CLOCK_SCALED;
+		config->clock_scale = scale;
+	}
+	return SUCCESS;
+}
+
+// Submit the airplanes of the configuration and start the random
+// generation if requested. The tasks must be created
+void sim_start_traffic(sim_context_t* ctx) {
+	int i = 0;
+
+	for (i = 0; i < ctx->config.n_inbound; ++i)
+		sim_submit_spawn(ctx, INBOUND_HOLDING);
+	for (i = 0; i < ctx->config.n_outbound; ++i)
+		sim_submit_spawn(ctx, OUTBOUND_HOLDING);
+	if (ctx->config.random_gen && !ctx->enable_random_gen)
+		sim_toggle_random_gen(ctx);
+}
+
+// Submit the spawn of an airplane to the aperiodic server
+void sim_submit_spawn(sim_context_t* ctx, enum airplane_status status) {
+	aperiodic_server_submit(&ctx->aperiodic_server, spawn_request_job,
+		(void*) (intptr_t) status);
+}
+
+// Run a simulation without display for the duration of its configuration.
+// The calling thread holds the simulated time until the end of the
+// scenario, then lets the tasks terminate.
+// Return ERROR_GENERIC if the simulation can't be initialized
+int sim_run(const sim_config_t* config, sim_results_t* results) {
+	sim_context_t* ctx = malloc(sizeof(sim_context_t));
+	struct timespec sim_start, sim_end;
+	struct timespec real_start, real_end;
+
+	if (!ctx) {
+		fprintf(stderr, "Can't allocate the simulation context\n");
+		return ERROR_GENERIC;
+	}
+	if (sim_init(ctx, config) != SUCCESS) {
+		free(ctx);
+		return ERROR_GENERIC;
+	}
+	ctx->config.display = false;
+	sim_create_tasks(ctx);
+	ptask_clock_now(&ctx->clock, &sim_start);
+	clock_gettime(CLOCK_MONOTONIC, &real_start);
+
+	sim_start_traffic(ctx);
+
+	// Replacing the routes in the middle of the run
+	time_copy(&sim_end, &sim_start);
+	if (config->update_s >= 0 && config->update_s < config->duration_s) {
+		sim_end.tv_sec += config->update_s;
+		ptask_clock_sleep_until(&ctx->clock, &sim_end);
+		job_gate_enter(ctx);
+		sim_update_trajectories(ctx, config->update_file,
+			config->update_runways);
+		job_gate_exit(ctx);
+		time_copy(&sim_end, &sim_start);
+	}
+	sim_end.tv_sec += config->duration_s;
+	ptask_clock_sleep_until(&ctx->clock, &sim_end);
+	if (config->checkpoint_file)
+		sim_checkpoint(ctx, config->checkpoint_file);
+	sim_stop(ctx);
+	ptask_clock_now(&ctx->clock, &sim_end);
+	clock_gettime(CLOCK_MONOTONIC, &real_end);
+
+	ptask_clock_start(&ctx->clock);
+	sim_join(ctx);
+	// A restored simulation is measured from its original start
+	sim_get_results(ctx, (double) time_diff_us(&sim_end, &ctx->start_time) / 1e6,
+		(double) time_diff_us(&real_end, &real_start) / 1e6, results);
+
+	// Ensure correct deallocation of the airplanes
+	assert(ctx->airplane_pool.n_free == AIRPLANE_POOL_SIZE);
+	free(ctx);
+	return SUCCESS;
+}
+
+// Copy the job statistics of a task
+void _copy_task_stats(sim_task_stats_t* stats, const char* name, long jobs,
+		int deadline_miss, long max_exec_us) {
+	snprintf(stats->name, sizeof(stats->name), "%s", name);
+	stats->jobs = jobs;
+	stats->deadline_miss = deadline_miss;
+	stats->max_exec_us = max_exec_us;
+}
+
+// Collect the results of a simulation that lasted "sim_s" simulated
+// seconds and "real_s" wall clock seconds
+void sim_get_results(sim_context_t* ctx, double sim_s, double real_s,
+		sim_results_t* results) {
+	system_state_t state;
+	const task_info_t* task = NULL;
+	int i = 0;
+
+	pthread_mutex_lock(&ctx->system_state.mutex);
+	state = ctx->system_state.state;
+	pthread_mutex_unlock(&ctx->system_state.mutex);
+
+	*results = (sim_results_t) {
+		.sim_s = sim_s,
+		.real_s = real_s,
+		.n_admitted = state.n_admitted,
+		.n_deferred = state.n_deferred,
+		.n_rejected = state.n_rejected,
+		.n_landed = state.n_landed,
+		.n_departed = state.n_departed,
+		.throughput_h = sim_s > 0.0 ? 3600.0 *
+			(double) (state.n_landed + state.n_departed) / sim_s : 0.0,
+		.n_delays = state.n_delays,
+		.mean_delay_s = state.n_delays > 0 ? (double) state.total_delay_us /
+			(1e6 * (double) state.n_delays) : 0.0,
+		.max_delay_s = (double) state.max_delay_us / 1e6,
+		.n_separation_checks = state.n_separation_checks,
+		.separation_loss = state.n_separation_checks > 0 ?
+			(double) state.n_separation_losses /
+			(double) state.n_separation_checks : 0.0,
+		.min_separation = state.min_separation,
+		.n_stalls = ctx->watchdog.n_stalls,
+		.n_task_stats = 0
+	};
+
+	_copy_task_stats(&results->airplane_stats, "Airplanes",
+		state.airplane_jobs, state.airplane_deadline_miss,
+		state.airplane_max_exec_us);
+	for (i = 0; i < N_SYSTEM_TASKS; ++i) {
+		task = ctx->system_task_infos[i];
+		if (task->n_jobs > 0)
+			_copy_task_stats(&results->task_stats[results->n_task_stats++],
+				ctx->task_states[task->task_num].str, task->n_jobs,
+				task->deadline_miss, task->max_exec_us);
+	}
+}
+
+// ==================================================================
+//                           AIRPLANE TASK
+// ==================================================================
+void* airplane_task(void* arg) {
+	task_info_t* task_info = (task_info_t*) arg;
+	sim_context_t* ctx = (sim_context_t*) task_info->arg;
+	shared_airplane_t* global_airplane_ptr =
+		&ctx->airplane_pool.elems[task_info->task_num];
+	// Local copy of the airplane information
+	airplane_t local_airplane = global_airplane_ptr->airplane;
+	bool was_cleared = false;		// runway cleared before the control step
+	const int id = task_info->task_num;
+	int period_ms = AIRPLANE_PERIOD_MS;	// period of the current phase
+
+	ctx->task_states[task_info->task_num].is_running = true;
+	task_set_activation(task_info);
+
+	while (!ctx->end_all && !local_airplane.kill) {
+		job_gate_enter(ctx);
+
+		// Updating the local copy of the airplane struct
+		task_set_phase(task_info, "lock airplane (read)");
+		pthread_mutex_lock(&global_airplane_ptr->mutex);
+		local_airplane = global_airplane_ptr->airplane;
+		pthread_mutex_unlock(&global_airplane_ptr->mutex);
+
+		// Computing control and updating the airplane state
+		task_set_phase(task_info, "taxi reservations");
+		if (local_airplane.status == OUTBOUND_TAKEOFF)
+			update_taxi_reservations(ctx, &local_airplane,
+				&ctx->taxi_reserved[id], &ctx->taxi_released[id]);
+		task_set_phase(task_info, "holding slot");
+		if (local_airplane.status == INBOUND_HOLDING)
+			holding_track_slot(&ctx->holding_manager, &local_airplane);
+		else
+			local_airplane.slot_vel = 0.0f;
+
+		// Adapting the rate to the phase of the flight. The integration
+		// step covers the time up to the next activation
+		period_ms = airplane_period_ms(&local_airplane);
+		if (period_ms != task_info->period_ms)
+			task_set_period(task_info, period_ms, period_ms);
+
+		task_set_phase(task_info, "control");
+		was_cleared = airplane_runway_cleared(&local_airplane);
+		airplane_controller_evolve(&local_airplane, (float) period_ms / 1000.0f);
+
+		// Updating the global airplane struct. If the controller has sent
+		// a command in the meantime the update is discarded
+		task_set_phase(task_info, "lock airplane (write)");
+		pthread_mutex_lock(&global_airplane_ptr->mutex);
+		if (global_airplane_ptr->airplane.cmd_count == local_airplane.cmd_count)
+			global_airplane_ptr->airplane = local_airplane;
+		else
+			local_airplane = global_airplane_ptr->airplane;
+		pthread_mutex_unlock(&global_airplane_ptr->mutex);
+
+		// Notifying the controller that the runway can be released as soon
+		// as the runway segment has been cleared
+		if (!was_cleared && airplane_runway_cleared(&local_airplane)) {
+			runway_queue_push(&ctx->released_runways, local_airplane.runway_id);
+			task_resume(&ctx->traffic_ctrl_task_info);
+		}
+
+		// The airplane leaves the system at the end of the exit route
+		if (local_airplane.traj_finished &&
+				(local_airplane.status == INBOUND_LANDING ||
+				local_airplane.status == OUTBOUND_TAKEOFF))
+			local_airplane.kill = true;
+		job_gate_exit(ctx);
+
+		// Ending task instance
+		task_set_phase(task_info, "end of job");
+		if (task_deadline_missed(task_info)) {
+			fprintf(stderr, ERR_MSG_TASK_AIR_DM,task_info->task_num);
+		}
+		update_task_states(ctx, task_info);
+		task_wait_for_activation(task_info);
+	}
+	
+	if (ctx->config.verbose)
+		printf("Killing airplane task %d\n", task_info->task_num);
+	job_gate_enter(ctx);
+	airplane_pool_free(&ctx->airplane_pool, global_airplane_ptr);
+	pthread_mutex_lock(&ctx->system_state.mutex);
+	--ctx->system_state.state.n_airplanes;
+	if (local_airplane.kill && local_airplane.status == INBOUND_LANDING)
+		++ctx->system_state.state.n_landed;
+	else if (local_airplane.kill)
+		++ctx->system_state.state.n_departed;
+	ctx->system_state.state.airplane_jobs += task_info->n_jobs;
+	ctx->system_state.state.airplane_deadline_miss += task_info->deadline_miss;
+	if (task_info->max_exec_us > ctx->system_state.state.airplane_max_exec_us)
+		ctx->system_state.state.airplane_max_exec_us = task_info->max_exec_us;
+	pthread_mutex_unlock(&ctx->system_state.mutex);
+	ctx->task_states[task_info->task_num].is_running = false;
+	job_gate_exit(ctx);
+
+	// The released utilization may allow a deferred airplane to spawn
+	aperiodic_server_submit(&ctx->aperiodic_server, retry_deferred_job, NULL);
+
+	return NULL;
+}
+
+
+// ==================================================================
+//                     TRAFFIC CONTROLLER TASK
+// ==================================================================
+void* traffic_controller_task(void* arg) {
+	task_info_t* task_info = (task_info_t*) arg;
+	sim_context_t* ctx = (sim_context_t*) task_info->arg;
+	int runway_id = 0;
+	shared_airplane_t* airplane = NULL;
+	const traj_set_t* set = NULL;
+
+	ctx->task_states[task_info->task_num].is_running = true;
+	task_set_activation(task_info);
+
+	while (!ctx->end_all) {
+		job_gate_enter(ctx);
+
+		// Following the last published trajectories
+		task_set_phase(task_info, "trajectories");
+		set = sim_trajectories(ctx);
+		if (ctx->sequencer.version != set->version) {
+			sequencer_set_trajectories(&ctx->sequencer, set);
+			traffic_controller_set_runways(ctx, set);
+		}
+
+		// Freeing the runways released since the last job
+		task_set_phase(task_info, "runway release");
+		while (runway_queue_pop(&ctx->released_runways, &runway_id))
+			traffic_controller_free_runway(ctx, runway_id);
+
+		// Sequencing the queued airplanes
+		task_set_phase(task_info, "sequencing");
+		while ((airplane = airplane_queue_pop(&ctx->airplane_queue)) != NULL)
+			sequencer_add(&ctx->sequencer, airplane);
+		sequencer_update(&ctx->sequencer);
+
+		// Assigning the free runways following the sequence
+		task_set_phase(task_info, "runway handover");
+		while (ctx->n_free_runways > 0 &&
+				(airplane = sequencer_pop(&ctx->sequencer)) != NULL) {
+			runway_id = traffic_controller_pick_runway(ctx, airplane);
+			if (traffic_controller_assign_runway(ctx, runway_id, airplane) ==
+					SUCCESS)
+				continue;
+			// the airplane keeps holding and is sequenced again next job
+			ctx->free_runways[ctx->n_free_runways++] = runway_id;
+			sequencer_add(&ctx->sequencer, airplane);
+		}
+
+		// Updating the system state
+		task_set_phase(task_info, "lock system state");
+		pthread_mutex_lock(&ctx->system_state.mutex);
+		ctx->system_state.state.n_free_runways = ctx->n_free_runways;
+		pthread_mutex_unlock(&ctx->system_state.mutex);
+		job_gate_exit(ctx);
+
+		// Ending task instance
+		if (task_deadline_missed(task_info)) {
+			fprintf(stderr, "Traffic controller task deadline missed\n");
+		}
+		update_task_states(ctx, task_info);
+
+		// Going dormant until a new airplane is queued, otherwise waiting for
+		// the next activation or for a runway release
+		if (ctx->n_free_runways == ctx->sequencer.n_in_use &&
+				sequencer_is_empty(&ctx->sequencer) &&
+				airplane_queue_is_empty(&ctx->airplane_queue))
+			suspend_task(ctx, task_info);
+		task_wait_for_activation_or_event(task_info);
+	}
+
+	ctx->task_states[task_info->task_num].is_running = false;
+	return NULL;
+}
+
+
+// ==================================================================
+//                           GRAPHIC TASK
+// ==================================================================
+void* graphic_task(void* arg) {
+	task_info_t* task_info = (task_info_t*) arg;
+	sim_context_t* ctx = (sim_context_t*) task_info->arg;
+	BITMAP* sidebar_box = create_sidebar_box();
+	BITMAP* main_box = create_main_box();
+	int i = 0;
+	int level = 0;		// overload degradation level
+	int frame = 0;		// frame counter used to slow down the sidebar
+	int period_ms = GRAPHIC_PERIOD_MS;	// adapted period
+	int adapt_frame = 0;		// frame counter used to adapt the period
+	int n_airplanes = 0;		// numb. of airplanes drawn in the frame
+	int prev_n_airplanes = 0;	// numb. of airplanes drawn in the previous frame
+	long frame_cost_us = 0;		// filtered cpu time of a frame
+
+	airplane_t local_airplanes[MAX_AIRPLANE];
+	cbuffer_t airplane_trails[MAX_AIRPLANE];
+
+	for (i = 0; i < MAX_AIRPLANE; ++i)
+		cbuffer_init(&airplane_trails[i]);
+
+	ctx->task_states[task_info->task_num].is_running = true;
+	task_set_activation(task_info);
+
+	while (!ctx->end_all) {
+		level = overload_manager_get_level(&ctx->overload_manager);
+		task_set_phase(task_info, "main box");
+		clear_main_box(main_box);
+
+		// Drawing Main Box
+		n_airplanes = update_main_box(ctx, main_box, local_airplanes, airplane_trails,
+			ctx->show_trails && level < OVERLOAD_LEVEL_NO_TRAILS);
+		blit_main_box(main_box);
+
+		// Drawing Status Box
+		task_set_phase(task_info, "sidebar");
+		if (level < OVERLOAD_LEVEL_SLOW_SIDEBAR || frame == 0) {
+			update_sidebar_box(sidebar_box, &ctx->system_state, ctx->task_states, N_TASKS);
+			blit_sidebar_box(sidebar_box);
+		}
+		frame = (frame + 1) % DEGRADED_SIDEBAR_DIVIDER;
+
+		// Ending task instance
+		if (task_deadline_missed(task_info)) {
+			fprintf(stderr, "Graphic task - Deadline miss\n");
+		}
+
+		// Adapting the frame rate to the available cpu
+		frame_cost_us = (7 * frame_cost_us + task_info->exec_us) / 8;
+		adapt_frame = (adapt_frame + 1) % GRAPHIC_ADAPT_FRAMES;
+		if (adapt_frame == 0) {
+			period_ms = adapt_graphic_period(task_info->period_ms, frame_cost_us,
+				overload_manager_get_headroom(&ctx->overload_manager), level);
+			task_set_period(task_info, period_ms, period_ms);
+
+			pthread_mutex_lock(&ctx->system_state.mutex);
+			ctx->system_state.state.graphic_period_ms = period_ms;
+			pthread_mutex_unlock(&ctx->system_state.mutex);
+		}
+		update_task_states(ctx, task_info);
+
+		// Going dormant when the empty scene has been drawn and is static
+		if (n_airplanes == 0 && prev_n_airplanes == 0) {
+			update_sidebar_box(sidebar_box, &ctx->system_state, ctx->task_states, N_TASKS);
+			blit_sidebar_box(sidebar_box);
+			suspend_task(ctx, task_info);
+		}
+		prev_n_airplanes = n_airplanes;
+		task_wait_for_activation(task_info);
+	}
+
+	if (ctx->config.verbose)
+		printf("Exiting...\n");
+	ctx->task_states[task_info->task_num].is_running = false;
+	destroy_box(main_box);
+	destroy_box(sidebar_box);
+  return NULL;
+}
+
+
+// ==================================================================
+//                           INPUT TASK
+// ==================================================================
+void* input_task(void* arg) {
+	task_info_t* task_info = (task_info_t*) arg;
+	sim_context_t* ctx = (sim_context_t*) task_info->arg;
+
+	char scan = '\0';
+	char ascii = '\0';
+	bool got_key = false;
+
+	ctx->task_states[task_info->task_num].is_running = true;
+	task_set_activation(task_info);
+
+	do {
+		// The commands are executed by the aperiodic server
+		got_key =  get_keycodes(&scan, &ascii);
+		if (got_key && scan == KEY_C) {
+			// Taken here: the aperiodic jobs are held by the checkpoint
+			sim_checkpoint(ctx, ctx->config.checkpoint_file);
+		} else if (got_key && scan != KEY_ESC) {
+			aperiodic_server_submit(&ctx->aperiodic_server, key_command_job,
+				(void*) (intptr_t) scan);
+		}
+
+		// Ending task instance
+		if (task_deadline_missed(task_info))
+			fprintf(stderr, "Input task deadline missed\n");
+		update_task_states(ctx, task_info);
+		if (scan != KEY_ESC)
+			task_wait_for_activation(task_info);
+	} while (scan != KEY_ESC);
+
+	if (ctx->config.verbose)
+		printf("Exiting...\n");
+	ctx->task_states[task_info->task_num].is_running = false;
+	sim_stop(ctx);
+	return NULL;
+}
+
+
+// ==================================================================
+//                     RANDOM GENERATION TASK
+// ==================================================================
+void* random_gen_task(void* arg) {
+	task_info_t* task_info = (task_info_t*) arg;
+	sim_context_t* ctx = (sim_context_t*) task_info->arg;
+	struct timespec now;
+	long now_us = 0;				// time from the start of the simulation
+	// generation enabled at the last job. A restored generation goes on: its
+	// timer is armed before the task starts
+	bool was_enabled = timer_wheel_is_pending(&ctx->timers, &ctx->traffic_timer);
+
+	ctx->task_states[task_info->task_num].is_running = true;
+	task_set_activation(task_info);
+
+	while (!ctx->end_all) {
+		job_gate_enter(ctx);
+		ptask_clock_now(&ctx->clock, &now);
+		now_us = time_diff_us(&now, &ctx->start_time);
+
+		// The generation restarts from now every time it is enabled
+		if (ctx->enable_random_gen && !was_enabled) {
+			traffic_start(&ctx->traffic, (double) now_us / 1e6);
+			traffic_timer_expired(task_info, NULL);
+		} else if (!ctx->enable_random_gen && was_enabled) {
+			timer_wheel_cancel(&ctx->timers, &ctx->traffic_timer);
+		}
+		was_enabled = ctx->enable_random_gen;
+
+		// Retrying the deferred spawns while there are some
+		if (!spawn_wait_list_is_empty(&ctx->spawn_wait_list) &&
+				!timer_wheel_is_pending(&ctx->timers, &ctx->retry_timer))
+			arm_sim_timer(ctx, &ctx->retry_timer,
+				now_us + SPAWN_RETRY_PERIOD_MS * 1000L);
+
+		// Expiring the spawns and the retries due since the last job
+		task_set_phase(task_info, "timers");
+		timer_wheel_run(&ctx->timers, task_info);
+		job_gate_exit(ctx);
+
+		// Ending task instance
+		if (task_deadline_missed(task_info)) {
+			fprintf(stderr, "Traffic controller task deadline missed\n");
+		}
+		update_task_states(ctx, task_info);
+
+		// Going dormant while there is nothing to generate or retry
+		if (timer_wheel_is_empty(&ctx->timers) &&
+				spawn_wait_list_is_empty(&ctx->spawn_wait_list))
+			suspend_task(ctx, task_info);
+		task_wait_for_activation(task_info);
+	}
+
+	ctx->task_states[task_info->task_num].is_running = false;
+	return NULL;
+}
+
+
+// ==================================================================
+//                     OVERLOAD MANAGER TASK
+// ==================================================================
+void* overload_task(void* arg) {
+	task_info_t* task_info = (task_info_t*) arg;
+	sim_context_t* ctx = (sim_context_t*) task_info->arg;
+	int level = 0;		// degradation level
+	int change = 0;		// level change of the last update
+
+	ctx->task_states[task_info->task_num].is_running = true;
+	task_set_activation(task_info);
+
+	while (!ctx->end_all) {
+		change = overload_manager_update(&ctx->overload_manager, &level);
+		if (ctx->config.verbose && change > 0)
+			fprintf(stderr, "Overload detected: degradation level %d\n", level);
+		else if (ctx->config.verbose && change < 0)
+			fprintf(stderr, "Headroom recovered: degradation level %d\n", level);
+
+		// Updating the system state
+		pthread_mutex_lock(&ctx->system_state.mutex);
+		ctx->system_state.state.overload_level = level;
+		pthread_mutex_unlock(&ctx->system_state.mutex);
+
+		// Ending task instance
+		if (task_deadline_missed(task_info)) {
+			fprintf(stderr, "Overload manager task deadline missed\n");
+		}
+		update_task_states(ctx, task_info);
+		task_wait_for_activation(task_info);
+	}
+
+	ctx->task_states[task_info->task_num].is_running = false;
+	return NULL;
+}
+
+
+// ==================================================================
+//                      APERIODIC SERVER TASK
+// ==================================================================
+void* server_task(void* arg) {
+	task_info_t* task_info = (task_info_t*) arg;
+	sim_context_t* ctx = (sim_context_t*) task_info->arg;
+
+	ctx->task_states[task_info->task_num].is_running = true;
+	aperiodic_server_serve(&ctx->aperiodic_server, task_info);
+	ctx->task_states[task_info->task_num].is_running = false;
+	return NULL;
+}
+
+// ==================================================================
+//                           WATCHDOG TASK
+// ==================================================================
+void* watchdog_task(void* arg) {
+	task_info_t* task_info = (task_info_t*) arg;
+	sim_context_t* ctx = (sim_context_t*) task_info->arg;
+
+	ctx->task_states[task_info->task_num].is_running = true;
+	task_set_activation(task_info);
+
+	while (!ctx->end_all) {
+		watchdog_check(&ctx->watchdog);
+		update_task_stall_states(ctx);
+
+		// Reclaiming the replaced trajectories, unless being replaced
+		if (pthread_mutex_trylock(&ctx->traj_mutex) == 0) {
+			reclaim_trajectories(ctx);
+			pthread_mutex_unlock(&ctx->traj_mutex);
+		}
+
+		// Ending task instance
+		if (task_deadline_missed(task_info)) {
+			fprintf(stderr, "Watchdog task deadline missed\n");
+		}
+		update_task_states(ctx, task_info);
+		task_wait_for_activation(task_info);
+	}
+
+	ctx->task_states[task_info->task_num].is_running = false;
+	return NULL;
+}
+
+// ==================================================================
+//                      SEPARATION MONITOR TASK
+// ==================================================================
+void* separation_task(void* arg) {
+	task_info_t* task_info = (task_info_t*) arg;
+	sim_context_t* ctx = (sim_context_t*) task_info->arg;
+	airplane_t local_airplanes[MAX_AIRPLANE];
+	spatial_entry_t entries[MAX_AIRPLANE];
+	separation_violation_t violations[MAX_SEPARATION_VIOLATIONS];
+	struct timespec now;
+	int n_airplanes = 0;
+	int n_entries = 0;
+	int n_violations = 0;
+	int i = 0;
+
+	ctx->task_states[task_info->task_num].is_running = true;
+	task_set_activation(task_info);
+
+	while (!ctx->end_all) {
+		task_set_phase(task_info, "copy airplanes");
+		n_airplanes = copy_shared_airplanes(ctx, local_airplanes, MAX_AIRPLANE);
+
+		// Recording the fleet state of the tick
+		if (recorder_is_open(&ctx->recorder)) {
+			task_set_phase(task_info, "record");
+			ptask_clock_now(&ctx->clock, &now);
+			recorder_append(&ctx->recorder, time_diff_us(&now, &ctx->start_time),
+				local_airplanes, n_airplanes);
+		}
+
+		// Indexing the airplanes that have left the gates
+		n_entries = 0;
+		for (i = 0; i < n_airplanes; ++i) {
+			if (local_airplanes[i].status == OUTBOUND_HOLDING) continue;
+			entries[n_entries++] = (spatial_entry_t) {
+				.x = local_airplanes[i].x,
+				.y = local_airplanes[i].y,
+				.id = local_airplanes[i].unique_id
+			};
+		}
+
+		task_set_phase(task_info, "separation check");
+		spatial_grid_build(&ctx->separation_grid, entries, n_entries);
+		n_violations = spatial_grid_violations(&ctx->separation_grid,
+			SEPARATION_MIN_DIST, violations, MAX_SEPARATION_VIOLATIONS);
+
+		task_set_phase(task_info, "lock system state");
+		pthread_mutex_lock(&ctx->system_state.mutex);
+		ctx->system_state.state.n_violations = n_violations;
+		if (n_entries > 1)
+			++ctx->system_state.state.n_separation_checks;
+		if (n_violations > 0)
+			++ctx->system_state.state.n_separation_losses;
+		for (i = 0; i < n_violations && i < MAX_SEPARATION_VIOLATIONS; ++i) {
+			ctx->system_state.state.violations[i] = violations[i];
+			if (violations[i].distance < ctx->system_state.state.min_separation)
+				ctx->system_state.state.min_separation = violations[i].distance;
+		}
+		pthread_mutex_unlock(&ctx->system_state.mutex);
+
+		// Ending task instance
+		task_set_phase(task_info, "end of job");
+		if (task_deadline_missed(task_info)) {
+			fprintf(stderr, "Separation task deadline missed\n");
+		}
+		update_task_states(ctx, task_info);
+
+		// Going dormant until a new airplane is spawned
+		if (n_airplanes == 0)
+			suspend_task(ctx, task_info);
+		task_wait_for_activation(task_info);
+	}
+
+	ctx->task_states[task_info->task_num].is_running = false;
+	return NULL;
+}
+
+// ==================================================================
+//                      CONFLICT PREDICTION TASK
+// ==================================================================
+void* conflict_task(void* arg) {
+	task_info_t* task_info = (task_info_t*) arg;
+	sim_context_t* ctx = (sim_context_t*) task_info->arg;
+	airplane_t local_airplanes[MAX_AIRPLANE];
+	conflict_t conflicts[MAX_CONFLICTS];
+	int n_airplanes = 0;
+	int n_conflicts = 0;
+	int i = 0;
+
+	ctx->task_states[task_info->task_num].is_running = true;
+	task_set_activation(task_info);
+
+	while (!ctx->end_all) {
+		// Predicting the tracks of the airplanes that have left the gates
+		task_set_phase(task_info, "copy airplanes");
+		n_airplanes = copy_shared_airplanes(ctx, local_airplanes, MAX_AIRPLANE);
+
+		task_set_phase(task_info, "conflict prediction");
+		conflict_clear(&ctx->conflict_predictor);
+		for (i = 0; i < n_airplanes; ++i) {
+			if (local_airplanes[i].status != OUTBOUND_HOLDING)
+				conflict_add_airplane(&ctx->conflict_predictor, &local_airplanes[i]);
+		}
+		n_conflicts = conflict_detect(&ctx->conflict_predictor, conflicts,
+			MAX_CONFLICTS);
+
+		task_set_phase(task_info, "lock system state");
+		pthread_mutex_lock(&ctx->system_state.mutex);
+		ctx->system_state.state.n_conflicts = n_conflicts;
+		for (i = 0; i < n_conflicts && i < MAX_CONFLICTS; ++i)
+			ctx->system_state.state.conflicts[i] = conflicts[i];
+		pthread_mutex_unlock(&ctx->system_state.mutex);
+
+		// Ending task instance
+		task_set_phase(task_info, "end of job");
+		if (task_deadline_missed(task_info)) {
+			fprintf(stderr, "Conflict task deadline missed\n");
+		}
+		update_task_states(ctx, task_info);
+
+		// Going dormant until a new airplane is spawned
+		if (n_airplanes == 0)
+			suspend_task(ctx, task_info);
+		task_wait_for_activation(task_info);
+	}
+
+	ctx->task_states[task_info->task_num].is_running = false;
+	return NULL;
+}
+
+// Return the mask of the runways in use in the published set
+unsigned _runways_in_use(sim_context_t* ctx) {
+	const traj_set_t* set = sim_trajectories(ctx);
+	unsigned runways = 0;
+	int i = 0;
+
+	for (i = 0; i < ctx->airport.n_runways; ++i)
+		if (set->is_in_use[i])
+			runways |= 1u << i;
+	return runways;
+}
+
+// Reload the routes with the runway put in or out of use. The last runway
+// in use is kept
+void _toggle_runway(sim_context_t* ctx, int runway_id) {
+	unsigned runways = 0;
+
+	if (runway_id >= ctx->airport.n_runways) return;
+	runways = _runways_in_use(ctx) ^ (1u << runway_id);
+	if (runways == 0)
+		fprintf(stderr, ERR_MSG_TRAJ_RUNWAYS);
+	else
+		sim_update_trajectories(ctx, NULL, runways);
+}
+
+// Execute a keyboard command. "arg" is the scan code of the key
+void key_command_job(task_info_t* task, void* arg) {
+	sim_context_t* ctx = (sim_context_t*) task->arg;
+	int scan = (int) (intptr_t) arg;
+
+	job_gate_enter(ctx);
+	if (scan == KEY_O) {
+		request_airplane(ctx, &(spawn_request_t) {OUTBOUND_HOLDING, -1});
+	} else if (scan == KEY_I) {
+		request_airplane(ctx, &(spawn_request_t) {INBOUND_HOLDING, -1});
+	} else if (scan == KEY_T) {
+		toggle_trails(ctx);
+	} else if (scan == KEY_W) {
+		toggle_next_waypoint(ctx);
+	} else if (scan == KEY_R) {
+		sim_toggle_random_gen(ctx);
+	} else if (scan == KEY_U) {
+		sim_update_trajectories(ctx, NULL, _runways_in_use(ctx));
+	} else if (scan >= KEY_1 && scan <= KEY_8) {
+		_toggle_runway(ctx, scan - KEY_1);
+	}
+	job_gate_exit(ctx);
+}
+
+// Request the spawn of an airplane. "arg" is the initial status
+void spawn_request_job(task_info_t* task, void* arg) {
+	sim_context_t* ctx = (sim_context_t*) task->arg;
+
+	job_gate_enter(ctx);
+	request_airplane(ctx, &(spawn_request_t) {
+		(enum airplane_status) (intptr_t) arg, -1});
+	job_gate_exit(ctx);
+}
+
+// Request the spawn of a scheduled airplane. "arg" is the index of the
+// event in the scenario
+void scenario_spawn_job(task_info_t* task, void* arg) {
+	sim_context_t* ctx = (sim_context_t*) task->arg;
+	const long index = (long) (intptr_t) arg;
+	const scenario_event_t* event = scenario_event(&ctx->scenario, index);
+
+	if (!event) return;
+	job_gate_enter(ctx);
+	request_airplane(ctx, &(spawn_request_t) {
+		(enum airplane_status) event->kind, index});
+	job_gate_exit(ctx);
+}
+
+// Spawn the deferred airplanes that pass the admission test
+void retry_deferred_job(task_info_t* task, void* arg) {
+	sim_context_t* ctx = (sim_context_t*) task->arg;
+
+	(void) arg;
+	job_gate_enter(ctx);
+	retry_deferred_airplanes(ctx);
+	job_gate_exit(ctx);
+}
+
+
+// ==================================================================
+//                          TIMER FUNCTIONS
+// ==================================================================
+// The timers expire in the random generation task, with the job gate held
+
+// Arm the traffic timer on the next random spawn, if any
+void _arm_traffic_timer(sim_context_t* ctx) {
+	if (isfinite(ctx->traffic.next_s))
+		arm_sim_timer(ctx, &ctx->traffic_timer,
+			(long) ceil(ctx->traffic.next_s * 1e6));
+}
+
+// Arm the scenario timer on the next scheduled spawn, if any
+void _arm_scenario_timer(sim_context_t* ctx) {
+	if (!scenario_is_done(&ctx->scenario))
+		arm_sim_timer(ctx, &ctx->scenario_timer, (long) scenario_event(
+			&ctx->scenario, ctx->scenario.next)->t_us);
+}
+
+// Request the random spawns due and wait for the next one
+void traffic_timer_expired(task_info_t* task, void* arg) {
+	sim_context_t* ctx = (sim_context_t*) task->arg;
+	struct timespec now;
+	double now_s = 0.0;
+	enum airplane_status kind;
+
+	(void) arg;
+	ptask_clock_now(&ctx->clock, &now);
+	now_s = (double) time_diff_us(&now, &ctx->start_time) / 1e6;
+	while (traffic_next(&ctx->traffic, now_s, &kind))
+		sim_submit_spawn(ctx, kind);
+	_arm_traffic_timer(ctx);
+}
+
+// Release the scheduled spawns due and wait for the next one
+void scenario_timer_expired(task_info_t* task, void* arg) {
+	sim_context_t* ctx = (sim_context_t*) task->arg;
+	struct timespec now;
+	long now_us = 0;
+	long event = 0;
+
+	(void) arg;
+	ptask_clock_now(&ctx->clock, &now);
+	now_us = time_diff_us(&now, &ctx->start_time);
+	while (scenario_next(&ctx->scenario, now_us, &event))
+		aperiodic_server_submit(&ctx->aperiodic_server, scenario_spawn_job,
+			(void*) (intptr_t) event);
+	_arm_scenario_timer(ctx);
+}
+
+// Retry the deferred spawns, the random generation task re-arms the timer
+// while some are left
+void retry_timer_expired(task_info_t* task, void* arg) {
+	sim_context_t* ctx = (sim_context_t*) task->arg;
+
+	(void) arg;
+	aperiodic_server_submit(&ctx->aperiodic_server, retry_deferred_job, NULL);
+}
+
+// Arm the timer at "t_us" from the start of the simulation
+void arm_sim_timer(sim_context_t* ctx, wheel_timer_t* timer, long t_us) {
+	struct timespec time;
+
+	time_copy(&time, &ctx->start_time);
+	time_add_us(&time, t_us);
+	timer_wheel_add(&ctx->timers, timer, &time);
+}
+
+
+// ==================================================================
+//                      FUNCTIONS DEFINITION
+// ==================================================================
+// Initialize the simulation described by the configuration. The tasks
+// are not created. Return ERROR_GENERIC if the airport can't be loaded
+int sim_init(sim_context_t* ctx, const sim_config_t* config) {
+	pthread_rwlockattr_t gate_attr;
+	struct timespec now;
+	int i = 0;
+	int record_s = 0;					// recorded time
+
+	ctx->config = *config;
+	rng_init(&ctx->rng, config->seed, RNG_STREAM_SPAWN);
+	traffic_init(&ctx->traffic, &config->traffic, config->seed);
+	ctx->next_gate = 0;
+	ctx->airplane_wcet_us = ADMISSION_AIRPLANE_WCET_US;
+	ctx->show_trails = true;
+	ctx->show_next_waypoint = false;
+	ctx->enable_random_gen = false;
+	ctx->end_all = false;
+	memset(ctx->airplane_joinable, 0, sizeof(ctx->airplane_joinable));
+	memset(ctx->taxi_reserved, 0, sizeof(ctx->taxi_reserved));
+	memset(ctx->taxi_released, 0, sizeof(ctx->taxi_released));
+	ctx->system_task_infos[0] = &ctx->graphic_task_info;
+	ctx->system_task_infos[1] = &ctx->input_task_info;
+	ctx->system_task_infos[2] = &ctx->traffic_ctrl_task_info;
+	ctx->system_task_infos[3] = &ctx->random_gen_task_info;
+	ctx->system_task_infos[4] = &ctx->overload_task_info;
+	ctx->system_task_infos[5] = &ctx->server_task_info;
+	ctx->system_task_infos[6] = &ctx->watchdog_task_info;
+	ctx->system_task_infos[7] = &ctx->separation_task_info;
+	ctx->system_task_infos[8] = &ctx->conflict_task_info;
+	ptask_clock_init(&ctx->clock, config->clock_mode, config->clock_scale);
+	ptask_clock_now(&ctx->clock, &ctx->start_time);
+	timer_wheel_init(&ctx->timers, &ctx->clock, RANDOM_GEN_PERIOD_MS);
+	wheel_timer_init(&ctx->traffic_timer, traffic_timer_expired, NULL);
+	wheel_timer_init(&ctx->scenario_timer, scenario_timer_expired, NULL);
+	wheel_timer_init(&ctx->retry_timer, retry_timer_expired, NULL);
+	// The routes are loaded in the first bank, the other one takes the
+	// updates
+	traj_arena_init(&ctx->trajectories);
+	for (i = 0; i < TRAJ_SET_VERSIONS; ++i) {
+		if (traj_arena_reserve(&ctx->trajectories, &ctx->traj_banks[i],
+				TRAJ_SET_MAX_POINTS, TRAJ_SET_MAX_TRAJS) != SUCCESS) {
+			fprintf(stderr, ERR_MSG_TRAJ_ARENA);
+			return ERROR_GENERIC;
+		}
+	}
+	if (airport_load(&ctx->airport, config->airport_file,
+			&ctx->traj_banks[0], &ctx->traj_sets[0]) != SUCCESS)
+		return ERROR_GENERIC;
+
+	// A frame is recorded at each separation check
+	recorder_init(&ctx->recorder);
+	record_s = config->display ? RECORD_MAX_S : config->duration_s + 1;
+	if (config->record_file && recorder_open(&ctx->recorder,
+			config->record_file, (long) record_s * (1000 / SEPARATION_PERIOD_MS),
+			SEPARATION_PERIOD_MS, config->seed) != SUCCESS)
+		return ERROR_GENERIC;
+
+	// Leaving the last runways unused
+	if (config->n_runways > 0 && config->n_runways < ctx->airport.n_runways)
+		ctx->airport.n_runways = config->n_runways;
+
+	// Stack of the free runways, the controller never scans all the runways
+	for (i = 0; i < MAX_RUNWAYS; ++i)
+		ctx->runways[i] = NULL;
+	for (i = 0; i < ctx->airport.n_runways; ++i)
+		ctx->free_runways[i] = ctx->airport.n_runways - 1 - i;
+	ctx->n_free_runways = ctx->airport.n_runways;
+
+	// Trajectories initialization, all the runways are in use
+	if (init_runway_trajectories(&ctx->airport, &ctx->traj_banks[0],
+			&ctx->traj_sets[0], 0) != SUCCESS) {
+		recorder_close(&ctx->recorder);
+		return ERROR_GENERIC;
+	}
+	if (init_gate_trajectories(ctx) != SUCCESS ||
+			init_departure_trajectories(ctx) != SUCCESS) {
+		fprintf(stderr, ERR_MSG_TRAJ_ARENA);
+		recorder_close(&ctx->recorder);
+		return ERROR_GENERIC;
+	}
+	ctx->traj_sets[0].version = 0;
+	ctx->traj_set = &ctx->traj_sets[0];
+	ctx->traj_retired = -1;
+	ctx->traj_is_draining = false;
+	ptask_mutex_init(&ctx->traj_mutex);
+	holding_init(&ctx->holding_manager, &ctx->airport, ctx->traj_set,
+		&ctx->clock);
+	sequencer_init(&ctx->sequencer, &ctx->airport, ctx->traj_set,
+		config->policy);
+
+	airplane_queue_init(&ctx->airplane_queue);
+	runway_queue_init(&ctx->released_runways);
+	airplane_pool_init(&ctx->airplane_pool);
+	spawn_wait_list_init(&ctx->spawn_wait_list);
+	ptask_mutex_init(&ctx->admission_mutex);
+
+	// A waiting checkpoint stops new jobs, so it can't be starved
+	pthread_rwlockattr_init(&gate_attr);
+	pthread_rwlockattr_setkind_np(&gate_attr,
+		PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+	pthread_rwlock_init(&ctx->job_gate, &gate_attr);
+	pthread_rwlockattr_destroy(&gate_attr);
+	aperiodic_server_init(&ctx->aperiodic_server, &ctx->clock, SERVER_BUDGET_US);
+	watchdog_init(&ctx->watchdog, &ctx->clock, WATCHDOG_STALL_PERIODS);
+	spatial_grid_init(&ctx->separation_grid, -0.5f * (float) MAIN_BOX_WIDTH,
+		-0.5f * (float) MAIN_BOX_HEIGHT, (float) MAIN_BOX_WIDTH,
+		(float) MAIN_BOX_HEIGHT, SEPARATION_MIN_DIST);
+	conflict_init(&ctx->conflict_predictor, CONFLICT_HORIZON_S, SEPARATION_MIN_DIST);
+	init_task_states(ctx);
+	init_system_state(ctx);
+
+	// The airplane tasks are always monitored by the overload manager
+	// and by the watchdog
+	overload_manager_init(&ctx->overload_manager, OVERLOAD_MAX_LEVEL);
+	for (i = 0; i < MAX_AIRPLANE; ++i) {
+		overload_manager_register(&ctx->overload_manager, &ctx->airplane_task_infos[i]);
+		watchdog_register(&ctx->watchdog, &ctx->airplane_task_infos[i]);
+	}
+
+	// Any task but the watchdog, which reclaims them, may read the
+	// trajectories
+	grace_period_init(&ctx->traj_grace);
+	for (i = 0; i < MAX_AIRPLANE; ++i)
+		grace_period_register(&ctx->traj_grace, &ctx->airplane_task_infos[i]);
+	for (i = 0; i < N_SYSTEM_TASKS; ++i)
+		if (ctx->system_task_infos[i] != &ctx->watchdog_task_info)
+			grace_period_register(&ctx->traj_grace, ctx->system_task_infos[i]);
+
+	// The scheduled spawns are released by the random generation task
+	scenario_init(&ctx->scenario);
+	if (config->scenario_file &&
+			scenario_open(&ctx->scenario, config->scenario_file) != SUCCESS) {
+		recorder_close(&ctx->recorder);
+		return ERROR_GENERIC;
+	}
+
+	// Resuming a saved simulation at the current time
+	if (config->restore_file) {
+		ptask_clock_now(&ctx->clock, &now);
+		if (checkpoint_load(ctx, config->restore_file, &now) != SUCCESS) {
+			scenario_close(&ctx->scenario);
+			recorder_close(&ctx->recorder);
+			return ERROR_GENERIC;
+		}
+		if (config->verbose)
+			printf("Restored %s at %.3f s\n", config->restore_file,
+				(double) time_diff_us(&now, &ctx->start_time) / 1e6);
+	}
+
+	// Waiting for the next scheduled and restored random spawns
+	_arm_scenario_timer(ctx);
+	if (ctx->enable_random_gen)
+		_arm_traffic_timer(ctx);
+	return SUCCESS;
+}
+
+// Store in the bank a runway landing trajectory by interpolating between
+// the approach start and the rollout end. The points before the threshold
+// belong to the approach, the exit route follows the rollout.
+// Return NULL if the bank is full
+const trajectory_t* _init_landing_trajectory(traj_bank_t* bank,
+		const runway_t* runway, const trajectory_t* exit_route) {
+	int i = 0;
+	const int size = runway->landing_size;
+	float x_start, y_start;		// approach start
+	float x_end, y_end;			// rollout end
+	float dist = 0.0f;			// distance of a point from the approach start
+	waypoint_t point;
+	trajectory_t* traj = traj_bank_alloc(bank, size + exit_route->size,
+		false);
+
+	if (!traj) return NULL;
+	runway_landing_start(runway, &x_start, &y_start);
+	runway_landing_end(runway, &x_end, &y_end);
+
+	for (i = 0; i < size; ++i) {
+		point.x = linear_interpolate(x_start, x_end, size, i);
+		point.y = linear_interpolate(y_start, y_end, size, i);
+		point.vel = linear_interpolate(HOLDING_TRAJECTORY_VEL,
+			runway->rollout_vel, size, i);
+		dist = linear_interpolate(0.0f,
+			runway->approach_length + runway->rollout_length, size, i);
+		trajectory_append(traj, point, dist < runway->approach_length ?
+			SEGMENT_APPROACH : SEGMENT_RUNWAY);
+	}
+	for (i = 0; i < exit_route->size; ++i) {
+		trajectory_get_point(exit_route, i, &point);
+		trajectory_append(traj, point, SEGMENT_EXIT);
+	}
+	trajectory_seal(traj);
+	return traj;
+}
+
+// Complete the set loaded with the airport: the landing trajectories of
+// the runways and the holding patterns, stored in its bank. The runways
+// in use are the bits of "runways", all of them if 0.
+// Return ERROR_GENERIC if the bank is full or no runway is in use
+int init_runway_trajectories(const airport_t* airport, traj_bank_t* bank,
+		traj_set_t* set, unsigned runways) {
+	bool is_any_in_use = false;
+	int i = 0;
+
+	for (i = 0; i < airport->n_runways; ++i) {
+		set->landing[i] = _init_landing_trajectory(bank, &airport->runways[i],
+			set->exit[i]);
+		set->is_in_use[i] = (runways == 0 || (runways >> i) & 1u);
+		is_any_in_use = is_any_in_use || set->is_in_use[i];
+		if (!set->landing[i]) {
+			fprintf(stderr, ERR_MSG_TRAJ_ARENA);
+			return ERROR_GENERIC;
+		}
+	}
+	for (i = 0; i < airport->n_holdings; ++i) {
+		set->holding[i] = holding_build_pattern(bank, &airport->holdings[i]);
+		if (!set->holding[i]) {
+			fprintf(stderr, ERR_MSG_TRAJ_ARENA);
+			return ERROR_GENERIC;
+		}
+	}
+	if (!is_any_in_use) {
+		fprintf(stderr, ERR_MSG_TRAJ_RUNWAYS);
+		return ERROR_GENERIC;
+	}
+	return SUCCESS;
+}
+
+// Initialize the trajectories that keep the outbound airplanes at the gates.
+// Return ERROR_GENERIC if the arena is full
+int init_gate_trajectories(sim_context_t* ctx) {
+	const taxi_node_t* node = NULL;
+	trajectory_t* traj = NULL;
+	int i = 0;
+
+	for (i = 0; i < ctx->airport.n_gates; ++i) {
+		node = &ctx->airport.taxiway.nodes[ctx->airport.gates[i]];
+		traj = traj_arena_alloc(&ctx->trajectories, 1, true);
+		if (!traj) return ERROR_GENERIC;
+		trajectory_append(traj, (waypoint_t) {
+			.x = node->x,
+			.y = node->y,
+			.vel = TERMINAL_TRAJ_VEL
+		}, SEGMENT_APPROACH);
+		trajectory_seal(traj);
+		ctx->gate_trajectories[i] = traj;
+	}
+	return SUCCESS;
+}
+
+// Reserve the departure trajectories of each airplane of the pool. The
+// departures of any loaded airport fit MAX_WAYPOINTS, even after an update.
+// Return ERROR_GENERIC if the arena is full
+int init_departure_trajectories(sim_context_t* ctx) {
+	int i = 0;
+	int j = 0;
+
+	for (i = 0; i < AIRPLANE_POOL_SIZE; ++i) {
+		for (j = 0; j < DEPARTURE_BUFFERS; ++j) {
+			ctx->departure_trajectories[i][j] = traj_arena_alloc(
+				&ctx->trajectories, MAX_WAYPOINTS, false);
+			if (!ctx->departure_trajectories[i][j])
+				return ERROR_GENERIC;
+		}
+		ctx->departure_buffer[i] = 0;
+	}
+	return SUCCESS;
+}
+
+// Initialized the task states
+void init_task_states(sim_context_t* ctx) {
+	int i = 0;
+
+	// Setting the names of the tasks
+	for (i = 0; i < MAX_AIRPLANE; ++i) {
+		sprintf(ctx->task_states[i].str, "Air %02d:", i + 1);
+	}
+	strcpy(ctx->task_states[i].str, "Graphic:");
+	strcpy(ctx->task_states[i + 1].str, "Input:");
+	strcpy(ctx->task_states[i + 2].str, "Traffic Control:");
+	strcpy(ctx->task_states[i + 3].str, "Random Gen.:");
+	strcpy(ctx->task_states[i + 4].str, "Overload Mgr:");
+	strcpy(ctx->task_states[i + 5].str, "Aperiodic Srv:");
+	strcpy(ctx->task_states[i + 6].str, "Watchdog:");
+	strcpy(ctx->task_states[i + 7].str, "Separation:");
+	strcpy(ctx->task_states[i + 8].str, "Conflicts:");
+}
+
+// Initialized the system state
+void init_system_state(sim_context_t* ctx) {
+	ctx->system_state.state = (system_state_t) {
+		.n_runways = ctx->airport.n_runways,
+		.n_free_runways = ctx->airport.n_runways,
+		.n_airplanes =  0,
+		.random_gen_enabled = ctx->enable_random_gen,
+		.overload_level = 0,
+		.graphic_period_ms = GRAPHIC_PERIOD_MS,
+		.n_admitted = 0,
+		.n_deferred = 0,
+		.n_rejected = 0,
+		.utilization = 0.0f,
+		.n_stalls = 0,
+		.n_violations = 0,
+		.n_conflicts = 0,
+		.n_landed = 0,
+		.n_departed = 0,
+		.airplane_jobs = 0,
+		.airplane_deadline_miss = 0,
+		.airplane_max_exec_us = 0,
+		.n_delays = 0,
+		.total_delay_us = 0,
+		.max_delay_us = 0,
+		.n_separation_checks = 0,
+		.n_separation_losses = 0,
+		.min_separation = INFINITY
+	};
+	ptask_mutex_init(&ctx->system_state.mutex);
+}
+
+// Initialize a task of the simulation: the task receives the context and
+// runs on the clock of the simulation
+void _sim_task_init(sim_context_t* ctx, task_info_t* task, int task_num,
+		int period_ms, int priority) {
+	task_info_init(task, task_num, period_ms, period_ms, priority);
+	task->arg = ctx;
+	task->clock = &ctx->clock;
+}
+
+// Create the thread of a system task, counted for the admission test
+void _sim_task_create(sim_context_t* ctx, task_info_t* task,
+		void* (*body)(void*), const char* name) {
+	const int err = task_create(task, body);
+
+	if (err)
+		fprintf(stderr, ERR_MSG_TASK_CREATE, name, err);
+	else
+		__atomic_add_fetch(&ctx->n_system_tasks, 1, __ATOMIC_RELAXED);
+}
+
+// Create and run the tasks. The graphic and the input tasks only run
+// with a display
+void sim_create_tasks(sim_context_t* ctx) {
+	int i = 0;
+
+	ctx->n_system_tasks = 0;
+
+	// Creating graphic task. Without a display the task is initialized
+	// but never started, so that the events sent to it are ignored
+	_sim_task_init(ctx, &ctx->graphic_task_info, MAX_AIRPLANE,
+		GRAPHIC_PERIOD_MS, GRAPHIC_PRIORITY);
+	ctx->graphic_task_info.criticality = TASK_CRIT_LOW;
+	if (ctx->config.display) {
+		overload_manager_register(&ctx->overload_manager, &ctx->graphic_task_info);
+		_sim_task_create(ctx, &ctx->graphic_task_info, graphic_task,
+			"graphic task");
+	}
+
+	// Creating input task, replaced by the command line when headless
+	_sim_task_init(ctx, &ctx->input_task_info, MAX_AIRPLANE + 1,
+		INPUT_PERIOD_MS, INPUT_PRIORITY);
+	ctx->input_task_info.criticality = TASK_CRIT_LOW;
+	if (ctx->config.display) {
+		overload_manager_register(&ctx->overload_manager, &ctx->input_task_info);
+		_sim_task_create(ctx, &ctx->input_task_info, input_task, "input task");
+	}
+
+	// Creating traffic controller task
+	_sim_task_init(ctx, &ctx->traffic_ctrl_task_info, MAX_AIRPLANE + 2,
+		TRAFFIC_CTRL_PERIOD_MS, TRAFFIC_CTRL_PRIORITY);
+	overload_manager_register(&ctx->overload_manager, &ctx->traffic_ctrl_task_info);
+	_sim_task_create(ctx, &ctx->traffic_ctrl_task_info, traffic_controller_task,
+		"traffic controller task");
+
+	// Creating random generation task, which runs more often to release
+	// the scheduled spawns on time
+	_sim_task_init(ctx, &ctx->random_gen_task_info, MAX_AIRPLANE + 3,
+		RANDOM_GEN_PERIOD_MS, RANDOM_GEN_PRIORITY);
+	ctx->random_gen_task_info.criticality = TASK_CRIT_LOW;
+	overload_manager_register(&ctx->overload_manager, &ctx->random_gen_task_info);
+	_sim_task_create(ctx, &ctx->random_gen_task_info, random_gen_task,
+		"random generation task");
+
+	// Creating overload manager task
+	_sim_task_init(ctx, &ctx->overload_task_info, MAX_AIRPLANE + 4,
+		OVERLOAD_PERIOD_MS, OVERLOAD_PRIORITY);
+	_sim_task_create(ctx, &ctx->overload_task_info, overload_task,
+		"overload manager task");
+
+	// Creating aperiodic server task
+	_sim_task_init(ctx, &ctx->server_task_info, MAX_AIRPLANE + 5,
+		SERVER_PERIOD_MS, SERVER_PRIORITY);
+	_sim_task_create(ctx, &ctx->server_task_info, server_task,
+		"aperiodic server task");
+
+	// Creating separation monitor task
+	_sim_task_init(ctx, &ctx->separation_task_info, MAX_AIRPLANE + 7,
+		SEPARATION_PERIOD_MS, SEPARATION_PRIORITY);
+	overload_manager_register(&ctx->overload_manager, &ctx->separation_task_info);
+	_sim_task_create(ctx, &ctx->separation_task_info, separation_task,
+		"separation monitor task");
+
+	// Creating conflict prediction task
+	_sim_task_init(ctx, &ctx->conflict_task_info, MAX_AIRPLANE + 8,
+		CONFLICT_PERIOD_MS, CONFLICT_PRIORITY);
+	ctx->conflict_task_info.criticality = TASK_CRIT_LOW;
+	overload_manager_register(&ctx->overload_manager, &ctx->conflict_task_info);
+	_sim_task_create(ctx, &ctx->conflict_task_info, conflict_task,
+		"conflict prediction task");
+
+	// Resuming the airplanes of a restored simulation
+	for (i = 0; i < AIRPLANE_POOL_SIZE; ++i) {
+		if (!ctx->airplane_pool.is_free[i])
+			start_airplane_task(ctx, i);
+	}
+
+	// Watching all the system tasks but the watchdog itself
+	for (i = 0; i < N_SYSTEM_TASKS; ++i) {
+		if (ctx->system_task_infos[i] != &ctx->watchdog_task_info)
+			watchdog_register(&ctx->watchdog, ctx->system_task_infos[i]);
+	}
+
+	// Creating watchdog task
+	_sim_task_init(ctx, &ctx->watchdog_task_info, MAX_AIRPLANE + 6,
+		WATCHDOG_PERIOD_MS, WATCHDOG_PRIORITY);
+	_sim_task_create(ctx, &ctx->watchdog_task_info, watchdog_task,
+		"watchdog task");
+}
+
+// Ask all the tasks to terminate, waking up the dormant ones
+void sim_stop(sim_context_t* ctx) {
+	ctx->end_all = true;
+	aperiodic_server_stop(&ctx->aperiodic_server);
+	task_resume(&ctx->graphic_task_info);
+	task_resume(&ctx->traffic_ctrl_task_info);
+	task_resume(&ctx->random_gen_task_info);
+	task_resume(&ctx->separation_task_info);
+	task_resume(&ctx->conflict_task_info);
+}
+
+// Join all the tasks
+void sim_join(sim_context_t* ctx) {
+	int err = 0;
+	int i = 0;
+
+	if (ctx->config.display) {
+		// Joining graphic task
+		err = task_join(&ctx->graphic_task_info, NULL);
+		if (err) fprintf(stderr, ERR_MSG_TASK_JOIN, "graphic task", err);
+
+		// Joining input task
+		err = task_join(&ctx->input_task_info, NULL);
+		if (err) fprintf(stderr, ERR_MSG_TASK_JOIN, "input task", err);
+	}
+
+	// Joining traffic controller task
+	err = task_join(&ctx->traffic_ctrl_task_info, NULL);
+	if (err) fprintf(stderr, ERR_MSG_TASK_JOIN, "traffic controller", err);
+
+	// Joining traffic controller task
+	err = task_join(&ctx->random_gen_task_info, NULL);
+	if (err) fprintf(stderr, ERR_MSG_TASK_JOIN, "random generation", err);
+
+	// Joining overload manager task
+	err = task_join(&ctx->overload_task_info, NULL);
+	if (err) fprintf(stderr, ERR_MSG_TASK_JOIN, "overload manager", err);
+
+	// Joining aperiodic server task
+	err = task_join(&ctx->server_task_info, NULL);
+	if (err) fprintf(stderr, ERR_MSG_TASK_JOIN, "aperiodic server", err);
+
+	// Joining watchdog task
+	err = task_join(&ctx->watchdog_task_info, NULL);
+	if (err) fprintf(stderr, ERR_MSG_TASK_JOIN, "watchdog", err);
+
+	// Joining separation monitor task
+	err = task_join(&ctx->separation_task_info, NULL);
+	if (err) fprintf(stderr, ERR_MSG_TASK_JOIN, "separation monitor", err);
+
+	// Joining conflict prediction task
+	err = task_join(&ctx->conflict_task_info, NULL);
+	if (err) fprintf(stderr, ERR_MSG_TASK_JOIN, "conflict prediction", err);
+
+	// Joining airplane tasks
+	for (i = 0; i < MAX_AIRPLANE; ++i) {
+		if (!ctx->airplane_joinable[i]) continue;
+		err = task_join(&ctx->airplane_task_infos[i], NULL);
+		if (err) fprintf(stderr, ERR_MSG_TASK_JOIN_AIR, i, err);
+		ctx->airplane_joinable[i] = false;
+	}
+	recorder_close(&ctx->recorder);
+	scenario_close(&ctx->scenario);
+}
+
+// Admit, defer or reject a request of spawning a new airplane. The
+// deferred requests are served first to keep the FIFO order
+void request_airplane(sim_context_t* ctx, const spawn_request_t* request) {
+	if (request->status != INBOUND_HOLDING && request->status != OUTBOUND_HOLDING) {
+		fprintf(stderr, ERR_MSG_SPAWN_STATUS, request->status);
+		return;
+	}
+	retry_deferred_airplanes(ctx);
+
+	pthread_mutex_lock(&ctx->admission_mutex);
+	if (spawn_wait_list_is_empty(&ctx->spawn_wait_list) &&
+			admission_test(ctx, request->status)) {
+		spawn_airplane(ctx, request);
+		update_admission_stats(ctx, 1, 0, 0);
+	} else if (spawn_wait_list_push(&ctx->spawn_wait_list, request) == SUCCESS) {
+		update_admission_stats(ctx, 0, 1, 0);
+		task_resume(&ctx->random_gen_task_info);		// retries the deferred spawns
+	} else {
+		update_admission_stats(ctx, 0, 0, 1);
+	}
+	pthread_mutex_unlock(&ctx->admission_mutex);
+}
+
+// Spawn the deferred airplanes as long as the admission test is passed
+void retry_deferred_airplanes(sim_context_t* ctx) {
+	spawn_request_t request;
+
+	pthread_mutex_lock(&ctx->admission_mutex);
+	while (spawn_wait_list_peek(&ctx->spawn_wait_list, &request) &&
+			admission_test(ctx, request.status)) {
+		spawn_wait_list_pop(&ctx->spawn_wait_list, &request);
+		spawn_airplane(ctx, &request);
+		update_admission_stats(ctx, 1, 0, 0);
+	}
+	pthread_mutex_unlock(&ctx->admission_mutex);
+}
+
+// Check if a new airplane task can be admitted without compromising the
+// schedulability of the task set. The utilization of the tasks is computed
+// from their measured execution times; every allocated airplane is accounted
+// with the worst execution time measured on the airplane tasks. An inbound
+// airplane also needs a free holding slot.
+// Must be called with admission_mutex locked
+bool admission_test(sim_context_t* ctx, enum airplane_status status) {
+	float utilization = 0.0f;
+	int n_airplanes = 0;		// numb. of allocated airplanes
+	int n_tasks = 0;			// numb. of started system tasks
+	long exec_us = 0;
+	int i = 0;
+	bool admitted = false;
+
+	pthread_mutex_lock(&ctx->airplane_pool.mutex);
+	n_airplanes = AIRPLANE_POOL_SIZE - ctx->airplane_pool.n_free;
+	pthread_mutex_unlock(&ctx->airplane_pool.mutex);
+	if (n_airplanes == AIRPLANE_POOL_SIZE) return false;
+	if (status == INBOUND_HOLDING && !holding_has_free_slot(&ctx->holding_manager))
+		return false;
+
+	// Updating the airplane wcet estimate
+	for (i = 0; i < MAX_AIRPLANE; ++i) {
+		exec_us = task_max_exec_us(&ctx->airplane_task_infos[i]);
+		if (exec_us > ctx->airplane_wcet_us)
+			ctx->airplane_wcet_us = exec_us;
+	}
+
+	// the tasks that are not started have no measured execution time
+	for (i = 0; i < N_SYSTEM_TASKS; ++i)
+		utilization += task_utilization(ctx->system_task_infos[i]);
+	// the allocated airplanes and the new one, at full rate since every
+	// airplane reaches a runway
+	utilization += (float) (n_airplanes + 1) * (float) ctx->airplane_wcet_us /
+		(float) (AIRPLANE_PERIOD_MS * 1000);
+	n_tasks = __atomic_load_n(&ctx->n_system_tasks, __ATOMIC_RELAXED);
+	admitted = task_set_schedulable(utilization, n_tasks + n_airplanes + 1,
+		ADMISSION_SCHED_TEST);
+
+	pthread_mutex_lock(&ctx->system_state.mutex);
+	ctx->system_state.state.utilization = utilization;
+	pthread_mutex_unlock(&ctx->system_state.mutex);
+	return admitted;
+}
+
+// Update the admission statistics in the system state
+void update_admission_stats(sim_context_t* ctx, int admitted, int deferred,
+		int rejected) {
+	pthread_mutex_lock(&ctx->system_state.mutex);
+	ctx->system_state.state.n_admitted += admitted;
+	ctx->system_state.state.n_deferred += deferred;
+	ctx->system_state.state.n_rejected += rejected;
+	pthread_mutex_unlock(&ctx->system_state.mutex);
+	task_resume(&ctx->graphic_task_info);
+}
+
+// Spawn a new airplane with the initial status of the request. A
+// scheduled airplane takes the hints of its event
+void spawn_airplane(sim_context_t* ctx, const spawn_request_t* request) {
+	const scenario_event_t* event = scenario_event(&ctx->scenario,
+		request->event);
+
+	if (request->status == INBOUND_HOLDING)
+		spawn_inbound_airplane(ctx, event);
+	else
+		spawn_outbound_airplane(ctx, event);
+}
+
+// Return the preferred runway of a scheduled airplane, -1 if none
+int _runway_hint(const sim_context_t* ctx, const scenario_event_t* event) {
+	if (!event || event->runway >= ctx->airport.n_runways) return -1;
+	return event->runway;
+}
+
+// Initialize and spawn a new inbound airplane, random unless its event
+// sets the initial state
+void spawn_inbound_airplane(sim_context_t* ctx, const scenario_event_t* event) {
+	float x = 0.0;
+	float y = 0.0;
+	float angle = 0.0;
+
+	// Getting a new airplane from the pool
+	shared_airplane_t* new_airplane = airplane_pool_get_new(&ctx->airplane_pool);
+	if (new_airplane == NULL) return;
+
+	// Getting a new airplane from the pool
+	if (event && (event->flags & SCENARIO_FLAG_STATE)) {
+		x = event->x;
+		y = event->y;
+		angle = event->angle;
+	} else {
+		get_random_inbound_state(ctx, &x, &y, &angle);
+	}
+	new_airplane->airplane = (airplane_t) {
+		.x = x,
+		.y = y,
+		.angle = angle,
+		.vel = HOLDING_TRAJECTORY_VEL,
+		.des_traj = NULL,
+		.traj_index = 0,
+		.traj_finished = false,
+		.status = INBOUND_HOLDING,
+		.unique_id = new_airplane->airplane.unique_id,
+		.kill = false,
+		.runway_id = -1,
+		.cmd_count = 0,
+		.gate_id = -1,
+		.hold_short = false,
+		.runway_hint = _runway_hint(ctx, event),
+		.slot_vel = 0.0f
+	};
+	ptask_mutex_init(&(new_airplane->mutex));
+
+	// Allocating a holding slot
+	if (holding_enter(&ctx->holding_manager, new_airplane) != SUCCESS) {
+		airplane_pool_free(&ctx->airplane_pool, new_airplane);
+		return;
+	}
+
+	run_new_airplane(ctx, new_airplane);
+}
+
+// Initialize and spawn a new outbound airplane at the gate of its event,
+// at the next gate otherwise
+void spawn_outbound_airplane(sim_context_t* ctx, const scenario_event_t* event) {
+	float x = 0;
+	float y = 0;
+	float angle = 0;
+	int gate = ctx->next_gate;
+
+	// Getting a new airplane from the pool
+	shared_airplane_t* new_airplane = airplane_pool_get_new(&ctx->airplane_pool);
+	if (new_airplane == NULL) return;
+
+	// Getting a new airplane from the pool
+	if (event && (event->flags & SCENARIO_FLAG_STATE)) {
+		x = event->x;
+		y = event->y;
+		angle = event->angle;
+	} else {
+		get_random_outbound_state(ctx, &x, &y, &angle);
+	}
+	if (event && event->gate >= 0 && event->gate < ctx->airport.n_gates)
+		gate = event->gate;
+	else
+		ctx->next_gate = (ctx->next_gate + 1) % ctx->airport.n_gates;
+	new_airplane->airplane = (airplane_t) {
+		.x = x,
+		.y = y,
+		.angle = angle,
+		.vel = 0,
+		.des_traj = ctx->gate_trajectories[gate],
+		.traj_index = 0,
+		.traj_finished = false,
+		.status = OUTBOUND_HOLDING,
+		.unique_id = new_airplane->airplane.unique_id,
+		.kill = false,
+		.runway_id = -1,
+		.cmd_count = 0,
+		.gate_id = gate,
+		.hold_short = false,
+		.runway_hint = _runway_hint(ctx, event),
+		.slot_vel = 0.0f
+	};
+	ptask_mutex_init(&(new_airplane->mutex));
+
+	run_new_airplane(ctx, new_airplane);
+}
+
+// Create and run a new task that will handle the airplane
+void run_new_airplane(sim_context_t* ctx, shared_airplane_t* airplane) {
+	int airplane_id = airplane->airplane.unique_id;;
+
+	// Updating the system state
+	pthread_mutex_lock(&ctx->system_state.mutex);
+	++ctx->system_state.state.n_airplanes;
+	pthread_mutex_unlock(&ctx->system_state.mutex);
+
+	// Pushing to the serving queue, the delay is measured from now
+	ptask_clock_now(&ctx->clock, &ctx->spawn_times[airplane_id]);
+	airplane_queue_push(&ctx->airplane_queue, airplane);
+	task_resume(&ctx->traffic_ctrl_task_info);
+	task_resume(&ctx->graphic_task_info);
+	task_resume(&ctx->separation_task_info);
+	task_resume(&ctx->conflict_task_info);
+
+	ctx->taxi_reserved[airplane_id] = 0;
+	ctx->taxi_released[airplane_id] = 0;
+	start_airplane_task(ctx, airplane_id);
+}
+
+// Create and run the task of an airplane of the pool
+void start_airplane_task(sim_context_t* ctx, int airplane_id) {
+	int err = 0;
+
+	// Joining the previous task of the slot, which has already released
+	// the airplane and is terminating
+	if (ctx->airplane_joinable[airplane_id]) {
+		err = task_join(&ctx->airplane_task_infos[airplane_id], NULL);
+		if (err) fprintf(stderr, ERR_MSG_TASK_JOIN_AIR, airplane_id, err);
+	}
+
+	// Creating and running a new task
+	_sim_task_init(ctx, &ctx->airplane_task_infos[airplane_id], airplane_id,
+		AIRPLANE_PERIOD_MS, AIRPLANE_PRIORITY);
+
+	err = task_create(&ctx->airplane_task_infos[airplane_id], airplane_task);
+	ctx->airplane_joinable[airplane_id] = (err == 0);
+	if (err) fprintf(stderr, "Errore while creating the task. Errno %d\n", err);
+}
+
+// Return a random float in [min, max) interval
+float get_random_float(sim_context_t* ctx, float min, float max) {
+	assert(min <= max);
+	float diff = max - min;
+	float r = rng_uniformf(&ctx->rng);
+	return r * diff + min;
+}
+
+// Return a random state for an inbound airplane
+void get_random_inbound_state(sim_context_t* ctx, float* x, float* y,
+		float* angle) {
+	*x = get_random_float(ctx, INBOUND_AREA_X, INBOUND_AREA_X + INBOUND_AREA_WIDTH);
+	*y = get_random_float(ctx, INBOUND_AREA_Y, INBOUND_AREA_Y + INBOUND_AREA_HEIGHT);
+	*angle = get_random_float(ctx, 0, 2.0f * M_PI_F);
+}
+
+// Return a random state for an outbound airplane
+void get_random_outbound_state(sim_context_t* ctx, float* x, float* y,
+		float* angle) {
+	*x = get_random_float(ctx, OUTBOUND_AREA_X, OUTBOUND_AREA_X + OUTBOUND_AREA_WIDTH);
+	*y = get_random_float(ctx, OUTBOUND_AREA_Y, OUTBOUND_AREA_Y + OUTBOUND_AREA_HEIGHT);
+	*angle = get_random_float(ctx, 0, 2.0f * M_PI_F);
+}
+
+// Update the main box by drawing the airplanes and the trails
+// Return the number of airplanes drawn
+int update_main_box(sim_context_t* ctx, BITMAP* main_box, airplane_t* airplanes,
+		cbuffer_t* trails, bool draw_trails) {
+	int n_airplane = copy_shared_airplanes(ctx, airplanes, MAX_AIRPLANE);
+	int i = 0;
+	const airplane_t* airplane;
+	waypoint_t des_point;
+	
+	// Drawing the airplane trails
+	handle_trails(main_box, airplanes, n_airplane, trails, draw_trails);
+	
+	// Drawing the airplanes
+	for (i = 0; i < n_airplane; ++i) {
+		airplane = &airplanes[i];
+		draw_airplane(main_box, airplane);
+		if (ctx->show_next_waypoint) {
+			if (trajectory_get_point(airplane->des_traj, airplane->traj_index,
+					&des_point))
+				draw_waypoint(main_box, &des_point);
+		}
+	}
+	return n_airplane;
+}
+
+// Copy the allocated airplanes to and array.
+// Return the number of the copied elements
+int copy_shared_airplanes(sim_context_t* ctx, airplane_t* dst, int max_size) {
+	int i = 0;
+	int n = 0;		// number of allocated airplanes
+	// pointers to the allocated airplanes
+	shared_airplane_t* airplanes[AIRPLANE_POOL_SIZE];
+
+	// getting the pointers of the allocated airplanes
+	pthread_mutex_lock(&ctx->airplane_pool.mutex);
+	for (i = 0; i < AIRPLANE_POOL_SIZE; ++i) {
+		if (!ctx->airplane_pool.is_free[i]) {
+			airplanes[n] = &ctx->airplane_pool.elems[i];
+			++n;
+		}
+	}
+	pthread_mutex_unlock(&ctx->airplane_pool.mutex);
+
+	// safe copying the airplanes to the destination array
+	for (i = 0; i < n && i < max_size; ++i) {
+		pthread_mutex_lock(&airplanes[i]->mutex);
+		dst[i] = airplanes[i]->airplane;
+		pthread_mutex_unlock(&airplanes[i]->mutex);
+	}
+	return n;
+}
+
+// Return the period of the airplane task in the current phase. The
+// airplanes on the runways and on the taxiways are updated at full rate
+int airplane_period_ms(const airplane_t* airplane) {
+	switch (airplane->status) {
+		case INBOUND_HOLDING:
+			return AIRPLANE_HOLDING_PERIOD_MS;
+		case OUTBOUND_HOLDING:
+			return AIRPLANE_GATE_PERIOD_MS;
+		case INBOUND_LANDING:
+		case OUTBOUND_TAKEOFF:
+		default:
+			return AIRPLANE_PERIOD_MS;
+	}
+}
+
+// Execute the airplane trajectory controller over a time step of dt seconds
+void airplane_controller_evolve(airplane_t* airplane, float dt) {
+	float accel_cmd = 0;				// acceleration command
+	float omega_cmd = 0;				// angular rotation command
+	const waypoint_t* des_point = NULL;	// pointer to the desired point
+	waypoint_t point;
+
+	if (trajectory_get_point(airplane->des_traj, airplane->traj_index, &point)) {
+		if (airplane->hold_short)	// stopping until the taxiway is reserved
+			point.vel = 0.0f;
+		else if (airplane->slot_vel > 0.0f)	// keeping the holding slot
+			point.vel = airplane->slot_vel;
+		des_point = &point;
+	}
+	compute_airplane_controls(airplane, des_point, &accel_cmd, &omega_cmd);
+	update_airplane_state(airplane, accel_cmd, omega_cmd, dt);
+	update_airplane_des_trajectory(airplane, des_point);
+}
+
+// Compute the airplane controls, i.e. the acceleration command and the
+// angular velocity command
+void compute_airplane_controls(const airplane_t* airplane, 
+		const waypoint_t* des_point, float* accel_cmd, float* omega_cmd) {
+	float des_angle = 0.0;			// desired angle
+	float angle_error = 0.0;
+	float vel_error = 0.0;
+	
+	if (des_point) {
+		// acceleration command
+		vel_error = des_point->vel - airplane->vel;
+		*accel_cmd = AIRPLANE_CTRL_VEL_GAIN * vel_error;
+
+		// angular velocity command
+		des_angle = atan2f(des_point->y - airplane->y,
+							des_point->x - airplane->x);
+		angle_error = wrap_angle_pi(des_angle - airplane->angle);
+		*omega_cmd = AIRPLANE_CTRL_OMEGA_GAIN * angle_error;
+	} else {
+		// backup commands in the cases whene des_point is NULL
+		*omega_cmd = 0;
+		*accel_cmd = 0;
+	}
+}
+
+// Update the airplane state given the commands from the controller,
+// integrating over a time step of dt seconds
+void update_airplane_state(airplane_t* airplane, float accel_cmd, 
+		float omega_cmd, float dt) {
+	float vel = airplane->vel;
+
+	// "steering" is possible only when the airplane is moving
+	if (vel < AIRPLANE_CTRL_VEL_TH) omega_cmd = 0;
+
+	// updating the state using the unicycle model
+	airplane->x += vel * cosf(airplane->angle) * dt;
+	airplane->y += vel * sinf(airplane->angle) * dt;
+	airplane->angle += wrap_angle_pi(omega_cmd * dt);
+	airplane->vel += accel_cmd * dt;
+}
+
+// Update the desired point if the airplane has reached
+// the current desired point
+void update_airplane_des_trajectory(airplane_t* airplane,
+		const waypoint_t* des_point) {
+	float distance = 0.0;		// distance from the desired point
+	float min_dist = 0.0;		// threashold distance
+
+	// setting the min_dist based on the airplane state
+	if (airplane->status == OUTBOUND_TAKEOFF)
+		min_dist = AIRPLANE_CTRL_TAXI_MIN_DIST;
+	else
+		min_dist = AIRPLANE_CTRL_MIN_DIST;
+
+	if (des_point) {
+		// computing the distance and check the switching condition
+		distance = points_distance(airplane->x, airplane->y,
+			des_point->x, des_point->y);
+		
+		// an airplane holding short does not enter the next taxiway
+		if (distance < min_dist && !airplane->hold_short)
+			++airplane->traj_index;
+	} else {
+		// if des_point is NULL, the airplane has reached the end of
+		// the desired trajectory
+		airplane->traj_finished = true;
+	}
+}
+
+// Return true if the airplane has left the runway segment of its
+// runway trajectory
+bool airplane_runway_cleared(const airplane_t* airplane) {
+	if (airplane->runway_id < 0) return false;
+	return airplane->traj_finished || trajectory_get_segment(
+		airplane->des_traj, airplane->traj_index) == SEGMENT_EXIT;
+}
+
+// Free the runway released by its airplane. The airplane has cleared the
+// runway segment and completes its exit route on its own
+void traffic_controller_free_runway(sim_context_t* ctx, int runway_id) {
+	ctx->runways[runway_id] = NULL;
+	if (ctx->sequencer.trajectories->is_in_use[runway_id])
+		ctx->free_runways[ctx->n_free_runways++] = runway_id;
+}
+
+// Rebuild the stack of the free runways with the runways in use of "set".
+// The runways taken out of use are left to their airplanes
+void traffic_controller_set_runways(sim_context_t* ctx, const traj_set_t* set) {
+	int i = 0;
+
+	ctx->n_free_runways = 0;
+	for (i = ctx->airport.n_runways; i > 0; --i)
+		if (set->is_in_use[i - 1] && ctx->runways[i - 1] == NULL)
+			ctx->free_runways[ctx->n_free_runways++] = i - 1;
+}
+
+// Pop a free runway for the airplane: its preferred runway if it is free,
+// the top of the stack otherwise. There must be a free runway
+int traffic_controller_pick_runway(sim_context_t* ctx,
+		const shared_airplane_t* airplane) {
+	// The hint is set at the spawn and never changes
+	const int hint = airplane->airplane.runway_hint;
+	const int top = ctx->n_free_runways - 1;
+	int i = 0;
+
+	for (i = 0; hint >= 0 && i < top; ++i) {
+		if (ctx->free_runways[i] == hint) {
+			ctx->free_runways[i] = ctx->free_runways[top];
+			ctx->free_runways[top] = hint;
+			break;
+		}
+	}
+	return ctx->free_runways[--ctx->n_free_runways];
+}
+
+// Assign the free runway to the airplane retrieved from the queue.
+// Return ERROR_GENERIC, leaving the airplane holding, if its departure
+// can't be built
+int traffic_controller_assign_runway(sim_context_t* ctx, int runway_id,
+		shared_airplane_t* airplane) {
+	const trajectory_t* departure = NULL;
+	struct timespec now;
+	long delay_us = 0;
+
+	// Only the controller changes the status, read without the lock
+	if (airplane->airplane.status == OUTBOUND_HOLDING) {
+		departure = build_departure_trajectory(ctx,
+			ctx->sequencer.trajectories, airplane->airplane.unique_id,
+			airplane->airplane.gate_id, runway_id);
+		if (!departure) {
+			fprintf(stderr, ERR_MSG_TRAJ_DEPARTURE, airplane->airplane.gate_id,
+				runway_id, airplane->airplane.unique_id);
+			return ERROR_GENERIC;
+		}
+	}
+
+	ctx->runways[runway_id] = airplane;
+	holding_leave(&ctx->holding_manager, airplane);
+	pthread_mutex_lock(&airplane->mutex);
+	airplane->airplane.runway_id = runway_id;
+	++airplane->airplane.cmd_count;
+	if (airplane->airplane.status == INBOUND_HOLDING) {
+		airplane->airplane.status = INBOUND_LANDING;
+		airplane->airplane.des_traj = ctx->sequencer.trajectories->landing[
+			runway_id];
+		airplane->airplane.traj_index = 0;
+		airplane->airplane.traj_finished = false;
+		if (ctx->config.verbose)
+			printf("RUNWAY %d to %d\n", runway_id, airplane->airplane.unique_id);
+	} else if (airplane->airplane.status == OUTBOUND_HOLDING) {
+		airplane->airplane.status = OUTBOUND_TAKEOFF;
+		airplane->airplane.des_traj = departure;
+		airplane->airplane.traj_index = 0;
+		airplane->airplane.traj_finished = false;
+		if (ctx->config.verbose)
+			printf("RUNWAY %d to %d\n", runway_id, airplane->airplane.unique_id);
+	} else { 
+		fprintf(stderr, "Errore status aereo: %d\n", airplane->airplane.status);
+	}
+	pthread_mutex_unlock(&airplane->mutex);
+
+	// Delay statistics: time from the spawn to the runway assignment
+	ptask_clock_now(&ctx->clock, &now);
+	delay_us = time_diff_us(&now,
+		&ctx->spawn_times[airplane->airplane.unique_id]);
+	pthread_mutex_lock(&ctx->system_state.mutex);
+	++ctx->system_state.state.n_delays;
+	ctx->system_state.state.total_delay_us += delay_us;
+	if (delay_us > ctx->system_state.state.max_delay_us)
+		ctx->system_state.state.max_delay_us = delay_us;
+	pthread_mutex_unlock(&ctx->system_state.mutex);
+	return SUCCESS;
+}
+
+// Build the departure trajectory of an outbound airplane: the shortest taxi
+// route from its gate to the runway entry followed by the runway departure
+// of "set". The trajectory is a copy, it never refers to the set.
+// Return NULL if the route or the trajectory exceed MAX_WAYPOINTS
+const trajectory_t* build_departure_trajectory(sim_context_t* ctx,
+		const traj_set_t* set, int airplane_id, int gate_id, int runway_id) {
+	const runway_t* runway = &ctx->airport.runways[runway_id];
+	const trajectory_t* departure = set->departure[runway_id];
+	taxi_route_t* route = &ctx->taxi_routes[airplane_id];
+	trajectory_t* traj = NULL;
+	const taxi_node_t* node = NULL;
+	waypoint_t point;
+	int buffer = 0;
+	int i = 0;
+
+	if (taxiway_route(&ctx->airport.taxiway, ctx->airport.gates[gate_id],
+			runway->entry_node, route) < 0)
+		return NULL;
+
+	// The buffers of the slot are used in turn: the copies of the previous
+	// airplane taken by the other tasks may still refer to the one built last,
+	// which is kept until the new one is complete
+	buffer = (ctx->departure_buffer[airplane_id] + 1) % DEPARTURE_BUFFERS;
+	traj = ctx->departure_trajectories[airplane_id][buffer];
+	trajectory_clear(traj);
+	for (i = 0; i < route->n_nodes; ++i) {
+		node = &ctx->airport.taxiway.nodes[route->nodes[i]];
+		if (trajectory_append(traj, (waypoint_t) {
+				.x = node->x,
+				.y = node->y,
+				.vel = TAXI_TRAJ_VEL
+			}, SEGMENT_APPROACH) != SUCCESS)
+			return NULL;
+	}
+	for (i = 0; i < departure->size; ++i) {
+		trajectory_get_point(departure, i, &point);
+		if (trajectory_append(traj, point,
+				trajectory_get_segment(departure, i)) != SUCCESS)
+			return NULL;
+	}
+	ctx->departure_buffer[airplane_id] = buffer;
+	return traj;
+}
+
+// Reserve the next taxiway edge when the airplane gets close to the end of
+// the current one and release the edges already travelled. The airplane
+// holds short of the next edge until it is reserved
+void update_taxi_reservations(sim_context_t* ctx, airplane_t* airplane,
+		int* reserved, int* released) {
+	const taxi_route_t* route = &ctx->taxi_routes[airplane->unique_id];
+	const int k = airplane->traj_index;
+	const taxi_node_t* node = NULL;
+
+	if (k < route->n_nodes - 1 && *reserved <= k) {
+		node = &ctx->airport.taxiway.nodes[route->nodes[k]];
+		if (points_distance(airplane->x, airplane->y, node->x, node->y) <
+				TAXI_HOLD_DIST) {
+			airplane->hold_short = !taxiway_reserve(&ctx->airport.taxiway,
+				route->nodes[k], route->nodes[k + 1], airplane->unique_id);
+			if (!airplane->hold_short)
+				*reserved = k + 1;
+		}
+	}
+
+	while (*released < k - 1 && *released < *reserved) {
+		++(*released);
+		taxiway_release(&ctx->airport.taxiway, route->nodes[*released - 1],
+			route->nodes[*released], airplane->unique_id);
+	}
+}
+
+// Return the distance between (x1, y1) and (x2, y2)
+float points_distance(float x1, float y1, float x2, float y2) {
+	float dx = x1 - x2;
+	float dy = y1 - y2;
+	return sqrtf(dx*dx + dy*dy);
+}
+
+// Return the provided angle wrapped in [-pi, pi]
+float wrap_angle_pi(float angle) {
+	float k = ceilf(-angle / (2.0f * M_PI_F) - 0.5f);
+	return angle + 2.0f * M_PI_F * k;
+}
+
+// Append the current position of the airplane to the trail buffer
+void update_airplane_trail(const airplane_t* airplane, cbuffer_t* trail) {
+	int i = 0;
+	point2i_t new_point;
+	
+	// converting the cartesian coordinates to display coordinates
+	convert_coord_to_display(airplane->x, airplane->y,
+		&new_point.x, &new_point.y);
+	
+	// appending the new point
+	i = cbuffer_next_index(trail);
+	trail->points[i] = new_point;
+}
+
+// handle the update, the draw and the reset of the trail array
+void handle_trails(BITMAP* bitmap, airplane_t* airplanes, int n_airplanes,
+		cbuffer_t* trails, bool show_trails_) {
+	int i = 0;
+	airplane_t* airplane = NULL;
+	cbuffer_t* trail = NULL;
+	// true if the corresponding trail has been updated
+	// used to determined which trails should be resetted
+	bool trails_updated[MAX_AIRPLANE] = { 0 };
+
+	// updating and drawing of the trails
+	for (i = 0; i < n_airplanes; ++i) {
+		airplane = &airplanes[i];
+		trail = &trails[airplane->unique_id];
+		trails_updated[airplane->unique_id] = true;
+		update_airplane_trail(airplane, trail);
+		if (show_trails_)
+			draw_trail(bitmap, trail, TRAIL_COLOR);
+	}
+
+	// resetting the unused trail buffers
+	for (i = 0; i < MAX_AIRPLANE; ++i) {
+		if (trails_updated[i] == false)
+			cbuffer_init(&trails[i]);
+	}
+}
+
+// Return the new period of the graphic task. The period is increased when
+// the flight tasks are short of headroom and decreased when they have
+// plenty of it. It never goes below the period that keeps the graphic
+// utilization under GRAPHIC_MAX_UTILIZATION
+int adapt_graphic_period(int period_ms, long frame_cost_us, float headroom,
+		int level) {
+	// period needed to keep the utilization bounded
+	int cost_period_ms = (int) ((float) frame_cost_us / 
+		(1000.0f * GRAPHIC_MAX_UTILIZATION));
+
+	if (level >= OVERLOAD_LEVEL_LOW_FPS)
+		return GRAPHIC_MAX_PERIOD_MS;
+
+	if (headroom < GRAPHIC_HEADROOM_LOW)
+		period_ms += GRAPHIC_PERIOD_STEP_MS;
+	else if (headroom > GRAPHIC_HEADROOM_HIGH)
+		period_ms -= GRAPHIC_PERIOD_STEP_MS;
+
+	if (period_ms < cost_period_ms) period_ms = cost_period_ms;
+	if (period_ms < GRAPHIC_MIN_PERIOD_MS) period_ms = GRAPHIC_MIN_PERIOD_MS;
+	if (period_ms > GRAPHIC_MAX_PERIOD_MS) period_ms = GRAPHIC_MAX_PERIOD_MS;
+	return period_ms;
+}
+
+void toggle_trails(sim_context_t* ctx) {
+	ctx->show_trails = !ctx->show_trails;
+	task_resume(&ctx->graphic_task_info);
+}
+
+void toggle_next_waypoint(sim_context_t* ctx) {
+	ctx->show_next_waypoint = !ctx->show_next_waypoint;
+	task_resume(&ctx->graphic_task_info);
+}
+
+void sim_toggle_random_gen(sim_context_t* ctx) {
+	ctx->enable_random_gen = !ctx->enable_random_gen;
+	
+	// Updating the system state
+	pthread_mutex_lock(&ctx->system_state.mutex);
+	ctx->system_state.state.random_gen_enabled = ctx->enable_random_gen;
+	pthread_mutex_unlock(&ctx->system_state.mutex);
+	task_resume(&ctx->random_gen_task_info);
+	task_resume(&ctx->graphic_task_info);
+}
+
+// Save the state of the simulation to "path". The jobs that change the
+// state are held until the image is taken; must not be called by a job.
+// Return ERROR_GENERIC if the checkpoint can't be saved
+int sim_checkpoint(sim_context_t* ctx, const char* path) {
+	struct timespec now;
+	int ret = SUCCESS;
+
+	pthread_rwlock_wrlock(&ctx->job_gate);
+	ptask_clock_now(&ctx->clock, &now);
+	ret = checkpoint_save(ctx, path, &now);
+	pthread_rwlock_unlock(&ctx->job_gate);
+
+	if (ret != SUCCESS)
+		fprintf(stderr, ERR_MSG_CHECKPOINT, path);
+	else if (ctx->config.verbose)
+		printf("Checkpoint %s at %.3f s\n", path,
+			(double) time_diff_us(&now, &ctx->start_time) / 1e6);
+	return ret;
+}
+
+// Return the published trajectories. The set never changes and can be
+// read until the end of the current job without locks
+const traj_set_t* sim_trajectories(sim_context_t* ctx) {
+	return __atomic_load_n(&ctx->traj_set, __ATOMIC_ACQUIRE);
+}
+
+// Return true if the staged airport has the runways, the stacks, the gates
+// and the taxiways of the running one, only their routes may differ
+bool _is_same_layout(const airport_t* running, const airport_t* staged) {
+	const taxiway_t* taxiway = &running->taxiway;
+	int i = 0;
+
+	if (staged->n_runways != running->n_runways ||
+			staged->n_holdings != running->n_holdings ||
+			staged->n_gates != running->n_gates ||
+			staged->taxiway.n_nodes != running->taxiway.n_nodes ||
+			staged->taxiway.n_edges != running->taxiway.n_edges)
+		return false;
+	for (i = 0; i < running->n_runways; ++i)
+		if (staged->runways[i].entry_node != running->runways[i].entry_node)
+			return false;
+	for (i = 0; i < running->n_gates; ++i)
+		if (staged->gates[i] != running->gates[i])
+			return false;
+	// the reservations and the routes of the taxiing airplanes refer to
+	// the nodes and the edges by id; the same file gives the same floats
+	if (memcmp(staged->taxiway.nodes, taxiway->nodes,
+			(size_t) taxiway->n_nodes * sizeof(taxi_node_t)) != 0)
+		return false;
+	for (i = 0; i < taxiway->n_nodes; ++i)
+		if (memcmp(staged->taxiway.edge_id[i], taxiway->edge_id[i],
+				(size_t) taxiway->n_nodes * sizeof(int)) != 0)
+			return false;
+	return true;
+}
+
+// Replace the routes of the runways and of the stacks with the ones of
+// "airport_file", the current file if NULL, keeping in use the runways
+// whose bits are set in "runways", all of them if 0. The new set is
+// published at once: the airplanes already cleared keep their routes, the
+// following clearances use the new ones. Called within the job gate.
+// Return ERROR_GENERIC if the routes can't be loaded or if the set
+// replaced by the previous update is still in use
+int sim_update_trajectories(sim_context_t* ctx, const char* airport_file,
+		unsigned runways) {
+	const traj_set_t* old_set = NULL;
+	airport_t* staged = malloc(sizeof(airport_t));
+	traj_bank_t* bank = NULL;
+	traj_set_t* set = NULL;
+	int old = 0;						// index of the published set
+	int next = 0;						// index of the new set
+	int ret = SUCCESS;
+
+	if (!staged) return ERROR_GENERIC;
+	if (!airport_file) airport_file = ctx->config.airport_file;
+
+	pthread_mutex_lock(&ctx->traj_mutex);
+	reclaim_trajectories(ctx);
+	if (ctx->traj_retired >= 0) {
+		pthread_mutex_unlock(&ctx->traj_mutex);
+		free(staged);
+		fprintf(stderr, ERR_MSG_TRAJ_RETIRED);
+		return ERROR_GENERIC;
+	}
+
+	// Building the new set in the free bank, nobody reads it
+	old_set = ctx->traj_set;
+	old = (int) (old_set - ctx->traj_sets);
+	next = (old + 1) % TRAJ_SET_VERSIONS;
+	bank = &ctx->traj_banks[next];
+	set = &ctx->traj_sets[next];
+	traj_bank_reset(bank);
+	ret = airport_load(staged, airport_file, bank, set);
+	if (ret == SUCCESS && ctx->config.n_runways > 0 &&
+			ctx->config.n_runways < staged->n_runways)
+		staged->n_runways = ctx->config.n_runways;
+	if (ret == SUCCESS && !_is_same_layout(&ctx->airport, staged)) {
+		fprintf(stderr, ERR_MSG_TRAJ_LAYOUT, airport_file);
+		ret = ERROR_GENERIC;
+	}
+	if (ret == SUCCESS)
+		ret = init_runway_trajectories(staged, bank, set, runways);
+	if (ret != SUCCESS) {
+		pthread_mutex_unlock(&ctx->traj_mutex);
+		free(staged);
+		return ERROR_GENERIC;
+	}
+	set->version = old_set->version + 1;
+
+	// Publishing the new set, the old one is retired until its readers
+	// have gone
+	__atomic_store_n(&ctx->traj_set, set, __ATOMIC_RELEASE);
+	holding_set_trajectories(&ctx->holding_manager, staged, set);
+	ctx->traj_retired = old;
+	ctx->traj_is_draining = false;
+	grace_period_start(&ctx->traj_grace);
+	pthread_mutex_unlock(&ctx->traj_mutex);
+	free(staged);
+
+	if (ctx->config.verbose)
+		printf("TRAJECTORIES %d from %s\n", set->version, airport_file);
+	task_resume(&ctx->traffic_ctrl_task_info);
+	return SUCCESS;
+}
+
+// Replace the routes as in sim_run, update_s seconds from now, unless the
+// simulation ends before. The tasks must be running
+void sim_update_when_due(sim_context_t* ctx) {
+	struct timespec due;
+	struct timespec next;
+
+	ptask_clock_now(&ctx->clock, &due);
+	due.tv_sec += ctx->config.update_s;
+	while (!ctx->end_all) {
+		ptask_clock_now(&ctx->clock, &next);
+		if (time_cmp(&next, &due) >= 0) {
+			job_gate_enter(ctx);
+			sim_update_trajectories(ctx, ctx->config.update_file,
+				ctx->config.update_runways);
+			job_gate_exit(ctx);
+			return;
+		}
+		time_add_ms(&next, UPDATE_POLL_MS);
+		if (time_cmp(&next, &due) > 0) time_copy(&next, &due);
+		ptask_clock_sleep_until(&ctx->clock, &next);
+	}
+}
+
+// Advance the reclamation of the retired set. Once the jobs that could
+// have read it have completed, the airplanes still flying its routes are
+// looked for; once there are none, the copies of the airplanes taken by
+// the other tasks are waited for before the bank is reused.
+// Called with the trajectory mutex held
+void reclaim_trajectories(sim_context_t* ctx) {
+	const traj_bank_t* bank = NULL;
+	shared_airplane_t* airplane = NULL;
+	bool is_used = false;
+	int i = 0;
+
+	if (ctx->traj_retired < 0 || !grace_period_elapsed(&ctx->traj_grace))
+		return;
+	bank = &ctx->traj_banks[ctx->traj_retired];
+	if (ctx->traj_is_draining) {
+		traj_bank_reset(&ctx->traj_banks[ctx->traj_retired]);
+		ctx->traj_retired = -1;
+		return;
+	}
+
+	pthread_mutex_lock(&ctx->airplane_pool.mutex);
+	for (i = 0; i < AIRPLANE_POOL_SIZE && !is_used; ++i) {
+		if (ctx->airplane_pool.is_free[i]) continue;
+		airplane = &ctx->airplane_pool.elems[i];
+		pthread_mutex_lock(&airplane->mutex);
+		is_used = traj_bank_contains(bank, airplane->airplane.des_traj);
+		pthread_mutex_unlock(&airplane->mutex);
+	}
+	pthread_mutex_unlock(&ctx->airplane_pool.mutex);
+	if (!is_used) {
+		ctx->traj_is_draining = true;
+		grace_period_start(&ctx->traj_grace);
+	}
+}
+
+void update_task_states(sim_context_t* ctx, const task_info_t* task_info) {
+	ctx->task_states[task_info->task_num].deadline_miss = task_info->deadline_miss;
+}
+
+// Copy the stall information of the watchdog to the task states
+void update_task_stall_states(sim_context_t* ctx) {
+	int i = 0;
+	const task_info_t* task_info = NULL;
+
+	for (i = 0; i < N_TASKS; ++i) {
+		if (i < MAX_AIRPLANE)
+			task_info = &ctx->airplane_task_infos[i];
+		else
+			task_info = ctx->system_task_infos[i - MAX_AIRPLANE];
+		ctx->task_states[i].is_stalled = task_info->is_stalled;
+		ctx->task_states[i].stall_count = task_info->stall_count;
+	}
+
+	pthread_mutex_lock(&ctx->system_state.mutex);
+	ctx->system_state.state.n_stalls = ctx->watchdog.n_stalls;
+	pthread_mutex_unlock(&ctx->system_state.mutex);
+}
+
+// Suspend a task until it is resumed by an event, showing it as dormant
+void suspend_task(sim_context_t* ctx, task_info_t* task_info) {
+	ctx->task_states[task_info->task_num].is_dormant = true;
+	task_suspend(task_info);
+	ctx->task_states[task_info->task_num].is_dormant = false;
+}
+
+// Enter a job that changes the state of the simulation. The job can't
+// wait for the clock or for another job before leaving the gate
+void job_gate_enter(sim_context_t* ctx) {
+	pthread_rwlock_rdlock(&ctx->job_gate);
+}
+
+void job_gate_exit(sim_context_t* ctx) {
+	pthread_rwlock_unlock(&ctx->job_gate);
+}
+
+// Return the i-th element of a linear interpolation made 
+// from "start" to "end" in "n" steps
+float linear_interpolate(float start, float end, int n, int i) {
+	assert(i < n);
+	const float step_size = (end - start) / (float) n;
+
+	return start + step_size * (float) i;
+}
\ No newline at end of file
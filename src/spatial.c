@@ -0,0 +1,184 @@
+/*
+ * spatial.c
+ *
+ * Uniform spatial hash grid. A rebuild costs O(n + cells): the entries
+ * are counted per cell, the counts are turned into offsets and the
+ * entries are scattered to their cell. Two airplanes closer than the
+ * cell size are always in the same cell or in adjacent cells, so the
+ * separation check only compares the entries of neighbouring cells
+ */
+
+#include <math.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "spatial.h"
+
+// Forward half of the neighbourhood of a cell (column, row offsets).
+// Each pair of adjacent cells is visited once
+static const int forward_cells[4][2] = { {1, 0}, {-1, 1}, {0, 1}, {1, 1} };
+
+// ==================================================================
+//                          CELL INDEXING
+// ==================================================================
+// Return the column containing the x coordinate, clamped to the grid
+int _spatial_col(const spatial_grid_t* grid, float x) {
+	int col = (int) floorf((x - grid->min_x) / grid->cell_size);
+
+	if (col < 0) return 0;
+	if (col >= grid->n_cols) return grid->n_cols - 1;
+	return col;
+}
+
+// Return the row containing the y coordinate, clamped to the grid
+int _spatial_row(const spatial_grid_t* grid, float y) {
+	int row = (int) floorf((y - grid->min_y) / grid->cell_size);
+
+	if (row < 0) return 0;
+	if (row >= grid->n_rows) return grid->n_rows - 1;
+	return row;
+}
+
+// Return true if the two entries are closer than min_dist. If so, the
+// pair is appended to the violations
+bool _spatial_check_pair(const spatial_entry_t* a, const spatial_entry_t* b,
+		float min_dist, separation_violation_t* violations, int max_violations,
+		int n_found) {
+	const float dx = a->x - b->x;
+	const float dy = a->y - b->y;
+
+	if (dx*dx + dy*dy >= min_dist * min_dist)
+		return false;
+	if (n_found < max_violations) {
+		violations[n_found] = (separation_violation_t) {
+			.id_a = a->id,
+			.id_b = b->id,
+			.distance = sqrtf(dx*dx + dy*dy)
+		};
+	}
+	return true;
+}
+
+// ==================================================================
+//                             GRID
+// ==================================================================
+// Initialize the grid covering the area with lower left corner in
+// (min_x, min_y). Return ERROR_GENERIC if the area needs too many cells
+int spatial_grid_init(spatial_grid_t* grid, float min_x, float min_y,
+		float width, float height, float cell_size) {
+	grid->min_x = min_x;
+	grid->min_y = min_y;
+	grid->cell_size = cell_size;
+	grid->n_cols = (int) ceilf(width / cell_size);
+	grid->n_rows = (int) ceilf(height / cell_size);
+	grid->n_entries = 0;
+
+	if (grid->n_cols < 1 || grid->n_rows < 1 ||
+			grid->n_cols > SPATIAL_MAX_CELLS / grid->n_rows) {
+		fprintf(stderr, "Spatial grid of %d x %d cells too large\n",
+			grid->n_cols, grid->n_rows);
+		return ERROR_GENERIC;
+	}
+	memset(grid->cell_start, 0, sizeof(grid->cell_start));
+	return SUCCESS;
+}
+
+// Rebuild the grid from the provided entries with a counting sort.
+// The entries exceeding SPATIAL_MAX_POINTS are ignored
+void spatial_grid_build(spatial_grid_t* grid, const spatial_entry_t* entries,
+		int n) {
+	const int n_cells = grid->n_cols * grid->n_rows;
+	int c = 0;
+	int i = 0;
+
+	if (n > SPATIAL_MAX_POINTS) n = SPATIAL_MAX_POINTS;
+	grid->n_entries = n;
+
+	// counting the entries of each cell
+	memset(grid->cell_start, 0, sizeof(int) * (size_t) (n_cells + 1));
+	for (i = 0; i < n; ++i) {
+		grid->cell_of[i] = _spatial_row(grid, entries[i].y) * grid->n_cols +
+			_spatial_col(grid, entries[i].x);
+		++grid->cell_start[grid->cell_of[i] + 1];
+	}
+
+	// turning the counts into offsets
+	for (c = 1; c <= n_cells; ++c) {
+		grid->cell_start[c] += grid->cell_start[c - 1];
+		grid->cell_fill[c - 1] = grid->cell_start[c - 1];
+	}
+
+	// scattering the entries to their cell
+	for (i = 0; i < n; ++i)
+		grid->entries[grid->cell_fill[grid->cell_of[i]]++] = entries[i];
+}
+
+// Store in "ids" the entries within "radius" from (x, y).
+// Return the number of stored ids
+int spatial_grid_query(const spatial_grid_t* grid, float x, float y,
+		float radius, int* ids, int max_ids) {
+	const int col_min = _spatial_col(grid, x - radius);
+	const int col_max = _spatial_col(grid, x + radius);
+	const int row_min = _spatial_row(grid, y - radius);
+	const int row_max = _spatial_row(grid, y + radius);
+	const spatial_entry_t* e = NULL;
+	int n = 0;
+	int row, col, c, i;
+
+	for (row = row_min; row <= row_max; ++row) {
+		for (col = col_min; col <= col_max; ++col) {
+			c = row * grid->n_cols + col;
+			for (i = grid->cell_start[c]; i < grid->cell_start[c + 1]; ++i) {
+				e = &grid->entries[i];
+				if ((e->x - x) * (e->x - x) + (e->y - y) * (e->y - y) >=
+						radius * radius)
+					continue;
+				if (n == max_ids) return n;
+				ids[n++] = e->id;
+			}
+		}
+	}
+	return n;
+}
+
+// Find the pairs of entries closer than min_dist, which must not exceed
+// the cell size. At most max_violations pairs are stored. Return the
+// total number of pairs found or ERROR_GENERIC
+int spatial_grid_violations(const spatial_grid_t* grid, float min_dist,
+		separation_violation_t* violations, int max_violations) {
+	int n = 0;
+	int row, col, c, i, j, k;
+	int ncol, nrow, nc;				// neighbouring cell
+
+	if (min_dist > grid->cell_size) return ERROR_GENERIC;
+
+	for (row = 0; row < grid->n_rows; ++row) {
+		for (col = 0; col < grid->n_cols; ++col) {
+			c = row * grid->n_cols + col;
+			for (i = grid->cell_start[c]; i < grid->cell_start[c + 1]; ++i) {
+				// pairs inside the cell
+				for (j = i + 1; j < grid->cell_start[c + 1]; ++j) {
+					if (_spatial_check_pair(&grid->entries[i], &grid->entries[j],
+							min_dist, violations, max_violations, n))
+						++n;
+				}
+
+				// pairs with the forward neighbours
+				for (k = 0; k < 4; ++k) {
+					ncol = col + forward_cells[k][0];
+					nrow = row + forward_cells[k][1];
+					if (ncol < 0 || ncol >= grid->n_cols || nrow >= grid->n_rows)
+						continue;
+					nc = nrow * grid->n_cols + ncol;
+					for (j = grid->cell_start[nc]; j < grid->cell_start[nc + 1]; ++j) {
+						if (_spatial_check_pair(&grid->entries[i],
+								&grid->entries[j], min_dist, violations,
+								max_violations, n))
+							++n;
+					}
+				}
+			}
+		}
+	}
+	return n;
+}
@@ -129,6 +129,107 @@ bool airplane_queue_is_full(airplane_queue_t* queue) {
 	return is_full;
 }
 
+// ==================================================================
+//                         SPAWN WAIT LIST
+// ==================================================================
+// Initialize a spawn wait list
+void spawn_wait_list_init(spawn_wait_list_t* list) {
+	list->top = 0;
+	list->bottom = 0;
+	ptask_mutex_init(&list->mutex);
+}
+
+// Push a deferred spawn request. ERROR_GENERIC is returned if the list is full
+int spawn_wait_list_push(spawn_wait_list_t* list, const spawn_request_t* request) {
+	int rv = SUCCESS;		// Return value
+
+	pthread_mutex_lock(&list->mutex);
+	if (((list->bottom + 1) % SPAWN_WAIT_LIST_LENGTH) != list->top) {
+		list->elems[list->bottom] = *request;
+		list->bottom = (list->bottom + 1) % SPAWN_WAIT_LIST_LENGTH;
+	} else {
+		rv = ERROR_GENERIC;
+	}
+	pthread_mutex_unlock(&list->mutex);
+	return rv;
+}
+
+// Pop the oldest deferred spawn request. false is returned if the list is empty
+bool spawn_wait_list_pop(spawn_wait_list_t* list, spawn_request_t* request) {
+	bool found = false;
+
+	pthread_mutex_lock(&list->mutex);
+	if (list->top != list->bottom) {
+		*request = list->elems[list->top];
+		list->top = (list->top + 1) % SPAWN_WAIT_LIST_LENGTH;
+		found = true;
+	}
+	pthread_mutex_unlock(&list->mutex);
+	return found;
+}
+
+// Read the oldest deferred spawn request without removing it. false is
+// returned if the list is empty
+bool spawn_wait_list_peek(spawn_wait_list_t* list, spawn_request_t* request) {
+	bool found = false;
+
+	pthread_mutex_lock(&list->mutex);
+	if (list->top != list->bottom) {
+		*request = list->elems[list->top];
+		found = true;
+	}
+	pthread_mutex_unlock(&list->mutex);
+	return found;
+}
+
+// Check if the list is empty. Thead safe function
+bool spawn_wait_list_is_empty(spawn_wait_list_t* list) {
+	bool is_empty = false;
+	pthread_mutex_lock(&list->mutex);
+	is_empty = (list->top == list->bottom);
+	pthread_mutex_unlock(&list->mutex);
+	return is_empty;
+}
+
+// ==================================================================
+//                         RUNWAY QUEUE
+// ==================================================================
+// Initialize the runway queue
+void runway_queue_init(runway_queue_t* queue) {
+	queue->top = 0;
+	queue->bottom = 0;
+	ptask_mutex_init(&queue->mutex);
+}
+
+// Push a runway id. ERROR_GENERIC is returned if the queue is full
+int runway_queue_push(runway_queue_t* queue, int runway_id) {
+	int rv = SUCCESS;		// Return value
+
+	pthread_mutex_lock(&queue->mutex);
+	if (((queue->bottom + 1) % RUNWAY_QUEUE_LENGTH) != queue->top) {
+		queue->elems[queue->bottom] = runway_id;
+		queue->bottom = (queue->bottom + 1) % RUNWAY_QUEUE_LENGTH;
+	} else {
+		rv = ERROR_GENERIC;
+	}
+	pthread_mutex_unlock(&queue->mutex);
+	return rv;
+}
+
+// Pop the oldest runway id. false is returned if the queue is empty
+bool runway_queue_pop(runway_queue_t* queue, int* runway_id) {
+	bool found = false;
+
+	pthread_mutex_lock(&queue->mutex);
+	if (queue->top != queue->bottom) {
+		*runway_id = queue->elems[queue->top];
+		queue->top = (queue->top + 1) % RUNWAY_QUEUE_LENGTH;
+		found = true;
+	}
+	pthread_mutex_unlock(&queue->mutex);
+	return found;
+}
+
 // ==================================================================
 //                         CYCLIC BUFFER
 // ==================================================================
@@ -150,21 +251,3 @@ int cbuffer_next_index(cbuffer_t* buffer) {
 	++buffer->top;
 	return index;
 }
-
-// ==================================================================
-//                           TRAJECTORY
-// ==================================================================
-// Return the waypoint at position "index". If the trajectory is cyclic, the index
-// is bounded to the trajectory size
-const waypoint_t* trajectory_get_point(const trajectory_t* trajectory, int index) {
-	if (trajectory == NULL) return NULL;
-	if (index >= 0 && index < trajectory->size) {
-		return &trajectory->waypoints[index];
-	}
-	if (trajectory->is_cyclic) {
-		index = index % trajectory->size;
-		return &trajectory->waypoints[index];
-	}
-
-	return NULL;
-}
\ No newline at end of file
@@ -0,0 +1,145 @@
+/*
+ * taxiway.c
+ *
+ * Taxiway graph, all-pairs shortest routes (Floyd-Warshall) and edge
+ * reservations
+ */
+
+#include <math.h>
+
+#include "taxiway.h"
+#include "ptask.h"
+
+// ==================================================================
+//                         GRAPH CONSTRUCTION
+// ==================================================================
+// Initialize an empty graph
+void taxiway_init(taxiway_t* taxiway) {
+	int i = 0;
+	int j = 0;
+
+	taxiway->n_nodes = 0;
+	taxiway->n_edges = 0;
+	for (i = 0; i < MAX_TAXI_NODES; ++i)
+		for (j = 0; j < MAX_TAXI_NODES; ++j)
+			taxiway->edge_id[i][j] = -1;
+	for (i = 0; i < MAX_TAXI_EDGES; ++i)
+		taxiway->edge_owner[i] = -1;
+	ptask_mutex_init(&taxiway->mutex);
+}
+
+// Add a node. Return its id, or ERROR_GENERIC if the graph is full
+int taxiway_add_node(taxiway_t* taxiway, float x, float y) {
+	if (taxiway->n_nodes >= MAX_TAXI_NODES)
+		return ERROR_GENERIC;
+
+	taxiway->nodes[taxiway->n_nodes] = (taxi_node_t) { .x = x, .y = y };
+	return taxiway->n_nodes++;
+}
+
+// Connect two nodes with a two-way edge. ERROR_GENERIC is returned if
+// the nodes don't exist or if the graph is full
+int taxiway_add_edge(taxiway_t* taxiway, int a, int b) {
+	if (a < 0 || a >= taxiway->n_nodes || b < 0 || b >= taxiway->n_nodes ||
+			a == b || taxiway->n_edges >= MAX_TAXI_EDGES)
+		return ERROR_GENERIC;
+
+	if (taxiway->edge_id[a][b] < 0) {
+		taxiway->edge_id[a][b] = taxiway->n_edges;
+		taxiway->edge_id[b][a] = taxiway->n_edges;
+		++taxiway->n_edges;
+	}
+	return SUCCESS;
+}
+
+// ==================================================================
+//                         SHORTEST ROUTES
+// ==================================================================
+// Compute the shortest routes between all the pairs of nodes. Must be
+// called once the graph is complete
+void taxiway_compute_routes(taxiway_t* taxiway) {
+	const int n = taxiway->n_nodes;
+	const taxi_node_t* p = NULL;
+	const taxi_node_t* q = NULL;
+	float d = 0.0f;
+	int i = 0;
+	int j = 0;
+	int k = 0;
+
+	for (i = 0; i < n; ++i) {
+		for (j = 0; j < n; ++j) {
+			if (i == j) {
+				taxiway->dist[i][j] = 0.0f;
+				taxiway->next[i][j] = j;
+			} else if (taxiway->edge_id[i][j] >= 0) {
+				p = &taxiway->nodes[i];
+				q = &taxiway->nodes[j];
+				taxiway->dist[i][j] = hypotf(q->x - p->x, q->y - p->y);
+				taxiway->next[i][j] = j;
+			} else {
+				taxiway->dist[i][j] = INFINITY;
+				taxiway->next[i][j] = -1;
+			}
+		}
+	}
+
+	for (k = 0; k < n; ++k) {
+		for (i = 0; i < n; ++i) {
+			if (taxiway->next[i][k] < 0) continue;
+			for (j = 0; j < n; ++j) {
+				d = taxiway->dist[i][k] + taxiway->dist[k][j];
+				if (taxiway->next[k][j] >= 0 && d < taxiway->dist[i][j]) {
+					taxiway->dist[i][j] = d;
+					taxiway->next[i][j] = taxiway->next[i][k];
+				}
+			}
+		}
+	}
+}
+
+// Fill the route with the nodes of the shortest route between the two
+// nodes, both included. Return the number of nodes, or ERROR_GENERIC if
+// the nodes aren't connected
+int taxiway_route(const taxiway_t* taxiway, int from, int to,
+		taxi_route_t* route) {
+	int node = from;
+
+	if (taxiway->next[from][to] < 0)
+		return ERROR_GENERIC;
+
+	route->n_nodes = 0;
+	route->nodes[route->n_nodes++] = node;
+	while (node != to && route->n_nodes < MAX_WAYPOINTS) {
+		node = taxiway->next[node][to];
+		route->nodes[route->n_nodes++] = node;
+	}
+	return node == to ? route->n_nodes : ERROR_GENERIC;
+}
+
+// ==================================================================
+//                         EDGE RESERVATIONS
+// ==================================================================
+// Reserve the edge between two nodes. Return false if the edge is
+// reserved by another airplane
+bool taxiway_reserve(taxiway_t* taxiway, int a, int b, int owner) {
+	const int edge = taxiway->edge_id[a][b];
+	bool reserved = false;
+
+	pthread_mutex_lock(&taxiway->mutex);
+	if (taxiway->edge_owner[edge] < 0 || taxiway->edge_owner[edge] == owner) {
+		taxiway->edge_owner[edge] = owner;
+		reserved = true;
+	}
+	pthread_mutex_unlock(&taxiway->mutex);
+	return reserved;
+}
+
+// Release an edge reserved by the airplane
+void taxiway_release(taxiway_t* taxiway, int a, int b, int owner) {
+	const int edge = taxiway->edge_id[a][b];
+
+	pthread_mutex_lock(&taxiway->mutex);
+	if (taxiway->edge_owner[edge] == owner)
+		taxiway->edge_owner[edge] = -1;
+	pthread_mutex_unlock(&taxiway->mutex);
+}
@@ -0,0 +1,248 @@
+/*
+ * traffic.c
+ *
+ * Traffic generator. Each spawn time is computed from the previous one
+ * in O(1): exponential gaps for the Poisson process, sequential order
+ * statistics for the spawns of a bank and thinning of a Poisson process
+ * at the peak rate for the time of day profile
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include "traffic.h"
+
+// Relative traffic of each hour of the day, from midnight. Normalized
+// to a mean of 1 by traffic_params_init
+static const float default_profile[TRAFFIC_PROFILE_HOURS] = {
+	0.10f, 0.05f, 0.05f, 0.05f, 0.10f, 0.30f,
+	1.00f, 1.80f, 2.00f, 1.60f, 1.20f, 1.10f,
+	1.10f, 1.20f, 1.10f, 1.10f, 1.40f, 1.80f,
+	2.00f, 1.60f, 1.20f, 0.80f, 0.50f, 0.30f
+};
+
+// ==================================================================
+//                         RANDOM STREAMS
+// ==================================================================
+// Return the next output of a splitmix64 generator with state "x"
+uint64_t _splitmix64(uint64_t* x) {
+	uint64_t z = (*x += 0x9E3779B97F4A7C15ULL);
+
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+uint64_t _rotl(uint64_t x, int k) {
+	return (x << k) | (x >> (64 - k));
+}
+
+// Initialize the stream "stream" of the seed. The state is filled by
+// splitmix64, so that close seeds and streams give unrelated sequences
+void rng_init(rng_t* rng, uint64_t seed, uint64_t stream) {
+	uint64_t x = seed ^ (stream * 0xD1B54A32D192ED03ULL);
+	int i = 0;
+
+	for (i = 0; i < 4; ++i)
+		rng->s[i] = _splitmix64(&x);
+}
+
+// Return the next 64 random bits (xoshiro256**)
+uint64_t rng_next(rng_t* rng) {
+	uint64_t* s = rng->s;
+	const uint64_t result = _rotl(s[1] * 5, 7) * 9;
+	const uint64_t t = s[1] << 17;
+
+	s[2] ^= s[0];
+	s[3] ^= s[1];
+	s[1] ^= s[2];
+	s[0] ^= s[3];
+	s[2] ^= t;
+	s[3] = _rotl(s[3], 45);
+	return result;
+}
+
+// Return a uniform double in [0, 1)
+double rng_uniform(rng_t* rng) {
+	return (double) (rng_next(rng) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// Return a uniform float in [0, 1)
+float rng_uniformf(rng_t* rng) {
+	return (float) (rng_next(rng) >> 40) * (1.0f / 16777216.0f);
+}
+
+// Return an exponential gap with the provided rate, INFINITY if the
+// rate is not positive
+double rng_exponential(rng_t* rng, double rate) {
+	if (rate <= 0.0) return INFINITY;
+	return -log1p(-rng_uniform(rng)) / rate;
+}
+
+
+// ==================================================================
+//                         ARRIVAL PROCESSES
+// ==================================================================
+// Return the rate of the profile at time t, relative to the mean rate
+float _profile_at(const traffic_params_t* params, double t_s) {
+	double hour = fmod((double) params->start_hour + t_s /
+		(double) params->hour_s, (double) TRAFFIC_PROFILE_HOURS);
+
+	return params->profile[(int) hour];
+}
+
+// Return the time of the next spawn of the Poisson process after t
+double _next_poisson(traffic_gen_t* gen, double t_s) {
+	return t_s + rng_exponential(&gen->rng, (double) gen->params.rate_h / 3600.0);
+}
+
+// Return the time of the next spawn after t. Candidates are drawn at the
+// peak rate and accepted with the ratio between the rate at their time
+// and the peak
+double _next_profile(traffic_gen_t* gen, double t_s) {
+	const double peak_rate = (double) (gen->params.rate_h * gen->peak) / 3600.0;
+
+	if (peak_rate <= 0.0) return INFINITY;
+	do {
+		t_s += rng_exponential(&gen->rng, peak_rate);
+	} while (rng_uniformf(&gen->rng) * gen->peak >
+		_profile_at(&gen->params, t_s));
+	return t_s;
+}
+
+// Return the numb. of spawns of a bank
+int _bank_size(const traffic_params_t* params) {
+	return (int) lroundf(params->rate_h * params->bank_period_s / 3600.0f);
+}
+
+// Return the time of the next spawn of the banks after t. The spawns of
+// a bank are uniform over its width; the next one is the minimum of the
+// remaining uniforms on the rest of the width
+double _next_bank(traffic_gen_t* gen, double t_s) {
+	const double period = (double) gen->params.bank_period_s;
+	const int size = _bank_size(&gen->params);
+	double end = 0.0;
+
+	if (size <= 0 || period <= 0.0) return INFINITY;
+	if (gen->bank_left == 0) {
+		++gen->bank;
+		gen->bank_left = size;
+		t_s = (double) gen->bank * period;
+	}
+	end = (double) gen->bank * period + (double) gen->params.bank_width_s;
+	t_s += (end - t_s) * (1.0 - pow(rng_uniform(&gen->rng),
+		1.0 / (double) gen->bank_left));
+	--gen->bank_left;
+	return t_s;
+}
+
+// Schedule the spawn following the one at time t
+void _schedule_next(traffic_gen_t* gen, double t_s) {
+	switch (gen->params.model) {
+		case TRAFFIC_BANKS:
+			gen->next_s = _next_bank(gen, t_s);
+			break;
+		case TRAFFIC_PROFILE:
+			gen->next_s = _next_profile(gen, t_s);
+			break;
+		case TRAFFIC_POISSON:
+		default:
+			gen->next_s = _next_poisson(gen, t_s);
+			break;
+	}
+}
+
+
+// ==================================================================
+//                         TRAFFIC GENERATOR
+// ==================================================================
+// Set the default parameters: Poisson spawns at TRAFFIC_RATE_H
+void traffic_params_init(traffic_params_t* params) {
+	float mean = 0.0f;
+	int i = 0;
+
+	params->model = TRAFFIC_POISSON;
+	params->rate_h = TRAFFIC_RATE_H;
+	params->inbound_ratio = TRAFFIC_INBOUND_RATIO;
+	params->bank_period_s = TRAFFIC_BANK_PERIOD_S;
+	params->bank_width_s = TRAFFIC_BANK_WIDTH_S;
+	params->hour_s = TRAFFIC_HOUR_S;
+	params->start_hour = TRAFFIC_START_HOUR;
+
+	for (i = 0; i < TRAFFIC_PROFILE_HOURS; ++i)
+		mean += default_profile[i] / (float) TRAFFIC_PROFILE_HOURS;
+	for (i = 0; i < TRAFFIC_PROFILE_HOURS; ++i)
+		params->profile[i] = default_profile[i] / mean;
+}
+
+// Read a model from its name. Return ERROR_GENERIC if it is unknown
+int traffic_parse_model(const char* name, enum traffic_model* model) {
+	if (strcmp(name, "poisson") == 0)
+		*model = TRAFFIC_POISSON;
+	else if (strcmp(name, "banks") == 0)
+		*model = TRAFFIC_BANKS;
+	else if (strcmp(name, "profile") == 0)
+		*model = TRAFFIC_PROFILE;
+	else
+		return ERROR_GENERIC;
+	return SUCCESS;
+}
+
+const char* traffic_model_name(enum traffic_model model) {
+	switch (model) {
+		case TRAFFIC_BANKS:
+			return "banks";
+		case TRAFFIC_PROFILE:
+			return "profile";
+		case TRAFFIC_POISSON:
+		default:
+			return "poisson";
+	}
+}
+
+// Initialize the generator on the traffic stream of the seed. No spawn
+// is generated until traffic_start
+void traffic_init(traffic_gen_t* gen, const traffic_params_t* params,
+		uint64_t seed) {
+	int i = 0;
+
+	gen->params = *params;
+	rng_init(&gen->rng, seed, RNG_STREAM_TRAFFIC);
+	gen->next_s = INFINITY;
+	gen->bank = 0;
+	gen->bank_left = 0;
+	gen->n_generated = 0;
+	gen->peak = 0.0f;
+	for (i = 0; i < TRAFFIC_PROFILE_HOURS; ++i)
+		gen->peak = fmaxf(gen->peak, params->profile[i]);
+}
+
+// Start, or restart, the generation at time t. The banks keep their
+// schedule: starting inside a bank gives the share of its spawns due on
+// the rest of its width
+void traffic_start(traffic_gen_t* gen, double t_s) {
+	const double period = (double) gen->params.bank_period_s;
+	const double width = (double) gen->params.bank_width_s;
+	double left = 0.0;
+
+	if (gen->params.model == TRAFFIC_BANKS && period > 0.0) {
+		gen->bank = (long) floor(t_s / period);
+		left = (double) gen->bank * period + width - t_s;
+		gen->bank_left = (width > 0.0 && left > 0.0) ?
+			(int) lround((double) _bank_size(&gen->params) * left / width) : 0;
+	}
+	_schedule_next(gen, t_s);
+}
+
+// Return true and the kind of the next spawn if it is due by "until".
+// Each call costs O(1), so high rates are generated cheaply
+bool traffic_next(traffic_gen_t* gen, double until_s,
+		enum airplane_status* kind) {
+	if (gen->next_s > until_s) return false;
+
+	*kind = (rng_uniformf(&gen->rng) < gen->params.inbound_ratio) ?
+		INBOUND_HOLDING : OUTBOUND_HOLDING;
+	++gen->n_generated;
+	_schedule_next(gen, gen->next_s);
+	return true;
+}
@@ -0,0 +1,239 @@
+/*
+ * trajectory.c
+ *
+ * Definition of the functions declared in trajectory.h
+ */
+
+#include <math.h>
+#include <stddef.h>
+
+#include "trajectory.h"
+
+#define TRAJ_ALIGN_FLOATS	((int) (TRAJ_ARENA_ALIGN / sizeof(float)))
+#define TRAJ_N_ARRAYS		5		// x, y, vel, length, heading
+
+// ==================================================================
+//                              ARENA
+// ==================================================================
+// Return the floats taken by each array of a trajectory of "capacity"
+// points. The arrays are padded to keep the next one aligned
+int _stride(int capacity) {
+	return (capacity + TRAJ_ALIGN_FLOATS - 1) / TRAJ_ALIGN_FLOATS *
+		TRAJ_ALIGN_FLOATS;
+}
+
+// Lay out an empty trajectory on the arrays that start at "base"
+void _layout(trajectory_t* traj, float* base, int capacity, bool is_cyclic) {
+	const int stride = _stride(capacity);
+
+	traj->capacity = capacity;
+	traj->is_cyclic = is_cyclic;
+	traj->is_writable = true;
+	traj->x = base;
+	traj->y = base + stride;
+	traj->vel = base + 2 * stride;
+	traj->length = base + 3 * stride;
+	traj->heading = base + 4 * stride;
+	trajectory_clear(traj);
+}
+
+// Initialize an empty arena
+void traj_arena_init(traj_arena_t* arena) {
+	arena->n_used = 0;
+	arena->n_trajs = 0;
+}
+
+// Allocate an empty trajectory of "capacity" points, never released. The
+// trajectory is writable until sealed.
+// Return NULL if the arena is full
+trajectory_t* traj_arena_alloc(traj_arena_t* arena, int capacity,
+		bool is_cyclic) {
+	const int stride = _stride(capacity);
+	trajectory_t* traj = NULL;
+
+	if (capacity <= 0 || arena->n_trajs >= TRAJ_ARENA_MAX_TRAJS ||
+			stride > (TRAJ_ARENA_FLOATS - arena->n_used) / TRAJ_N_ARRAYS)
+		return NULL;
+
+	traj = &arena->trajs[arena->n_trajs];
+	traj->id = arena->n_trajs++;
+	_layout(traj, &arena->data[arena->n_used], capacity, is_cyclic);
+	arena->n_used += TRAJ_N_ARRAYS * stride;
+	return traj;
+}
+
+// Reserve a bank for up to "max_trajs" trajectories with "max_points"
+// points in total, whatever their sizes.
+// Return ERROR_GENERIC if the arena is full
+int traj_arena_reserve(traj_arena_t* arena, traj_bank_t* bank,
+		int max_points, int max_trajs) {
+	const int n_floats = TRAJ_N_ARRAYS *
+		_stride(max_points + max_trajs * (TRAJ_ALIGN_FLOATS - 1));
+	int i = 0;
+
+	if (max_trajs > TRAJ_ARENA_MAX_TRAJS - arena->n_trajs ||
+			n_floats > TRAJ_ARENA_FLOATS - arena->n_used)
+		return ERROR_GENERIC;
+
+	bank->arena = arena;
+	bank->first_float = arena->n_used;
+	bank->n_floats = n_floats;
+	bank->first_traj = arena->n_trajs;
+	bank->n_trajs = max_trajs;
+	for (i = 0; i < max_trajs; ++i)
+		arena->trajs[arena->n_trajs + i].id = arena->n_trajs + i;
+	arena->n_used += n_floats;
+	arena->n_trajs += max_trajs;
+	traj_bank_reset(bank);
+	return SUCCESS;
+}
+
+
+// ==================================================================
+//                              BANK
+// ==================================================================
+// Allocate an empty trajectory of "capacity" points in the bank. The
+// trajectory is writable until sealed.
+// Return NULL if the bank is full
+trajectory_t* traj_bank_alloc(traj_bank_t* bank, int capacity,
+		bool is_cyclic) {
+	const int stride = _stride(capacity);
+	trajectory_t* traj = NULL;
+
+	if (capacity <= 0 || bank->used_trajs == bank->n_trajs ||
+			stride > (bank->n_floats - bank->used_floats) / TRAJ_N_ARRAYS)
+		return NULL;
+
+	traj = &bank->arena->trajs[bank->first_traj + bank->used_trajs++];
+	_layout(traj, &bank->arena->data[bank->first_float + bank->used_floats],
+		capacity, is_cyclic);
+	bank->used_floats += TRAJ_N_ARRAYS * stride;
+	return traj;
+}
+
+// Release all the trajectories of the bank. Nobody may read them anymore
+void traj_bank_reset(traj_bank_t* bank) {
+	bank->used_floats = 0;
+	bank->used_trajs = 0;
+}
+
+// Return true if the trajectory is stored in the bank
+bool traj_bank_contains(const traj_bank_t* bank,
+		const trajectory_t* trajectory) {
+	return trajectory != NULL && trajectory->id >= bank->first_traj &&
+		trajectory->id < bank->first_traj + bank->n_trajs &&
+		trajectory == &bank->arena->trajs[trajectory->id];
+}
+
+
+// ==================================================================
+//                           TRAJECTORY
+// ==================================================================
+// Remove all the points of a writable trajectory
+void trajectory_clear(trajectory_t* trajectory) {
+	int i = 0;
+
+	trajectory->size = 0;
+	for (i = 0; i < N_SEGMENTS; ++i)
+		trajectory->segment_start[i] = 0;
+}
+
+// Set the leg that starts at "from" and ends at "to"
+void _set_leg(trajectory_t* traj, int from, int to) {
+	const float dx = traj->x[to] - traj->x[from];
+	const float dy = traj->y[to] - traj->y[from];
+
+	traj->length[from] = hypotf(dx, dy);
+	traj->heading[from] = atan2f(dy, dx);
+}
+
+// Append a point to the provided segment. The segments must be filled in
+// order, ERROR_GENERIC is returned if the trajectory is full or sealed or
+// if a point of a following segment has already been appended
+int trajectory_append(trajectory_t* trajectory, waypoint_t point,
+		enum trajectory_segment segment) {
+	const int n = trajectory->size;
+	int i = 0;
+
+	if (!trajectory->is_writable || n >= trajectory->capacity)
+		return ERROR_GENERIC;
+	if (segment != SEGMENT_EXIT &&
+			trajectory->segment_start[segment + 1] != n)
+		return ERROR_GENERIC;
+
+	trajectory->x[n] = point.x;
+	trajectory->y[n] = point.y;
+	trajectory->vel[n] = point.vel;
+	++trajectory->size;
+
+	// The previous leg ends here, the last one closes the cycle or keeps
+	// the previous heading
+	if (n > 0)
+		_set_leg(trajectory, n - 1, n);
+	if (trajectory->is_cyclic) {
+		_set_leg(trajectory, n, 0);
+	} else {
+		trajectory->length[n] = 0.0f;
+		trajectory->heading[n] = (n > 0) ? trajectory->heading[n - 1] : 0.0f;
+	}
+
+	// The following segments start after the new point
+	for (i = N_SEGMENTS - 1; i > (int) segment; --i)
+		++trajectory->segment_start[i];
+	return SUCCESS;
+}
+
+// Make the trajectory read-only
+void trajectory_seal(trajectory_t* trajectory) {
+	trajectory->is_writable = false;
+}
+
+// Return the position of the point "index", -1 if it is out of the
+// trajectory. If the trajectory is cyclic, the index is bounded to its size
+int _point_index(const trajectory_t* trajectory, int index) {
+	if (trajectory == NULL) return -1;
+	if (index >= 0 && index < trajectory->size) return index;
+	if (trajectory->is_cyclic && trajectory->size > 0)
+		return index % trajectory->size;
+	return -1;
+}
+
+// Put in "point" the waypoint at position "index". If the trajectory is
+// cyclic, the index is bounded to the trajectory size.
+// Return false if there is no such point
+bool trajectory_get_point(const trajectory_t* trajectory, int index,
+		waypoint_t* point) {
+	const int i = _point_index(trajectory, index);
+
+	if (i < 0) return false;
+	point->x = trajectory->x[i];
+	point->y = trajectory->y[i];
+	point->vel = trajectory->vel[i];
+	return true;
+}
+
+// Return the segment of the waypoint at position "index". Indexes past the
+// end of the trajectory belong to the last segment
+enum trajectory_segment trajectory_get_segment(const trajectory_t* trajectory,
+		int index) {
+	if (index >= trajectory->segment_start[SEGMENT_EXIT])
+		return SEGMENT_EXIT;
+	if (index >= trajectory->segment_start[SEGMENT_RUNWAY])
+		return SEGMENT_RUNWAY;
+	return SEGMENT_APPROACH;
+}
+
+// Return the length of the leg from the point "index" to the next one,
+// 0 after the last point
+float trajectory_leg_length(const trajectory_t* trajectory, int index) {
+	const int i = _point_index(trajectory, index);
+
+	return (i < 0) ? 0.0f : trajectory->length[i];
+}
+
+// Return the heading of the leg from the point "index" to the next one
+float trajectory_leg_heading(const trajectory_t* trajectory, int index) {
+	const int i = _point_index(trajectory, index);
+
+	return (i < 0) ? 0.0f : trajectory->heading[i];
+}